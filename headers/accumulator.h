@@ -0,0 +1,113 @@
+/**
+ * @file accumulator.h
+ * @author Thomas Roiseux (thomas.roiseux@mathquantlab.com)
+ * @brief Provides streaming statistics over paths
+ * @version 1.0
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+
+#pragma once
+
+#include "../headers/pch.h"
+#include "../headers/path_block.h"
+
+#include <iostream>
+
+/**
+ * @brief Running mean and variance of paths, point by point (Welford)
+ *
+ * Paths are folded in one at a time, so the memory used does not depend on
+ * the number of paths. Two accumulators can be merged, which lets every
+ * worker accumulate its own paths.
+ */
+class PathAccumulator
+{
+public:
+    /**
+     * @brief Construct a new PathAccumulator object
+     *
+     * @param nb_points Number of points per path
+     */
+    explicit PathAccumulator(size_t nb_points = 0) { reset(nb_points); }
+
+    /**
+     * @brief Forget every path folded in so far
+     *
+     * @param nb_points Number of points per path
+     */
+    void reset(size_t nb_points);
+
+    /**
+     * @brief Fold a path in
+     *
+     * @param path Path, one value per point
+     */
+    void add(PathView<const double> path);
+
+    /**
+     * @brief Fold the paths of another accumulator in
+     *
+     * @param other Accumulator to merge
+     */
+    void merge(const PathAccumulator &other);
+
+    /**
+     * @brief Get the number of paths folded in
+     *
+     * @return size_t Number of paths
+     */
+    size_t count() const noexcept { return m_count; }
+
+    /**
+     * @brief Get the number of points per path
+     *
+     * @return size_t Number of points
+     */
+    size_t nb_points() const noexcept { return m_mean.size(); }
+
+    /**
+     * @brief Get the mean path
+     *
+     * @return const Vector& Mean, one value per point
+     */
+    const Vector &mean() const noexcept { return m_mean; }
+
+    /**
+     * @brief Get the sample variance at a point
+     *
+     * @param j Point index
+     * @return double Sample variance, 0 with less than two paths
+     */
+    double variance(size_t j) const noexcept;
+
+    /**
+     * @brief Get the standard error of the mean at a point
+     *
+     * @param j Point index
+     * @return double Standard error
+     */
+    double standard_error(size_t j) const noexcept;
+
+    /**
+     * @brief Write the accumulator in binary, for another process to merge
+     *
+     * @param out Stream
+     */
+    void write(std::ostream &out) const;
+
+    /**
+     * @brief Read an accumulator written by write
+     *
+     * @param in Stream
+     * @throws Exception If the stream is truncated
+     */
+    void read(std::istream &in);
+
+private:
+    size_t m_count;
+    Vector m_mean;
+    Vector m_m2;
+};
@@ -0,0 +1,102 @@
+/**
+ * @file adaptive.h
+ * @author Thomas Roiseux (thomas.roiseux@mathquantlab.com)
+ * @brief Provides the adaptive nested Monte Carlo system.
+ * @version 1.0
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+
+#pragma once
+#include "../headers/nmc.h"
+
+#include <vector>
+
+/**
+ * @brief Nested estimator allocating the inner paths where the payoff kink
+ * makes them matter.
+ *
+ * Every outer node starts with a pilot batch of SIMD::group inner paths.
+ * A node whose conditional expectation lies more than adaptive.threshold
+ * standard errors away from every XVA factor is on a linear piece of the
+ * payoff: more inner paths would not change its expected payoff, so it is
+ * left alone. The other nodes double their inner paths, closest to a kink
+ * first, up to m1 per node and until the global budget adaptive.budget is
+ * spent.
+ *
+ * Inner paths use the streams of the nested estimator, so a node refined
+ * to m1 inner paths sees the same paths as with --estimator nested.
+ */
+class AdaptiveNMC : public NMC
+{
+public:
+    using NMC::NMC;
+
+    /**
+     * @brief Run the adaptive estimator for one XVA.
+     *
+     * @param xva XVA type
+     * @param factor Factor
+     * @param external_paths External paths simulated
+     * @param paths Path simulated, one value per point
+     */
+    void run(XVA xva, double factor, const std::map<ExternalPaths, PathBlock> &external_paths, PathView<double> paths) const override;
+
+    /**
+     * @brief Run the adaptive estimator for several XVA at once, and report
+     * the inner paths spent.
+     *
+     * @param xvas XVA types and their factors
+     * @param external_paths External paths simulated
+     * @param paths Paths simulated, one row per XVA in the order of the map
+     * @param errors Monte Carlo standard errors, same layout as paths
+     * @param pfe Potential future exposure, one row per level
+     * @throws Exception If the budget is smaller than one pilot path per
+     * outer node
+     */
+    void run(const std::map<XVA, double> &xvas, const std::map<ExternalPaths, PathBlock> &external_paths, PathBlock &paths, PathBlock &errors, PathBlock &pfe) const override;
+
+private:
+    /**
+     * @brief Inner statistics of an outer node
+     *
+     */
+    struct Node
+    {
+        /**
+         * @brief Number of inner paths
+         *
+         */
+        size_t count;
+        /**
+         * @brief Sum of the portfolio values
+         *
+         */
+        double sum;
+        /**
+         * @brief Sum of the squared portfolio values
+         *
+         */
+        double sum_squares;
+    };
+
+    /**
+     * @brief Distance from the closest payoff kink, in standard errors
+     *
+     * @param node Outer node
+     * @param kinks XVA factors
+     * @return double Distance, infinite for an exact conditional expectation
+     */
+    static double kink_distance(const Node &node, const std::vector<double> &kinks);
+
+    /**
+     * @brief Add the next inner paths of outer nodes
+     *
+     * @param external_paths External paths
+     * @param nodes Nodes, node i * nb_dates + j being the date j of the outer path i
+     * @param batches Node index and number of inner paths to add
+     */
+    void refine(const std::map<ExternalPaths, PathBlock> &external_paths, std::vector<Node> &nodes, const std::vector<std::pair<size_t, size_t>> &batches) const;
+};
@@ -0,0 +1,226 @@
+/**
+ * @file backend.h
+ * @author Thomas Roiseux (thomas.roiseux@mathquantlab.com)
+ * @brief Provides the interface of the compute backends
+ * @version 1.0
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+
+#pragma once
+
+#include "../headers/pch.h"
+#include "../headers/path_block.h"
+#include "../headers/rng.h"
+#include "../headers/config.h"
+#include "../headers/time_grid.h"
+#include "../headers/sensitivities.h"
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Compute backend running the simulation
+ *
+ * The CPU backend is always built. The GPU backend is only built by nvcc:
+ * a binary built with XVA_CPU_ONLY defined links no CUDA code at all. The
+ * GPU is only probed when the GPU backend may be selected, so a run on the
+ * CPU never initialises CUDA.
+ */
+class Backend
+{
+public:
+    /**
+     * @brief Backend selection and options, parsed from the command line
+     *
+     */
+    struct Options
+    {
+        /**
+         * @brief Backend: "auto" for the GPU if one is available, "cpu" or
+         * "gpu"
+         *
+         */
+        std::string name = "auto";
+        /**
+         * @brief GPU device id, -1 for the current device
+         *
+         */
+        int device = -1;
+        /**
+         * @brief Number of CPU threads, 0 for the hardware concurrency
+         *
+         */
+        size_t threads = 0;
+        /**
+         * @brief Fold internal paths into running statistics instead of
+         * storing them
+         *
+         */
+        bool streaming = false;
+        /**
+         * @brief Number of worker processes sharing the outer paths, 0 for a
+         * single process
+         *
+         */
+        size_t shards = 0;
+    };
+
+    /**
+     * @brief Destroy the Backend object
+     *
+     */
+    virtual ~Backend() = default;
+
+    /**
+     * @brief Create the backend of the options
+     *
+     * @param options Backend selection and options
+     * @return std::unique_ptr<Backend> Backend
+     * @throws Exception If the backend is unknown, not built in this binary
+     * or does not support the options
+     */
+    static std::unique_ptr<Backend> create(const Options &options);
+
+    /**
+     * @brief Check if the GPU backend is built in this binary
+     *
+     * @return true Built with CUDA
+     * @return false Built with XVA_CPU_ONLY
+     */
+    static bool gpu_built() noexcept;
+
+    /**
+     * @brief Get the name of the backend
+     *
+     * @return const char* Name
+     */
+    virtual const char *name() const noexcept = 0;
+
+    /**
+     * @brief Run the simulation
+     *
+     * @param xva XVA types
+     * @param m0 Number of external paths
+     * @param m1 Number of internal paths
+     * @param grid Simulation points and exposure dates
+     * @param paths Paths simulated, one row per XVA in the order of the map,
+     * one value per exposure date
+     * @param errors Monte Carlo standard errors, same layout as paths, empty
+     * if not estimated
+     * @param pfe Potential future exposure, one row per level of
+     * config.pfe_levels, empty if not estimated
+     * @param config Risk factor models
+     * @param seed Seed of the random streams
+     * @throws Exception If the backend does not support the configuration
+     */
+    virtual void run(const std::map<XVA, double> &xva, size_t m0, size_t m1, const TimeGrid &grid,
+                     PathBlock &paths, PathBlock &errors, PathBlock &pfe, const Config &config, RNG::Seed seed) = 0;
+
+    /**
+     * @brief Compute the sensitivities of the XVA to the model parameters,
+     * see Sensitivities::compute
+     *
+     * @param xva XVA types
+     * @param m0 Number of external paths
+     * @param m1 Number of internal paths
+     * @param grid Simulation points and exposure dates
+     * @param paths Paths of the base run
+     * @param config Risk factor models and Config::sensitivity_parameters
+     * @param seed Seed of the random streams
+     * @return std::vector<Sensitivity> Sensitivities
+     * @throws Exception If the backend does not compute sensitivities
+     */
+    virtual std::vector<Sensitivity> sensitivities(const std::map<XVA, double> &xva, size_t m0, size_t m1, const TimeGrid &grid,
+                                                   const PathBlock &paths, const Config &config, RNG::Seed seed);
+};
+
+/**
+ * @brief Backend running the simulation on the CPU thread pool
+ *
+ * A run in float or mixed precision is followed by the double precision run
+ * of the same seed, and their accuracy report. The report states when the
+ * reduced precision brought no speedup: the normals are drawn in double in
+ * every mode, so float paths only pay off when the memory bandwidth of the
+ * internal paths dominates.
+ */
+class CPUBackend final : public Backend
+{
+public:
+    /**
+     * @brief Construct a new CPUBackend object
+     *
+     * @param options Threads, streaming and shards
+     */
+    explicit CPUBackend(const Options &options) : m_threads(options.threads), m_streaming(options.streaming), m_shards(options.shards) {}
+
+    const char *name() const noexcept override { return "cpu"; }
+
+    void run(const std::map<XVA, double> &xva, size_t m0, size_t m1, const TimeGrid &grid,
+             PathBlock &paths, PathBlock &errors, PathBlock &pfe, const Config &config, RNG::Seed seed) override;
+
+    std::vector<Sensitivity> sensitivities(const std::map<XVA, double> &xva, size_t m0, size_t m1, const TimeGrid &grid,
+                                           const PathBlock &paths, const Config &config, RNG::Seed seed) override;
+
+private:
+    /**
+     * @brief Run the simulation in the precision of the configuration
+     *
+     * @param xva XVA types
+     * @param m0 Number of external paths
+     * @param m1 Number of internal paths
+     * @param grid Simulation points and exposure dates
+     * @param paths Paths simulated
+     * @param errors Monte Carlo standard errors
+     * @param pfe Potential future exposure
+     * @param config Risk factor models
+     * @param seed Seed of the random streams
+     */
+    void simulate(const std::map<XVA, double> &xva, size_t m0, size_t m1, const TimeGrid &grid,
+                  PathBlock &paths, PathBlock &errors, PathBlock &pfe, const Config &config, RNG::Seed seed) const;
+
+    size_t m_threads;
+    bool m_streaming;
+    size_t m_shards;
+};
+
+/**
+ * @brief Backend running the simulation on a CUDA device, implemented with
+ * the kernels of CUDA::Simulation
+ *
+ * The device is reset when the backend is destroyed.
+ */
+class GPUBackend final : public Backend
+{
+public:
+    /**
+     * @brief Select the device of the options
+     *
+     * @param options Device
+     * @throws Exception If the device is invalid or CPU options are set
+     */
+    explicit GPUBackend(const Options &options);
+
+    /**
+     * @brief Reset the device
+     *
+     */
+    ~GPUBackend() override;
+
+    /**
+     * @brief Check if a CUDA device is available, initialising CUDA
+     *
+     * @return true A device is available
+     * @return false No device
+     */
+    static bool available() noexcept;
+
+    const char *name() const noexcept override { return "gpu"; }
+
+    void run(const std::map<XVA, double> &xva, size_t m0, size_t m1, const TimeGrid &grid,
+             PathBlock &paths, PathBlock &errors, PathBlock &pfe, const Config &config, RNG::Seed seed) override;
+};
@@ -0,0 +1,437 @@
+/**
+ * @file config.h
+ * @author Thomas Roiseux (thomas.roiseux@mathquantlab.com)
+ * @brief Provides the run configuration
+ * @version 1.0
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+
+#pragma once
+
+#include "../headers/pch.h"
+#include "../headers/models.h"
+#include "../headers/correlation.h"
+#include "../headers/curve.h"
+#include "../headers/portfolio.h"
+
+#include <map>
+#include <vector>
+
+/**
+ * @brief Estimators of the exposure
+ *
+ */
+enum class Estimator
+{
+    /**
+     * @brief Exposure profile of the internal paths branched from the first
+     * external path, the XVA payoff being applied to the profile
+     *
+     */
+    Profile,
+    /**
+     * @brief Conditional nested Monte Carlo: m1 inner paths are branched from
+     * the state of every outer path at every date, the XVA payoff being
+     * applied to each conditional expectation before averaging over the
+     * outer paths
+     *
+     */
+    Nested,
+    /**
+     * @brief Multilevel Monte Carlo over the number of inner paths of the
+     * nested estimator, 2^l at the level l
+     *
+     */
+    MLMC,
+    /**
+     * @brief Conditional nested Monte Carlo spending more inner paths on the
+     * outer nodes close to the payoff kink, within a global budget
+     *
+     */
+    Adaptive,
+    /**
+     * @brief Conditional expectations regressed on the outer state, fitted
+     * on a pilot of inner paths at every date
+     *
+     */
+    Regression
+};
+
+/**
+ * @brief Measure changes of the outer paths
+ *
+ */
+enum class Importance
+{
+    /**
+     * @brief Plain sampling
+     *
+     */
+    None,
+    /**
+     * @brief Constant drift shift of the Brownian increments, moving the
+     * linearised portfolio value at the horizon to its PFE quantile
+     *
+     */
+    Auto,
+    /**
+     * @brief Drift shift fitted by the cross-entropy method on pilot paths,
+     * started from the automatic one
+     *
+     */
+    CrossEntropy
+};
+
+/**
+ * @brief Floating point precision of the internal paths
+ *
+ */
+enum class Precision
+{
+    /**
+     * @brief Paths and sums in double
+     *
+     */
+    Double,
+    /**
+     * @brief Paths, increments and sums in float
+     *
+     */
+    Float,
+    /**
+     * @brief Paths and increments in float, sums in double
+     *
+     */
+    Mixed
+};
+
+/**
+ * @brief Parse an estimator name
+ *
+ * @param str Name (profile, nested, mlmc, adaptive, regression)
+ * @return Estimator Estimator
+ * @throws Exception If the name is unknown
+ */
+Estimator parse_estimator(const std::string &str);
+
+/**
+ * @brief Pretty print an estimator name
+ *
+ * @param estimator Estimator
+ * @return const char* Estimator name
+ */
+const char *estimator_name(Estimator estimator) noexcept;
+
+/**
+ * @brief Parse a measure change name
+ *
+ * @param str Name (none, auto, cross-entropy)
+ * @return Importance Measure change
+ * @throws Exception If the name is unknown
+ */
+Importance parse_importance(const std::string &str);
+
+/**
+ * @brief Pretty print a measure change name
+ *
+ * @param importance Measure change
+ * @return const char* Measure change name
+ */
+const char *importance_name(Importance importance) noexcept;
+
+/**
+ * @brief Parse a precision name
+ *
+ * @param str Name (float, double, mixed)
+ * @return Precision Precision
+ * @throws Exception If the name is unknown
+ */
+Precision parse_precision(const std::string &str);
+
+/**
+ * @brief Pretty print a precision name
+ *
+ * @param precision Precision
+ * @return const char* Precision name
+ */
+const char *precision_name(Precision precision) noexcept;
+
+/**
+ * @brief Run configuration
+ *
+ * Defaults reproduce the historical hard-coded models. A configuration file
+ * holds one "key = value" per line, '#' starting a comment. Model keys are
+ * "<factor>.<field>", factor being interest, fx, equity or internal (the
+ * model of the internal paths, started from the external paths) and field
+ * being model, x0, mu, kappa, theta or sigma. Correlations of the external
+ * factors are set with "correlation.<factor>.<factor>", the estimator
+ * with "estimator" and the precision of its internal paths with
+ * "precision". The target root mean square error of the multilevel
+ * estimator is set with "mlmc.epsilon". The adaptive estimator reads
+ * "adaptive.budget" and "adaptive.threshold", the regression estimator
+ * "regression.pilot", "regression.inner", "regression.degree" and
+ * "regression.check". "qmc.replicates" draws the external paths from that
+ * many independently scrambled Sobol sequences, 0 keeping pseudo-random
+ * paths. "variance.antithetic" and "variance.control" (0 or 1) switch the
+ * antithetic paths and the control variates on. "importance" sets the
+ * measure change of the outer paths, "importance.pilot" the number of
+ * cross-entropy pilot paths, and "pfe.levels" the comma-separated quantiles
+ * of the potential future exposure. "grid.dates" lists the exposure dates,
+ * replacing the N uniform points, "grid.growth" spaces the N points with
+ * intervals growing geometrically instead, and "grid.step" caps the
+ * simulation steps of the models without exact transitions.
+ * "market.discount", "market.hazard.counterparty" and "market.hazard.own"
+ * set the short rate and the hazard rates, see Curve::parse, and
+ * "market.recovery.counterparty", "market.recovery.own", "market.funding"
+ * and "market.capital" the recoveries and the costs of the XVA payoffs.
+ * "portfolio" loads the trades of a portfolio file, see Portfolio.
+ * "sensitivity.parameters" lists the model keys, or "all", whose XVA
+ * sensitivities are computed with common random numbers, bumped by
+ * "sensitivity.bump" relative to their value, and "sensitivity.pathwise"
+ * (0 or 1) adds their pathwise derivatives.
+ */
+struct Config
+{
+    /**
+     * @brief Construct a new Config object with the default models
+     *
+     */
+    Config();
+
+    /**
+     * @brief Load a configuration file, overriding the keys it sets
+     *
+     * @param filename Configuration file
+     * @throws Exception If the file cannot be read or holds an invalid line
+     */
+    void load(const std::string &filename);
+
+    /**
+     * @brief Set a single key
+     *
+     * @param key Key
+     * @param value Value
+     * @throws Exception If the key is unknown or the value invalid
+     */
+    void set(const std::string &key, const std::string &value);
+
+    /**
+     * @brief Get a model parameter from its key
+     *
+     * @param key Key, "<factor>.<field>" with field x0, mu, kappa, theta or
+     * sigma
+     * @return double* Parameter, nullptr if the key is not a model parameter
+     */
+    double *parameter(const std::string &key);
+
+    /**
+     * @brief Models of the external risk factors
+     *
+     */
+    std::map<ExternalPaths, Models::Parameters> external;
+
+    /**
+     * @brief Model of the internal paths, x0 being ignored
+     *
+     */
+    Models::Parameters internal;
+
+    /**
+     * @brief Correlation of the external factors, applied to their Brownian
+     * increments, indexed by ExternalPaths
+     *
+     */
+    CorrelationMatrix correlation;
+
+    /**
+     * @brief Estimator of the exposure
+     *
+     */
+    Estimator estimator;
+
+    /**
+     * @brief Precision of the internal paths of the profile estimator
+     *
+     */
+    Precision precision;
+
+    /**
+     * @brief Target root mean square error of the multilevel estimator, on
+     * every XVA at every date
+     *
+     */
+    double mlmc_epsilon;
+
+    /**
+     * @brief Total number of inner paths of the adaptive estimator, 0 for
+     * the m0 * m1 * N paths of the nested estimator
+     *
+     */
+    size_t adaptive_budget;
+
+    /**
+     * @brief Distance from the payoff kink, in standard errors of the
+     * conditional expectation, beyond which an outer node is not refined
+     *
+     */
+    double adaptive_threshold;
+
+    /**
+     * @brief Number of outer paths fitting the regression
+     *
+     */
+    size_t regression_pilot;
+
+    /**
+     * @brief Number of inner paths per pilot outer node
+     *
+     */
+    size_t regression_inner;
+
+    /**
+     * @brief Total degree of the polynomial basis in the outer state
+     *
+     */
+    size_t regression_degree;
+
+    /**
+     * @brief Number of outer paths on which the regression is checked
+     * against the nested estimator, 0 to skip the check
+     *
+     */
+    size_t regression_check;
+
+    /**
+     * @brief Number of randomised quasi-Monte Carlo replicates of the
+     * external paths, 0 for pseudo-random paths
+     *
+     */
+    size_t qmc_replicates;
+
+    /**
+     * @brief Draw the paths in antithetic pairs, the odd path of a pair
+     * negating the normal samples of the even one
+     *
+     */
+    bool antithetic;
+
+    /**
+     * @brief Correct the estimates with control variates whose expectations
+     * are known in closed form, see Models::expectation
+     *
+     */
+    bool control_variates;
+
+    /**
+     * @brief Measure change of the outer paths
+     *
+     */
+    Importance importance;
+
+    /**
+     * @brief Number of pilot paths of every cross-entropy iteration
+     *
+     */
+    size_t importance_pilot;
+
+    /**
+     * @brief Quantiles of the potential future exposure, in (0, 1), in
+     * increasing order. Importance sampling targets the last one.
+     *
+     */
+    std::vector<double> pfe_levels;
+
+    /**
+     * @brief Exposure dates, in increasing order, empty for N points spread
+     * over the horizon
+     *
+     */
+    std::vector<double> grid_dates;
+
+    /**
+     * @brief Ratio of two consecutive intervals between the N exposure
+     * dates, 1 for a uniform grid, above 1 for a dense short end
+     *
+     */
+    double grid_growth;
+
+    /**
+     * @brief Longest simulation step of the models without exact transitions,
+     * 0 for the step T / N of the uniform grid
+     *
+     */
+    double grid_step;
+
+    /**
+     * @brief Short rate curve of the discount factors
+     *
+     */
+    Curve market_discount;
+
+    /**
+     * @brief Hazard rate curve of the counterparty
+     *
+     */
+    Curve market_hazard_counterparty;
+
+    /**
+     * @brief Hazard rate curve of the bank
+     *
+     */
+    Curve market_hazard_own;
+
+    /**
+     * @brief Recovery rate of the counterparty, in [0, 1]
+     *
+     */
+    double market_recovery_counterparty;
+
+    /**
+     * @brief Recovery rate of the bank, in [0, 1]
+     *
+     */
+    double market_recovery_own;
+
+    /**
+     * @brief Funding spread of the FVA and the MVA, per year
+     *
+     */
+    double market_funding;
+
+    /**
+     * @brief Cost of capital of the KVA, per year
+     *
+     */
+    double market_capital;
+
+    /**
+     * @brief Trades of the counterparty, empty for the synthetic portfolio,
+     * the mean of the external factors
+     *
+     */
+    Portfolio portfolio;
+
+    /**
+     * @brief Model parameters whose sensitivities are computed, as keys,
+     * "all" standing for every parameter of the models in use
+     *
+     */
+    std::vector<std::string> sensitivity_parameters;
+
+    /**
+     * @brief Bump of the sensitivities, relative to the parameter, absolute
+     * for a parameter equal to 0
+     *
+     */
+    double sensitivity_bump;
+
+    /**
+     * @brief Compute the pathwise derivatives along with the finite
+     * differences
+     *
+     */
+    bool sensitivity_pathwise;
+};
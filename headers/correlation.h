@@ -0,0 +1,105 @@
+/**
+ * @file correlation.h
+ * @author Thomas Roiseux (thomas.roiseux@mathquantlab.com)
+ * @brief Provides the correlation of the external risk factors
+ * @version 1.0
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+
+#pragma once
+
+#include "../headers/rng.h"
+
+/**
+ * @brief Number of external risk factors, one per ExternalPaths value
+ *
+ */
+constexpr size_t nb_factors = 3;
+
+/**
+ * @brief Lower-triangular Cholesky factor of a correlation matrix
+ *
+ * Plain data, passed by value to the GPU kernels.
+ */
+struct Cholesky
+{
+    /**
+     * @brief Coefficients, L[i][j] = 0 for j > i
+     *
+     */
+    double L[nb_factors][nb_factors];
+
+    /**
+     * @brief Turn independent standard normal samples into correlated ones, in place
+     *
+     * @param z One sample per factor
+     */
+    XVA_HOST_DEVICE void apply(double z[nb_factors]) const
+    {
+        // Highest factor first, so that lower samples are still independent when read
+        for (size_t i = nb_factors; i-- > 0;)
+        {
+            double sum = 0;
+            for (size_t j = 0; j <= i; j++)
+            {
+                sum += L[i][j] * z[j];
+            }
+            z[i] = sum;
+        }
+    }
+};
+
+/**
+ * @brief Correlation matrix of the external risk factors
+ *
+ */
+class CorrelationMatrix
+{
+public:
+    /**
+     * @brief Construct a new CorrelationMatrix object, the identity
+     *
+     */
+    CorrelationMatrix() noexcept;
+
+    /**
+     * @brief Get a correlation
+     *
+     * @param i First factor
+     * @param j Second factor
+     * @return double Correlation
+     */
+    double operator()(size_t i, size_t j) const noexcept { return m_rho[i][j]; }
+
+    /**
+     * @brief Set a correlation, keeping the matrix symmetric
+     *
+     * @param i First factor
+     * @param j Second factor, different from i
+     * @param rho Correlation, in [-1, 1]
+     * @throws Exception If the factors are equal or the correlation out of range
+     */
+    void set(size_t i, size_t j, double rho);
+
+    /**
+     * @brief Check if the factors are independent
+     *
+     * @return true The matrix is the identity
+     * @return false At least one factor is correlated
+     */
+    bool is_identity() const noexcept;
+
+    /**
+     * @brief Compute the Cholesky factor
+     *
+     * @return Cholesky Lower-triangular factor
+     * @throws Exception If the matrix is not positive definite
+     */
+    Cholesky cholesky() const;
+
+private:
+    double m_rho[nb_factors][nb_factors];
+};
@@ -12,6 +12,9 @@
 #pragma once
 
 #include "../headers/pch.h"
+#include "../headers/path_block.h"
+#include "../headers/rng.h"
+#include "../headers/config.h"
 
 namespace CUDA
 {
@@ -30,12 +33,16 @@ namespace CUDA
          * @param nb_points Number of points
          * @param T Time horizon
          * @param external_paths External paths simulated
-         * @param paths Paths simulated
+         * @param paths Paths simulated, one row per XVA in the order of the map
+         * @param config Risk factor models, shared with the CPU simulation
+         * @param seed Seed of the random streams, shared with the CPU simulation
          */
         void run_simulation(const std::map<XVA, double>& xva,
                             size_t m0, size_t m1,
                             size_t nb_points, double T,
-                            std::map<ExternalPaths, std::vector<Vector>> &external_paths,
-                            std::map<XVA, Vector> &paths);
+                            std::map<ExternalPaths, PathBlock> &external_paths,
+                            PathBlock &paths,
+                            const Config &config,
+                            RNG::Seed seed = RNG::default_seed);
     }
 }
\ No newline at end of file
@@ -13,6 +13,11 @@
 
 #include "../headers/pch.h"
 
+#include <cuda.h>
+#include <cuda_runtime.h>
+
+#include <tuple>
+
 /**
  * @brief All CUDA functions
  *
@@ -119,6 +124,13 @@ namespace CUDA
          * @return const char* Exception message
          */
         virtual const char *what() const noexcept override;
+
+        /**
+         * @brief Get the exit code of the program, the CUDA error
+         *
+         * @return int Exit code
+         */
+        virtual int code() const noexcept override { return m_error; }
     private:
         cudaError_t m_error;
     };
@@ -0,0 +1,67 @@
+/**
+ * @file curve.h
+ * @author Thomas Roiseux (thomas.roiseux@mathquantlab.com)
+ * @brief Provides the term structures of the market
+ * @version 1.0
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+
+#pragma once
+
+#include "../headers/pch.h"
+
+#include <vector>
+#include <string>
+
+/**
+ * @brief Piecewise flat curve of instantaneous rates, a short rate or a
+ * hazard rate
+ *
+ * The rate of the pillar k holds up to its end time, the last rate being
+ * extended flat beyond the last pillar.
+ */
+class Curve
+{
+public:
+    /**
+     * @brief Construct a new flat Curve object
+     *
+     * @param rate Rate
+     */
+    explicit Curve(double rate = 0) : m_ends(1, 0.0), m_rates(1, rate) {}
+
+    /**
+     * @brief Parse a curve: a single rate, or comma-separated "end:rate"
+     * pillars in increasing order of their end times
+     *
+     * @param str Curve
+     * @return Curve Curve
+     * @throws Exception If a pillar is invalid, or the end times are not
+     * increasing
+     */
+    static Curve parse(const std::string &str);
+
+    /**
+     * @brief Integrate the rate from 0
+     *
+     * @param t Time
+     * @return double Integral of the rate over [0, t]
+     */
+    double integral(double t) const;
+
+    /**
+     * @brief Get the discount factor, or the survival probability, of a
+     * time
+     *
+     * @param t Time
+     * @return double exp(-integral(t))
+     */
+    double factor(double t) const;
+
+private:
+    std::vector<double> m_ends;
+    std::vector<double> m_rates;
+};
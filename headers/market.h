@@ -0,0 +1,127 @@
+/**
+ * @file market.h
+ * @author Thomas Roiseux (thomas.roiseux@mathquantlab.com)
+ * @brief Provides the market curves read by the XVA payoffs
+ * @version 1.0
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+
+#pragma once
+
+#include "../headers/pch.h"
+#include "../headers/config.h"
+#include "../headers/time_grid.h"
+#include "../headers/path_block.h"
+
+/**
+ * @brief Discount factors, survival probabilities and default probability
+ * increments at the exposure dates of a grid
+ *
+ * Every table is computed once per grid and stored as a row of an aligned
+ * block, so the payoffs only read them. The weight of an XVA at the date d,
+ * over the interval (t_d-1, t_d], t_-1 being 0, is
+ * - CVA: LGD_C D(t_d) S_B(t_d) (S_C(t_d-1) - S_C(t_d)), the counterparty C
+ *   defaulting first,
+ * - DVA: LGD_B D(t_d) S_C(t_d) (S_B(t_d-1) - S_B(t_d)), the bank B
+ *   defaulting first,
+ * - FVA and MVA: s_F D(t_d) S_C(t_d) S_B(t_d) (t_d - t_d-1), s_F being the
+ *   funding spread,
+ * - KVA: k D(t_d) S_C(t_d) S_B(t_d) (t_d - t_d-1), k being the cost of
+ *   capital,
+ * so that the XVA is the sum over the dates of the weighted exposures.
+ */
+class MarketCurves
+{
+public:
+    /**
+     * @brief Parties of the netting set
+     *
+     */
+    enum Party
+    {
+        /**
+         * @brief Counterparty
+         *
+         */
+        Counterparty,
+        /**
+         * @brief Bank, whose own default gives the DVA
+         *
+         */
+        Own
+    };
+
+    /**
+     * @brief Construct an empty MarketCurves object
+     *
+     */
+    MarketCurves() = default;
+
+    /**
+     * @brief Build the tables of a grid
+     *
+     * @param config Curves, recoveries and costs, see Config::market_discount
+     * @param grid Exposure dates
+     */
+    MarketCurves(const Config &config, const TimeGrid &grid);
+
+    /**
+     * @brief Get the discount factor of an exposure date
+     *
+     * @param d Date index
+     * @return double Discount factor
+     */
+    double discount(size_t d) const noexcept { return m_tables(discount_row, d); }
+
+    /**
+     * @brief Get the survival probability of a party up to an exposure date
+     *
+     * @param party Party
+     * @param d Date index
+     * @return double Survival probability
+     */
+    double survival(Party party, size_t d) const noexcept { return m_tables(survival_row + party, d); }
+
+    /**
+     * @brief Get the default probability of a party over the interval
+     * ending at an exposure date
+     *
+     * @param party Party
+     * @param d Date index
+     * @return double Default probability increment
+     */
+    double default_probability(Party party, size_t d) const noexcept { return m_tables(default_row + party, d); }
+
+    /**
+     * @brief Get the weight of an XVA at an exposure date
+     *
+     * @param xva XVA type
+     * @param d Date index
+     * @return double Weight of the exposure
+     */
+    double weight(XVA xva, size_t d) const noexcept { return m_tables(weight_row + xva, d); }
+
+    /**
+     * @brief Get the weights of an XVA at every exposure date
+     *
+     * @param xva XVA type
+     * @return PathView<const double> Weights, one per date
+     */
+    PathView<const double> weights(XVA xva) const noexcept { return m_tables.path(weight_row + xva); }
+
+private:
+    /**
+     * @brief Rows of the tables
+     *
+     */
+    static constexpr size_t discount_row = 0;
+    static constexpr size_t survival_row = 1;
+    static constexpr size_t default_row = 3;
+    static constexpr size_t weight_row = 5;
+    static constexpr size_t nb_rows = weight_row + KVA + 1;
+
+    PathBlock m_tables;
+};
@@ -0,0 +1,109 @@
+/**
+ * @file mlmc.h
+ * @author Thomas Roiseux (thomas.roiseux@mathquantlab.com)
+ * @brief Provides the multilevel nested Monte Carlo system.
+ * @version 1.0
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+
+#pragma once
+#include "../headers/nmc.h"
+
+#include <vector>
+
+/**
+ * @brief Multilevel Monte Carlo estimator of the nested XVA.
+ *
+ * The level l estimates the XVA payoff of the conditional expectation from
+ * 2^l inner paths, for l up to log2(m1). Each level sample draws a fresh
+ * outer path and corrects the level l - 1 with the antithetic difference
+ * P_l - (P_l-1(a) + P_l-1(b)) / 2, a and b being the two halves of the inner
+ * paths of the level l. Levels start with m0 samples, then the number of
+ * samples of each level is set from its observed variance V_l and its cost
+ * C_l as N_l = 2 / epsilon^2 sqrt(V_l / C_l) sum_k sqrt(V_k C_k), until the
+ * target root mean square error epsilon is reached.
+ *
+ * Sample n of the level l uses the outer path l * 2^24 + n, so the level 0
+ * shares the outer paths of the nested estimator.
+ */
+class MLMC : public NMC
+{
+public:
+    using NMC::NMC;
+
+    /**
+     * @brief Run the multilevel estimator for one XVA.
+     *
+     * @param xva XVA type
+     * @param factor Factor
+     * @param external_paths Unused, each level sample draws its outer path
+     * @param paths Path simulated, one value per point
+     */
+    void run(XVA xva, double factor, const std::map<ExternalPaths, PathBlock> &external_paths, PathView<double> paths) const override;
+
+    /**
+     * @brief Run the multilevel estimator for several XVA at once, and
+     * report the samples, variance and cost of every level.
+     *
+     * The number of samples per level is driven by the largest variance
+     * over the XVA and the dates. The cost saving against plain nested
+     * Monte Carlo is only reported when every correction level has a
+     * variance beyond the rounding of the level 0.
+     *
+     * @param xvas XVA types and their factors
+     * @param external_paths Unused, each level sample draws its outer path
+     * @param paths Paths simulated, one row per XVA in the order of the map
+     * @param errors Monte Carlo standard errors, same layout as paths
+     * @param pfe Potential future exposure, one row per level
+     * @throws Exception If a level needs more than 2^24 samples
+     */
+    void run(const std::map<XVA, double> &xvas, const std::map<ExternalPaths, PathBlock> &external_paths, PathBlock &paths, PathBlock &errors, PathBlock &pfe) const override;
+
+private:
+    /**
+     * @brief Statistics of a level
+     *
+     */
+    struct Level
+    {
+        /**
+         * @brief Number of inner paths of the fine estimate, 2^l
+         *
+         */
+        size_t nb_inner;
+        /**
+         * @brief Differences of the level, one accumulator per XVA
+         *
+         */
+        std::vector<PathAccumulator> differences;
+        /**
+         * @brief Largest variance of a difference over the XVA and the dates
+         *
+         */
+        double variance;
+        /**
+         * @brief Cost of a sample, in model steps
+         *
+         */
+        double cost;
+        /**
+         * @brief Time spent on the level, in seconds
+         *
+         */
+        double seconds;
+    };
+
+    /**
+     * @brief Draw level samples and fold their differences into the level
+     *
+     * @param xvas XVA types and their factors
+     * @param index Level index
+     * @param level Level
+     * @param first First sample index
+     * @param count Number of samples
+     */
+    void sample(const std::vector<std::pair<XVA, double>> &xvas, size_t index, Level &level, size_t first, size_t count) const;
+};
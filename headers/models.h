@@ -0,0 +1,417 @@
+/**
+ * @file models.h
+ * @author Thomas Roiseux (thomas.roiseux@mathquantlab.com)
+ * @brief Provides the risk factor models, as compile-time policies
+ * @version 1.0
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+
+#pragma once
+
+#include "../headers/rng.h"
+
+#include <string>
+
+/**
+ * @brief Risk factor models
+ *
+ * A model is a policy with a Constants type, precomputed from the
+ * Parameters and the length of every time step, and a step function
+ * advancing a value by one time step from a standard normal sample. The step is generic over
+ * the math type M (a double, or a SIMD register), so one loop is written
+ * per backend and specialised per model at compile time.
+ */
+namespace Models
+{
+    /**
+     * @brief Model types, selected in the configuration
+     *
+     */
+    enum class Kind
+    {
+        /**
+         * @brief Geometric Brownian motion, dX = mu X dt + sigma X dW
+         *
+         */
+        GBM,
+        /**
+         * @brief Square-root diffusion, dX = kappa (theta - X) dt + sigma sqrt(X) dW
+         *
+         */
+        CIR,
+        /**
+         * @brief Ornstein-Uhlenbeck, dX = kappa (theta - X) dt + sigma dW
+         *
+         */
+        Vasicek,
+        /**
+         * @brief Hull-White with a flat drift, dX = (theta - kappa X) dt + sigma dW
+         *
+         */
+        HullWhite
+    };
+
+    /**
+     * @brief Model parameters, each model using its own subset
+     *
+     */
+    struct Parameters
+    {
+        /**
+         * @brief Model type
+         *
+         */
+        Kind kind;
+        /**
+         * @brief Initial value
+         *
+         */
+        double x0;
+        /**
+         * @brief Drift (GBM)
+         *
+         */
+        double mu;
+        /**
+         * @brief Mean reversion speed (CIR, Vasicek, Hull-White)
+         *
+         */
+        double kappa;
+        /**
+         * @brief Long-term mean (CIR, Vasicek), drift level (Hull-White)
+         *
+         */
+        double theta;
+        /**
+         * @brief Volatility
+         *
+         */
+        double sigma;
+    };
+
+    /**
+     * @brief Parse a model name
+     *
+     * @param str Name (gbm, cir, vasicek, hull-white)
+     * @return Kind Model type
+     * @throws Exception If the name is unknown
+     */
+    Kind parse(const std::string &str);
+
+    /**
+     * @brief Pretty print a model name
+     *
+     * @param kind Model type
+     * @return const char* Model name
+     */
+    const char *name(Kind kind) noexcept;
+
+    /**
+     * @brief Whether the step of a model is its exact transition, so that a
+     * single step of any length reaches the next date without discretisation
+     * error
+     *
+     * @param kind Model type
+     * @return true GBM, Vasicek and Hull-White
+     * @return false CIR, stepped by Euler
+     */
+    bool exact(Kind kind) noexcept;
+
+    /**
+     * @brief Expectation of a model at a date, under its discretised scheme
+     *
+     * Known in closed form when every step preserves it: the log-Euler step
+     * of GBM and the exact transitions of Vasicek and Hull-White. The
+     * truncated Euler step of CIR has none.
+     *
+     * @param p Parameters
+     * @param x0 Initial value
+     * @param t Date
+     * @param mean Expectation, set if known
+     * @return true The expectation is known
+     * @return false The scheme has no closed-form expectation
+     */
+    bool expectation(const Parameters &p, double x0, double t, double &mean) noexcept;
+
+    /**
+     * @brief Fields of the parameters
+     *
+     */
+    enum class Field
+    {
+        X0,
+        Mu,
+        Kappa,
+        Theta,
+        Sigma
+    };
+
+    /**
+     * @brief Pathwise derivative of a simulated path with respect to a
+     * parameter, through the recursion of the scheme
+     *
+     * The normal samples are recovered from the path itself: from its log
+     * for GBM, from every Euler increment for CIR, whose derivative vanishes
+     * wherever the step is truncated at 0.
+     *
+     * @param p Parameters the path was simulated with
+     * @param field Parameter
+     * @param times Time of every point
+     * @param path Path, starting at p.x0
+     * @param nb_points Number of points
+     * @param tangent Derivative of every point
+     * @return true GBM and CIR
+     * @return false The scheme has no pathwise derivative here
+     */
+    bool tangent(const Parameters &p, Field field, const double *times, const double *path, size_t nb_points, double *tangent) noexcept;
+
+    /**
+     * @brief Math on doubles, for the scalar loops of the CPU and the GPU
+     *
+     */
+    struct ScalarMath
+    {
+        typedef double V;
+
+        XVA_HOST_DEVICE static V set1(double a) { return a; }
+        XVA_HOST_DEVICE static V add(V a, V b) { return a + b; }
+        XVA_HOST_DEVICE static V sub(V a, V b) { return a - b; }
+        XVA_HOST_DEVICE static V mul(V a, V b) { return a * b; }
+        XVA_HOST_DEVICE static V fmadd(V a, V b, V c) { return a * b + c; }
+        XVA_HOST_DEVICE static V max(V a, V b) { return a > b ? a : b; }
+        XVA_HOST_DEVICE static V sqrt(V a) { return ::sqrt(a); }
+        XVA_HOST_DEVICE static V exp(V a) { return ::exp(a); }
+    };
+
+    /**
+     * @brief Geometric Brownian motion, stepped exactly in log space
+     *
+     */
+    struct GBM
+    {
+        /**
+         * @brief Per-step constants
+         *
+         */
+        struct Constants
+        {
+            /**
+             * @brief Log drift, (mu - sigma^2 / 2) dt
+             *
+             */
+            double drift;
+            /**
+             * @brief Log volatility, sigma sqrt(dt)
+             *
+             */
+            double vol;
+        };
+
+        /**
+         * @brief Precompute the per-step constants
+         *
+         * @param p Parameters
+         * @param dt Time step
+         * @return Constants Constants
+         */
+        static Constants precompute(const Parameters &p, double dt)
+        {
+            return Constants{(p.mu - 0.5 * p.sigma * p.sigma) * dt, p.sigma * std::sqrt(dt)};
+        }
+
+        /**
+         * @brief Advance by one step: one exp and one FMA
+         *
+         * @tparam M Math type
+         * @param x Value
+         * @param z Standard normal sample
+         * @param c Constants
+         * @return M::V Next value
+         */
+        template <class M>
+        XVA_HOST_DEVICE static typename M::V step(typename M::V x, typename M::V z, const Constants &c)
+        {
+            return M::mul(x, M::exp(M::fmadd(z, M::set1(c.vol), M::set1(c.drift))));
+        }
+    };
+
+    /**
+     * @brief Square-root diffusion, Euler step floored at zero
+     *
+     */
+    struct CIR
+    {
+        /**
+         * @brief Per-step constants
+         *
+         */
+        struct Constants
+        {
+            /**
+             * @brief Mean reversion per step, kappa dt
+             *
+             */
+            double kappa_dt;
+            /**
+             * @brief Long-term mean
+             *
+             */
+            double theta;
+            /**
+             * @brief Volatility per step, sigma sqrt(dt)
+             *
+             */
+            double vol;
+        };
+
+        /**
+         * @brief Precompute the per-step constants
+         *
+         * @param p Parameters
+         * @param dt Time step
+         * @return Constants Constants
+         */
+        static Constants precompute(const Parameters &p, double dt)
+        {
+            return Constants{p.kappa * dt, p.theta, p.sigma * std::sqrt(dt)};
+        }
+
+        /**
+         * @brief Advance by one step
+         *
+         * @tparam M Math type
+         * @param x Value
+         * @param z Standard normal sample
+         * @param c Constants
+         * @return M::V Next value
+         */
+        template <class M>
+        XVA_HOST_DEVICE static typename M::V step(typename M::V x, typename M::V z, const Constants &c)
+        {
+            typename M::V diffusion = M::mul(M::mul(z, M::set1(c.vol)), M::sqrt(x));
+            typename M::V next = M::fmadd(M::sub(M::set1(c.theta), x), M::set1(c.kappa_dt), M::add(x, diffusion));
+            return M::max(next, M::set1(0.0));
+        }
+    };
+
+    /**
+     * @brief Ornstein-Uhlenbeck process, stepped exactly
+     *
+     */
+    struct Vasicek
+    {
+        /**
+         * @brief Per-step constants, x' = decay x + mean + vol z
+         *
+         */
+        struct Constants
+        {
+            /**
+             * @brief Decay over a step, exp(-kappa dt)
+             *
+             */
+            double decay;
+            /**
+             * @brief Mean reached over a step from zero
+             *
+             */
+            double mean;
+            /**
+             * @brief Standard deviation over a step
+             *
+             */
+            double vol;
+        };
+
+        /**
+         * @brief Precompute the per-step constants
+         *
+         * @param p Parameters
+         * @param dt Time step
+         * @return Constants Constants
+         */
+        static Constants precompute(const Parameters &p, double dt)
+        {
+            if (p.kappa == 0)
+            {
+                return Constants{1.0, 0.0, p.sigma * std::sqrt(dt)};
+            }
+            double decay = std::exp(-p.kappa * dt);
+            return Constants{decay, p.theta * (1 - decay), p.sigma * std::sqrt((1 - decay * decay) / (2 * p.kappa))};
+        }
+
+        /**
+         * @brief Advance by one step: two FMA
+         *
+         * @tparam M Math type
+         * @param x Value
+         * @param z Standard normal sample
+         * @param c Constants
+         * @return M::V Next value
+         */
+        template <class M>
+        XVA_HOST_DEVICE static typename M::V step(typename M::V x, typename M::V z, const Constants &c)
+        {
+            return M::fmadd(x, M::set1(c.decay), M::fmadd(z, M::set1(c.vol), M::set1(c.mean)));
+        }
+    };
+
+    /**
+     * @brief Hull-White short rate with a flat drift level, stepped exactly
+     *
+     * With a flat theta, the process is a Vasicek process of long-term mean
+     * theta / kappa: only the precomputed constants differ.
+     */
+    struct HullWhite : Vasicek
+    {
+        /**
+         * @brief Precompute the per-step constants
+         *
+         * @param p Parameters
+         * @param dt Time step
+         * @return Constants Constants
+         */
+        static Constants precompute(const Parameters &p, double dt)
+        {
+            if (p.kappa == 0)
+            {
+                return Constants{1.0, p.theta * dt, p.sigma * std::sqrt(dt)};
+            }
+            Parameters vasicek = p;
+            vasicek.theta = p.theta / p.kappa;
+            return Vasicek::precompute(vasicek, dt);
+        }
+    };
+
+    /**
+     * @brief Call a visitor with the policy of a model type
+     *
+     * Runtime model selection is resolved once, outside the hot loops.
+     *
+     * @tparam Visitor Callable taking a policy instance
+     * @param kind Model type
+     * @param visitor Visitor
+     */
+    template <class Visitor>
+    void visit(Kind kind, Visitor &&visitor)
+    {
+        switch (kind)
+        {
+        case Kind::GBM:
+            visitor(GBM());
+            break;
+        case Kind::CIR:
+            visitor(CIR());
+            break;
+        case Kind::Vasicek:
+            visitor(Vasicek());
+            break;
+        case Kind::HullWhite:
+            visitor(HullWhite());
+            break;
+        }
+    }
+}
@@ -12,6 +12,17 @@
 #pragma once
 #include "../headers/pch.h"
 #include "../headers/utils.h"
+#include "../headers/path_block.h"
+#include "../headers/thread_pool.h"
+#include "../headers/accumulator.h"
+#include "../headers/rng.h"
+#include "../headers/config.h"
+#include "../headers/correlation.h"
+#include "../headers/qmc.h"
+#include "../headers/sketch.h"
+#include "../headers/time_grid.h"
+#include "../headers/market.h"
+#include "../headers/shard.h"
 
 #include <map>
 
@@ -37,10 +48,17 @@ public:
      * 
      * @param m0 Number of external paths
      * @param m1 Number of internal paths
-     * @param nb_points Number of points
-     * @param T Time horizon
+     * @param grid Simulation points and exposure dates
+     * @param pool Thread pool running every stage
+     * @param config Risk factor models
+     * @param seed Seed of the random streams
+     * @param streaming Fold internal paths into running statistics instead of storing them
      */
-    NMC(double m0, double m1, size_t nb_points, double T) : m0(m0), m1(m1), nb_points(nb_points), T(T) {}
+    NMC(double m0, double m1, const TimeGrid &grid, ThreadPool &pool, const Config &config = Config(), RNG::Seed seed = RNG::default_seed, bool streaming = false)
+        : m0(m0), m1(m1), nb_points(grid.nb_points()), nb_dates(grid.nb_dates()),
+          nb_sets(config.portfolio.empty() ? 1 : config.portfolio.nb_exposure_sets()), T(grid.horizon()), grid(grid), market(config, grid), pool(&pool), config(config), seed(seed), streaming(streaming),
+          correlated(!config.correlation.is_identity()), cholesky(config.correlation.cholesky()),
+          bridge(grid.steps()), shift(importance_shift()) {}
 
     /**
      * @brief Destroy the NMC object
@@ -53,30 +71,114 @@ public:
      * @param xva XVA types
      * @param factor Factor
      * @param external_paths External paths simulated
-     * @param paths Paths simulated
+     * @param paths Path simulated, one value per exposure date
      */
-    virtual void run(XVA xva, double factor, const std::map<ExternalPaths, std::vector<Vector>> &external_paths, Vector& paths) const;
+    virtual void run(XVA xva, double factor, const std::map<ExternalPaths, PathBlock> &external_paths, PathView<double> paths) const;
 
     /**
-     * @brief Generate interrest rate paths
-     * 
-     * @param paths Paths generated
+     * @brief Run the nested Monte Carlo system for several XVA at once.
+     *
+     * The exposure profile is built once and every XVA is evaluated from it
+     * in a single pass. Each row holds the same values as a separate call to
+     * the single XVA run drawing the same random numbers.
+     *
+     * @param xvas XVA types and their factors
+     * @param external_paths External paths simulated
+     * @param paths Paths simulated, one row per XVA in the order of the map,
+     * one value per exposure date
+     * @param errors Monte Carlo standard errors, same layout as paths. Empty
+     * unless internal paths are streamed or the estimator is nested.
+     * @param pfe Potential future exposure, one row per level of
+     * config.pfe_levels. Empty if the estimator has no exposure scenarios.
      */
-    virtual void generate_interest_rate_paths(std::vector<Vector>& paths) const;
+    virtual void run(const std::map<XVA, double> &xvas, const std::map<ExternalPaths, PathBlock> &external_paths, PathBlock &paths, PathBlock &errors, PathBlock &pfe) const;
 
     /**
-     * @brief Generate FX rate paths
+     * @brief Generate the paths of every external risk factor in a single
+     * pass, with the models and the correlation of the configuration
      * 
-     * @param paths Paths generated
+     * @param paths Paths generated, one block per factor, one path per row
+     */
+    virtual void generate_external_paths(std::map<ExternalPaths, PathBlock>& paths) const;
+
+    /**
+     * @brief Draw the correlated standard normal samples of every external
+     * path, before any model evolves them.
+     *
+     * Engines sharing the seed draw the same samples whatever their model
+     * parameters, so the samples can be evolved again by bumped models.
+     *
+     * @param normals Samples, one block per factor, one path per row
+     */
+    void generate_external_normals(std::map<ExternalPaths, PathBlock>& normals) const;
+
+    /**
+     * @brief Evolve the external paths of one factor from their samples.
+     *
+     * Evolving every factor gives the same paths as generate_external_paths.
+     *
+     * @param normals Samples drawn by generate_external_normals
+     * @param paths External paths, the block of the factor being replaced
+     * @param factor Factor
      */
-    virtual void generate_fx_rate_paths(std::vector<Vector>& paths) const;
+    void evolve_external_paths(const std::map<ExternalPaths, PathBlock>& normals, std::map<ExternalPaths, PathBlock>& paths, ExternalPaths factor) const;
 
     /**
-     * @brief Generate equity paths
+     * @brief Compute the pathwise derivatives of several XVA with respect to
+     * model parameters.
+     *
+     * The derivative of every internal path is carried through the
+     * recursion of its scheme, see Models::tangent, then through the
+     * slope of the XVA payoff at the exposure profile. Only the profile
+     * estimator of the synthetic portfolio, with stored internal paths and
+     * without control variates, is differentiated.
+     *
+     * @param xvas XVA types and their factors
+     * @param external_paths External paths
+     * @param parameters Parameters, as the factor owning them, nb_factors
+     * for the internal model, and their field
+     * @param greeks Derivatives, one row per parameter, one value per XVA in
+     * the order of the map, NaN where the scheme has no pathwise derivative
+     * @return true Derivatives computed
+     * @return false The estimator is not differentiated
+     */
+    bool pathwise(const std::map<XVA, double> &xvas, const std::map<ExternalPaths, PathBlock> &external_paths, const std::vector<std::pair<size_t, Models::Field>> &parameters, PathBlock &greeks) const;
+
+    /**
+     * @brief Compute the conditional expectation of the portfolio at every
+     * outer node.
+     * 
+     * values(i, d) estimates E[V(t_N-1) | X(t_d) = X_i(t_d)], V being the
+     * mean of the factors and t_N-1 the last date, from m1 inner paths of the
+     * external models branched from the state of the outer path i at the
+     * exposure date d. Each (outer path, date) pair is a task holding
+     * SIMD::group inner paths per factor at most, so memory is bounded
+     * whatever m1; the work is O(m0 * m1 * nb_dates * nb_points / 2) steps.
      * 
-     * @param paths Paths generated
+     * The trades of a portfolio are valued in closed form at every outer
+     * node instead, without inner paths.
+     * 
+     * @param external_paths External paths
+     * @param values Conditional expectations, one row per outer path, one
+     * value per exposure date and exposure set
      */
-    virtual void generate_equity_paths(std::vector<Vector>& paths) const;
+    virtual void nested_values(const std::map<ExternalPaths, PathBlock> &external_paths, PathBlock &values) const;
+
+    /**
+     * @brief Run the nested estimator over a range of the outer paths, into
+     * the partial statistics of a shard, see Shard::merge.
+     *
+     * The outer paths and their inner paths draw the streams of their
+     * indices, so the shards of a partition of the outer paths hold the
+     * statistics of a single run. Control variates, whose coefficients
+     * need every outer path, are not supported.
+     *
+     * @param xvas XVA types and their factors
+     * @param first First outer path index, a multiple of SIMD::group
+     * @param count Number of outer paths, even with antithetic sampling
+     * @param partial Statistics of the range
+     */
+    void nested_shard(const std::map<XVA, double> &xvas, size_t first, size_t count, Shard::Partial &partial) const;
 
     /**
      * @brief Get the m0 object
@@ -99,6 +201,13 @@ public:
      */
     size_t get_nb_points() const { return nb_points; };
 
+    /**
+     * @brief Get the grid object
+     * 
+     * @return const TimeGrid& grid
+     */
+    const TimeGrid &get_grid() const { return grid; };
+
     /**
      * @brief Get the T object
      * 
@@ -117,21 +226,542 @@ protected:
      */
     double m1;
     /**
-     * @brief Number of points
+     * @brief Number of simulation points
      * 
      */
     size_t nb_points;
+    /**
+     * @brief Number of exposure dates
+     * 
+     */
+    size_t nb_dates;
+    /**
+     * @brief Number of exposure sets valued per scenario, 1 for the
+     * synthetic portfolio. The values of a scenario hold one run of
+     * nb_dates values per exposure set.
+     * 
+     */
+    size_t nb_sets;
     /**
      * @brief Time horizon
      * 
      */
     double T;
+    /**
+     * @brief Simulation points and exposure dates
+     * 
+     */
+    TimeGrid grid;
+    /**
+     * @brief Market curves, tabulated at the exposure dates
+     * 
+     */
+    MarketCurves market;
+    /**
+     * @brief Thread pool running every stage
+     * 
+     */
+    ThreadPool *pool;
+    /**
+     * @brief Risk factor models
+     * 
+     */
+    Config config;
+    /**
+     * @brief Seed of the random streams
+     * 
+     */
+    RNG::Seed seed;
+    /**
+     * @brief Fold internal paths into running statistics instead of storing them
+     * 
+     */
+    bool streaming;
+    /**
+     * @brief Factors are correlated
+     * 
+     */
+    bool correlated;
+    /**
+     * @brief Cholesky factor of the correlation of the factors
+     * 
+     */
+    Cholesky cholesky;
+    /**
+     * @brief Brownian bridge of the quasi-Monte Carlo external paths
+     * 
+     */
+    QMC::BrownianBridge bridge;
+    /**
+     * @brief Drift added to the independent standard normal samples of the
+     * outer paths, one per factor, zero without importance sampling
+     * 
+     */
+    Vector shift;
+    /**
+     * @brief Random stream of a path of a factor
+     * 
+     */
+    typedef std::function<RNG::Stream(ExternalPaths factor, size_t path)> StreamFunction;
+
+    /**
+     * @brief Evolve paths of a model, the loop specialised at compile time
+     * 
+     * @tparam Model Model policy
+     * @param parameters Model parameters
+     * @param x0 Initial value
+     * @param first Simulation point of the start of the paths
+     * @param count Number of paths
+     * @param length Number of points per path
+     * @param paths First path, holding its standard normal samples
+     * @param stride Distance between two paths, in elements
+     */
+    template <class Model, typename Real>
+    void evolve(const Models::Parameters &parameters, double x0, size_t first, size_t count, size_t length, Real *paths, size_t stride) const;
+
+    /**
+     * @brief Evolve paths of a model from their own initial values
+     * 
+     * @tparam Model Model policy
+     * @param parameters Model parameters
+     * @param first Simulation point of the start of the paths
+     * @param count Number of paths
+     * @param length Number of points per path
+     * @param paths First path, holding its initial value and its standard
+     * normal samples
+     * @param stride Distance between two paths, in elements
+     */
+    template <class Model, typename Real>
+    void evolve(const Models::Parameters &parameters, size_t first, size_t count, size_t length, Real *paths, size_t stride) const;
+
+    /**
+     * @brief Fill consecutive paths of every factor with correlated standard
+     * normal samples
+     * 
+     * @param stream Random stream of the path i of a factor, i < count
+     * @param count Number of paths
+     * @param paths Paths, one block per factor
+     * @param row Row of the first path in the blocks
+     * @param length Number of points per path
+     */
+    template <typename Real>
+    void draw_correlated_normals(const StreamFunction &stream, size_t count, std::map<ExternalPaths, BasicPathBlock<Real>>& paths, size_t row, size_t length) const;
+
+    /**
+     * @brief Fill consecutive external paths of every factor with their
+     * independent standard normal samples, shifted by the measure change
+     * 
+     * @param first Index of the first path
+     * @param count Number of paths
+     * @param paths Paths, one block per factor
+     * @param row Row of the first path in the blocks
+     */
+    void draw_external_normals(size_t first, size_t count, std::map<ExternalPaths, PathBlock>& paths, size_t row) const;
+
+    /**
+     * @brief Fill consecutive external paths of every factor with
+     * independent standard normal samples from scrambled Sobol points.
+     * 
+     * Outer path i is the point i / R of the replicate i % R, R being
+     * config.qmc_replicates. The samples of a path are laid out by a
+     * Brownian bridge, the leading Sobol dimensions setting its coarse shape.
+     * 
+     * @param first Index of the first path
+     * @param count Number of paths
+     * @param paths Paths, one block per factor
+     * @param row Row of the first path in the blocks
+     */
+    void draw_qmc_normals(size_t first, size_t count, std::map<ExternalPaths, PathBlock>& paths, size_t row) const;
+
+    /**
+     * @brief Correlate the standard normal samples of consecutive paths of
+     * every factor, step by step
+     * 
+     * @param count Number of paths
+     * @param paths Paths, one block per factor
+     * @param row Row of the first path in the blocks
+     * @param length Number of points per path
+     */
+    template <typename Real>
+    void correlate(size_t count, std::map<ExternalPaths, BasicPathBlock<Real>>& paths, size_t row, size_t length) const;
+
+    /**
+     * @brief Run a task per group of paths evolved together in SIMD lanes
+     * 
+     * @param nb_paths Number of paths
+     * @param body Task, called with path ranges aligned on SIMD::group
+     */
+    void for_each_lane_group(size_t nb_paths, const ThreadPool::RangeFunction &body) const;
+
+    /**
+     * @brief Map a path index to the index of its random stream
+     * 
+     * With antithetic sampling, the path 2p + 1 draws the negated samples of
+     * the stream of the path 2p.
+     * 
+     * @param index Path index, replaced by the index of its stream
+     * @return true The samples are negated
+     * @return false The path draws its own stream
+     */
+    bool antithetic(size_t &index) const;
+
+    /**
+     * @brief Fill a path with the standard normal samples of its steps.
+     * 
+     * path[j] receives the sample of step j, for j >= 1. Generators then
+     * evolve the path in place, reading each sample before overwriting it.
+     * 
+     * @param stream Random stream of the path
+     * @param path Path to fill
+     */
+    void draw_normals(const RNG::Stream &stream, PathView<double> path) const;
+
+    /**
+     * @brief Fill a float path with the standard normal samples of its
+     * steps, drawn in double then rounded, so a float path follows the
+     * double path of the same stream.
+     * 
+     * @param stream Random stream of the path
+     * @param path Path to fill
+     */
+    void draw_normals(const RNG::Stream &stream, PathView<float> path) const;
+
+    /**
+     * @brief Sum the portfolio at the last date over consecutive inner paths
+     * branched from one outer node, see nested_values.
+     * 
+     * Inner path k of factor f branched at the point j of the outer path i
+     * draws from the stream (f + nb_factors * (j + 1), i, k + 1), disjoint
+     * from the streams of the external and internal paths.
+     * 
+     * @param external_paths External paths
+     * @param row Row of the outer path in the external blocks
+     * @param outer Outer path index
+     * @param point Simulation point of the branching
+     * @param first First inner path index
+     * @param count Number of inner paths
+     * @param inner_paths Scratch, SIMD::group paths per factor
+     * @param sum_squares Increased by the sum of the squared portfolio
+     * values, if not null
+     * @return double Sum of the portfolio values
+     */
+    double inner_sum(const std::map<ExternalPaths, PathBlock> &external_paths, size_t row, size_t outer, size_t point, size_t first, size_t count, std::map<ExternalPaths, PathBlock> &inner_paths, double *sum_squares = nullptr) const;
+
+    /**
+     * @brief Add the portfolio at the last date of one inner path branched
+     * from each of consecutive outer nodes at the same date.
+     * 
+     * Same streams as inner_sum: the inner paths of several outer paths
+     * share the SIMD lanes, which stay full whatever the number of inner
+     * paths per node.
+     * 
+     * @param external_paths External paths
+     * @param row Row of the first outer path in the external blocks
+     * @param outer First outer path index
+     * @param count Number of outer paths
+     * @param point Simulation point of the branching
+     * @param inner Inner path index
+     * @param inner_paths Scratch, SIMD::group paths per factor
+     * @param values Portfolio values, values[r] being increased for the outer
+     * path outer + r
+     */
+    void branch(const std::map<ExternalPaths, PathBlock> &external_paths, size_t row, size_t outer, size_t count, size_t point, size_t inner, std::map<ExternalPaths, PathBlock> &inner_paths, double *values) const;
+
+    /**
+     * @brief Generate consecutive external paths of every factor
+     * 
+     * @param first First outer path index
+     * @param count Number of paths
+     * @param paths External paths, one block per factor
+     * @param row Row of the first path in the blocks
+     */
+    void generate_external_paths(size_t first, size_t count, std::map<ExternalPaths, PathBlock> &paths, size_t row) const;
+
+    /**
+     * @brief Compute the value of an XVA at one date from the exposure
+     *
+     * @param xva XVA type
+     * @param factor Factor
+     * @param value Exposure at this date
+     * @param weight Weight of the XVA at this date, see MarketCurves
+     * @return double XVA value
+     */
+    static double xva_value(XVA xva, double factor, double value, double weight);
+
+    /**
+     * @brief Compute the derivative of xva_value with respect to the
+     * exposure, 0 at the kink
+     *
+     * @param xva XVA type
+     * @param factor Factor
+     * @param value Exposure at this date
+     * @param weight Weight of the XVA at this date
+     * @return double Slope of the XVA value
+     */
+    static double xva_slope(XVA xva, double factor, double value, double weight);
+
+    /**
+     * @brief Compute the value of an XVA at one date from the values of
+     * every exposure set, the sum of their XVA values: exposure sets do not
+     * net against each other
+     *
+     * @param xva XVA type
+     * @param factor Factor
+     * @param values Value of the first exposure set at this date, the next
+     * sets following nb_dates apart
+     * @param weight Weight of the XVA at this date
+     * @return double XVA value
+     */
+    double payoff(XVA xva, double factor, const double *values, double weight) const;
+
+    /**
+     * @brief Compute the exposure at one date whose quantiles are the
+     * potential future exposure: the value of the synthetic portfolio, or
+     * the sum of the positive values of the exposure sets
+     *
+     * @param values Value of the first exposure set at this date, the next
+     * sets following nb_dates apart
+     * @return double Exposure
+     */
+    double exposure(const double *values) const;
+
+    /**
+     * @brief Apply the XVA payoff to conditional expectations and average
+     * them over the outer paths
+     * 
+     * With control variates, the payoff of every outer path is corrected by
+     * the part of its portfolio value whose expectation is known in closed
+     * form, with the regression coefficient of every date. The variance
+     * reduction of each technique is reported.
+     * 
+     * @param xvas XVA types and their factors
+     * @param external_paths External paths, one row per outer path
+     * @param values Conditional expectations, one row per outer path
+     * @param paths Paths simulated, one row per XVA in the order of the map
+     * @param errors Monte Carlo standard errors, same layout as paths
+     * @param pfe Potential future exposure of the conditional portfolio
+     * values, one row per level
+     */
+    void reduce_nested(const std::map<XVA, double> &xvas, const std::map<ExternalPaths, PathBlock> &external_paths, const PathBlock &values, PathBlock &paths, PathBlock &errors, PathBlock &pfe) const;
+
+    /**
+     * @brief Sketch the quantiles of paths, date by date, into the
+     * potential future exposure.
+     * 
+     * Fixed chunks of paths are sketched in parallel and merged in order,
+     * so the result does not depend on the threads, and at most a wave of
+     * partial sketches is kept at once: memory is O(nb_dates * compression)
+     * whatever the number of paths.
+     * 
+     * @param nb_paths Number of paths
+     * @param fill Write the path i and the weights of its exposure dates
+     * @param pfe Quantiles, one row per level of config.pfe_levels
+     */
+    void sketch_paths(size_t nb_paths, const std::function<void(size_t i, double *path, double *weights)> &fill, PathBlock &pfe) const;
+
+    /**
+     * @brief Compute the likelihood ratio of the outer paths at every
+     * exposure date
+     * 
+     * The ratio of a date only involves the steps up to it, redrawn from the
+     * counters of the outer paths. All ones without importance sampling.
+     * 
+     * @param first First outer path index
+     * @param nb_outer Number of outer paths
+     * @param weights Likelihood ratios, one row per outer path
+     */
+    void likelihood_ratios(size_t first, size_t nb_outer, PathBlock &weights) const;
+
+    /**
+     * @brief Compute the conditional expectations of consecutive outer
+     * paths, see nested_values
+     *
+     * @param external_paths External paths, their row r being the outer
+     * path first + r
+     * @param first First outer path index
+     * @param values Conditional expectations, one row per outer path
+     */
+    void nested_range(const std::map<ExternalPaths, PathBlock> &external_paths, size_t first, PathBlock &values) const;
+
+    /**
+     * @brief Fold the XVA payoff of consecutive outer paths into the
+     * estimates of their quasi-Monte Carlo replicates, antithetic pairs
+     * being folded as their mean
+     *
+     * @param xva XVA type
+     * @param factor Factor
+     * @param values Conditional expectations, one row per outer path
+     * @param weights Likelihood ratios, same layout as values
+     * @param first Index of the first outer path
+     * @param controls Control of every outer path, nullptr without control
+     * variates
+     * @param beta Control variate coefficient of every date
+     * @param expectations Expectation of the control at every date
+     * @param estimates Estimate of every replicate
+     */
+    void fold_payoffs(XVA xva, double factor, const PathBlock &values, const PathBlock &weights, size_t first, const PathBlock *controls, const Vector &beta, const Vector &expectations, PathAccumulator *estimates) const;
+
 private:
     /**
-     * @brief Generate internal paths
+     * @brief Generate the internal paths of every factor
+     * 
+     * @tparam Real Element type of the internal paths
+     * @param external_paths External paths
+     * @param paths Internal paths, one block per factor
+     */
+    template <typename Real>
+    void generate_internal_paths(const std::map<ExternalPaths, PathBlock>& external_paths, std::map<ExternalPaths, BasicPathBlock<Real>>& paths) const;
+
+    /**
+     * @brief Generate consecutive internal paths of every factor, several per register
+     * 
+     * @tparam Real Element type of the internal paths
+     * @param external_paths External paths
+     * @param first First internal path index
+     * @param count Number of internal paths
+     * @param paths Internal paths, one block per factor
+     * @param row Row of the first internal path in the blocks
+     */
+    template <typename Real>
+    void generate_internal_paths(const std::map<ExternalPaths, PathBlock>& external_paths, size_t first, size_t count, std::map<ExternalPaths, BasicPathBlock<Real>>& paths, size_t row) const;
+
+    /**
+     * @brief Run the conditional nested estimator for several XVA.
+     * 
+     * The XVA payoff is applied to the conditional expectation of every
+     * outer node, then averaged over the outer paths, the standard errors
+     * coming from the spread of the outer paths.
+     * 
+     * @param xvas XVA types and their factors
+     * @param external_paths External paths simulated
+     * @param paths Paths simulated, one row per XVA in the order of the map
+     * @param errors Monte Carlo standard errors, same layout as paths
+     * @param pfe Potential future exposure, one row per level
+     */
+    void run_nested(const std::map<XVA, double> &xvas, const std::map<ExternalPaths, PathBlock> &external_paths, PathBlock &paths, PathBlock &errors, PathBlock &pfe) const;
+
+
+    /**
+     * @brief Compute the exposure profile: the mean internal path of every
+     * factor, averaged over the factors, or the mean value of the portfolio
+     * along the internal paths if it holds trades
+     * 
+     * @param external_paths External paths
+     * @param path Exposure profile, one value per exposure date and exposure
+     * set
+     * @param standard_error Standard error of the profile, empty unless
+     * internal paths are streamed
+     * @param pfe Potential future exposure of the internal paths, one row
+     * per level
+     */
+    void compute_exposure(const std::map<ExternalPaths, PathBlock> &external_paths, Vector &path, Vector &standard_error, PathBlock &pfe) const;
+
+    /**
+     * @brief Compute the exposure profile from stored internal paths: the
+     * mean internal path of every factor, averaged over the factors
+     * 
+     * @tparam Real Element type of the internal paths
+     * @tparam Sum Element type of the sums of the means
+     * @param external_paths External paths
+     * @param path Exposure profile, one value per exposure date
+     * @param pfe Potential future exposure of the internal paths, one row
+     * per level
+     */
+    template <typename Real, typename Sum>
+    void mean_exposure(const std::map<ExternalPaths, PathBlock> &external_paths, Vector &path, PathBlock &pfe) const;
+
+    /**
+     * @brief Value the trades of the portfolio along consecutive paths at
+     * every exposure date
+     * 
+     * @param paths Paths of every external factor
+     * @param row First path
+     * @param count Number of paths
+     * @param values Values, one row per path, one value per exposure date
+     * and exposure set
+     * @param value_row Row of the first path in values
+     */
+    void portfolio_values(const std::map<ExternalPaths, PathBlock> &paths, size_t row, size_t count, PathBlock &values, size_t value_row) const;
+
+    /**
+     * @brief Choose the drift shift of the outer paths
+     * 
+     * The sensitivities of the portfolio value at the horizon to every
+     * normal sample, by finite differences around the path with zero
+     * samples, give a linear model of the portfolio. The automatic shift is
+     * the smallest constant drift moving its mean to the PFE quantile; the
+     * cross-entropy method then refines it on pilot paths.
+     * 
+     * @return Vector Drift, one per factor
+     * @throws Exception If the estimator does not reduce weighted outer paths
+     */
+    Vector importance_shift() const;
+
+    /**
+     * @brief Refine a drift shift by the cross-entropy method: the new drift
+     * is the weighted mean of the normal samples of the pilot paths beyond
+     * the PFE quantile of the portfolio value at the horizon
+     * 
+     * @param drift Drift, one per factor, refined in place
+     */
+    void cross_entropy(Vector &drift) const;
+
+    /**
+     * @brief Print the peak of the highest potential future exposure, and
+     * the relative error of its tail probability against plain sampling
+     * 
+     * @param values Conditional expectations, one row per outer path
+     * @param weights Likelihood ratios, same layout as values
+     * @param pfe Potential future exposure, one row per level
+     */
+    void report_pfe(const PathBlock &values, const PathBlock &weights, const PathBlock &pfe) const;
+
+    /**
+     * @brief Compute the exposure profile from the expectation of the
+     * internal model, the control variate of the mean internal paths.
+     * 
+     * The profile is linear in the internal paths, so the optimal control
+     * variate of their mean is their expectation itself, and no internal
+     * path needs to be simulated.
+     * 
+     * @param external_paths External paths
+     * @param path Exposure profile, one value per exposure date
+     * @return true The internal model has a closed-form expectation
+     * @return false The profile has to be simulated
+     */
+    bool analytic_exposure(const std::map<ExternalPaths, PathBlock> &external_paths, Vector &path) const;
+
+    /**
+     * @brief Get the control variate of the outer paths: the part of their
+     * portfolio value driven by the external models with a closed-form
+     * expectation
+     * 
+     * @param external_paths External paths
+     * @param controls Control, one row per outer path
+     * @param expectations Expectation of the control, one value per exposure
+     * date
+     * @return true Some external model has a closed-form expectation
+     * @return false No control is available
+     */
+    bool outer_controls(const std::map<ExternalPaths, PathBlock> &external_paths, PathBlock &controls, Vector &expectations) const;
+
+    /**
+     * @brief Compute the exposure profile without storing internal paths.
+     * 
+     * Each internal path is generated and folded into running per-date
+     * statistics, so memory is O(nb_points) per task instead of O(m1 * nb_points).
+     * The internal paths and the combination of their factors are held in
+     * Real and Sum, the running statistics in double.
      * 
+     * @tparam Real Element type of the internal paths
+     * @tparam Sum Element type of the samples of the profile
      * @param external_paths External paths
-     * @param paths Internal paths
+     * @param path Exposure profile, one value per exposure date and exposure
+     * set
+     * @param standard_error Standard error of the profile
+     * @param pfe Potential future exposure of the internal paths, one row
+     * per level
      */
-    void generate_internal_paths(const Matrix& external_paths, Matrix& paths) const;
+    template <typename Real, typename Sum>
+    void stream_exposure(const std::map<ExternalPaths, PathBlock> &external_paths, Vector &path, Vector &standard_error, PathBlock &pfe) const;
 };
\ No newline at end of file
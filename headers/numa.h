@@ -0,0 +1,165 @@
+/**
+ * @file numa.h
+ * @author Thomas Roiseux (thomas.roiseux@mathquantlab.com)
+ * @brief Provides the NUMA topology, thread pinning and huge page allocations
+ * @version 1.0
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+
+#pragma once
+
+#include "../headers/pch.h"
+
+#include <string>
+#include <vector>
+
+/**
+ * @brief NUMA topology, thread pinning and placement of the path buffers
+ *
+ * Large blocks are mapped directly from the kernel, so none of their pages is
+ * touched at allocation: each page lands on the node of the thread writing
+ * it first, the worker generating its paths. The thread pool spreads its
+ * workers and the chunks of every range over the nodes in the same
+ * contiguous blocks, so the chunk generating a path and the chunk reducing
+ * it later run on the same node. On other systems than Linux, or without
+ * /sys, there is a single node and no pinning.
+ */
+namespace NUMA
+{
+    /**
+     * @brief Huge page policies of the large blocks
+     *
+     */
+    enum Pages
+    {
+        /**
+         * @brief Pages of the system, transparent huge pages only if the
+         * kernel enables them always
+         *
+         */
+        Default,
+        /**
+         * @brief Transparent huge pages requested with madvise
+         *
+         */
+        Transparent,
+        /**
+         * @brief Pages of the hugetlbfs pool, transparent huge pages if it is
+         * empty or its pages, read from /proc/meminfo, are not of huge_page
+         *
+         */
+        Explicit
+    };
+
+    /**
+     * @brief Size of a huge page, and smallest block mapped directly
+     *
+     */
+    constexpr size_t huge_page = size_t(2) << 20;
+
+    /**
+     * @brief NUMA node
+     *
+     */
+    struct Node
+    {
+        /**
+         * @brief Node number
+         *
+         */
+        unsigned id;
+        /**
+         * @brief CPUs of the node the process may run on
+         *
+         */
+        std::vector<unsigned> cpus;
+    };
+
+    /**
+     * @brief Get the nodes, read once from /sys/devices/system/node
+     *
+     * @return const std::vector<Node>& Nodes with at least one allowed CPU,
+     * a single node holding every CPU if the topology is unknown
+     */
+    const std::vector<Node> &nodes();
+
+    /**
+     * @brief Pin the calling thread to the CPUs of a node
+     *
+     * @param node Node
+     * @return true Thread pinned
+     * @return false Pinning is not supported
+     */
+    bool pin(const Node &node) noexcept;
+
+    /**
+     * @brief Enable the pinning of the workers of the thread pools created
+     * from now on, one block of workers per node
+     *
+     * @param enabled Pin the workers
+     */
+    void select_pinning(bool enabled) noexcept;
+
+    /**
+     * @brief Check if the workers are pinned
+     *
+     * @return true Workers pinned to their node
+     * @return false Workers scheduled by the system
+     */
+    bool pinning() noexcept;
+
+    /**
+     * @brief Select the huge page policy of the blocks allocated from now on
+     *
+     * @param pages Policy
+     */
+    void select_pages(Pages pages) noexcept;
+
+    /**
+     * @brief Get the huge page policy
+     *
+     * @return Pages Policy
+     */
+    Pages pages() noexcept;
+
+    /**
+     * @brief Parse a huge page policy
+     *
+     * @param str "none", "transparent" or "explicit"
+     * @return Pages Policy
+     * @throws Exception If the policy is unknown
+     */
+    Pages parse_pages(const std::string &str);
+
+    /**
+     * @brief Get the name of a huge page policy
+     *
+     * @param pages Policy
+     * @return const char* Name
+     */
+    const char *pages_name(Pages pages) noexcept;
+
+    /**
+     * @brief Allocate a buffer. Blocks of a huge page at least are mapped
+     * directly, aligned on a huge page and zero-filled by the kernel, with
+     * the pages of the policy; smaller ones come from the heap.
+     *
+     * @param size Size in bytes
+     * @param alignment Alignment of a heap buffer
+     * @param mapped Set if the buffer is mapped, and already zero-filled
+     * @return void* Buffer, nullptr if the allocation fails
+     */
+    void *allocate(size_t size, size_t alignment, bool &mapped) noexcept;
+
+    /**
+     * @brief Free a buffer allocated by allocate
+     *
+     * @param ptr Buffer
+     * @param size Size in bytes, as allocated
+     * @param mapped Buffer is mapped
+     */
+    void release(void *ptr, size_t size, bool mapped) noexcept;
+}
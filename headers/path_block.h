@@ -0,0 +1,309 @@
+/**
+ * @file path_block.h
+ * @author Thomas Roiseux (thomas.roiseux@mathquantlab.com)
+ * @brief Provides contiguous storage for simulated paths
+ * @version 1.0
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+
+#pragma once
+
+#include "../headers/pch.h"
+
+/**
+ * @brief View over a single path (contiguous in memory)
+ *
+ * @tparam T Element type
+ */
+template <typename T>
+class PathView
+{
+public:
+    /**
+     * @brief Construct a new PathView object
+     *
+     * @param data First element of the path
+     * @param size Number of points
+     */
+    PathView(T *data, size_t size) noexcept : m_data(data), m_size(size) {}
+
+    /**
+     * @brief Access a point of the path
+     *
+     * @param i Point index
+     * @return T& Point value
+     */
+    T &operator[](size_t i) const noexcept { return m_data[i]; }
+
+    /**
+     * @brief Get the number of points
+     *
+     * @return size_t Number of points
+     */
+    size_t size() const noexcept { return m_size; }
+
+    /**
+     * @brief Get the underlying data
+     *
+     * @return T* First element of the path
+     */
+    T *data() const noexcept { return m_data; }
+
+    /**
+     * @brief Iterator on the first point
+     *
+     * @return T* First point
+     */
+    T *begin() const noexcept { return m_data; }
+
+    /**
+     * @brief Iterator past the last point
+     *
+     * @return T* Past the last point
+     */
+    T *end() const noexcept { return m_data + m_size; }
+
+private:
+    T *m_data;
+    size_t m_size;
+};
+
+/**
+ * @brief View over one time step of every path (strided in memory)
+ *
+ * @tparam T Element type
+ */
+template <typename T>
+class TimeSliceView
+{
+public:
+    /**
+     * @brief Construct a new TimeSliceView object
+     *
+     * @param data Value of the first path at this time step
+     * @param size Number of paths
+     * @param stride Distance between two consecutive paths, in elements
+     */
+    TimeSliceView(T *data, size_t size, size_t stride) noexcept : m_data(data), m_size(size), m_stride(stride) {}
+
+    /**
+     * @brief Access the value of a path at this time step
+     *
+     * @param i Path index
+     * @return T& Path value
+     */
+    T &operator[](size_t i) const noexcept { return m_data[i * m_stride]; }
+
+    /**
+     * @brief Get the number of paths
+     *
+     * @return size_t Number of paths
+     */
+    size_t size() const noexcept { return m_size; }
+
+private:
+    T *m_data;
+    size_t m_size;
+    size_t m_stride;
+};
+
+/**
+ * @brief Block of paths stored in a single aligned allocation
+ *
+ * Paths are laid out [path][time]. Each path starts on a cache line: the
+ * stride between two paths is the number of points rounded up to a full
+ * cache line. Blocks of a huge page at least are mapped untouched, see
+ * NUMA::allocate.
+ *
+ * @tparam Real Element type, double or float
+ */
+template <typename Real>
+class BasicPathBlock
+{
+public:
+    /**
+     * @brief Alignment of the block and of each path, in bytes
+     *
+     */
+    static constexpr size_t alignment = 64;
+
+    /**
+     * @brief Construct an empty block
+     *
+     */
+    BasicPathBlock() noexcept : m_data(nullptr), m_nb_paths(0), m_nb_points(0), m_stride(0), m_mapped(false) {}
+
+    /**
+     * @brief Construct a new block, filled with zeros
+     *
+     * @param nb_paths Number of paths
+     * @param nb_points Number of points per path
+     */
+    BasicPathBlock(size_t nb_paths, size_t nb_points);
+
+    /**
+     * @brief Copy a block
+     *
+     * @param other Block to copy
+     */
+    BasicPathBlock(const BasicPathBlock &other);
+
+    /**
+     * @brief Move a block
+     *
+     * @param other Block to move
+     */
+    BasicPathBlock(BasicPathBlock &&other) noexcept;
+
+    /**
+     * @brief Copy assignment
+     *
+     * @param other Block to copy
+     * @return BasicPathBlock& This block
+     */
+    BasicPathBlock &operator=(const BasicPathBlock &other);
+
+    /**
+     * @brief Move assignment
+     *
+     * @param other Block to move
+     * @return BasicPathBlock& This block
+     */
+    BasicPathBlock &operator=(BasicPathBlock &&other) noexcept;
+
+    /**
+     * @brief Destroy the block
+     *
+     */
+    ~BasicPathBlock();
+
+    /**
+     * @brief Resize the block. The content is discarded and filled with zeros.
+     *
+     * A heap buffer of the same size is reused and cleared. A mapped buffer
+     * is mapped again, so its pages stay untouched until the threads writing
+     * them place them.
+     *
+     * @param nb_paths Number of paths
+     * @param nb_points Number of points per path
+     */
+    void resize(size_t nb_paths, size_t nb_points);
+
+    /**
+     * @brief Get the number of paths
+     *
+     * @return size_t Number of paths
+     */
+    size_t nb_paths() const noexcept { return m_nb_paths; }
+
+    /**
+     * @brief Get the number of points per path
+     *
+     * @return size_t Number of points
+     */
+    size_t nb_points() const noexcept { return m_nb_points; }
+
+    /**
+     * @brief Get the distance between two paths, in elements
+     *
+     * @return size_t Stride
+     */
+    size_t stride() const noexcept { return m_stride; }
+
+    /**
+     * @brief Check if the block holds no path
+     *
+     * @return true Block is empty
+     * @return false Block holds at least one path
+     */
+    bool empty() const noexcept { return m_nb_paths == 0 || m_nb_points == 0; }
+
+    /**
+     * @brief Access a point of a path
+     *
+     * @param path Path index
+     * @param point Point index
+     * @return Real& Point value
+     */
+    Real &operator()(size_t path, size_t point) noexcept { return m_data[path * m_stride + point]; }
+
+    /**
+     * @brief Access a point of a path
+     *
+     * @param path Path index
+     * @param point Point index
+     * @return Real Point value
+     */
+    Real operator()(size_t path, size_t point) const noexcept { return m_data[path * m_stride + point]; }
+
+    /**
+     * @brief Get a view over a single path
+     *
+     * @param i Path index
+     * @return PathView<Real> Path view
+     */
+    PathView<Real> path(size_t i) noexcept { return PathView<Real>(m_data + i * m_stride, m_nb_points); }
+
+    /**
+     * @brief Get a view over a single path
+     *
+     * @param i Path index
+     * @return PathView<const Real> Path view
+     */
+    PathView<const Real> path(size_t i) const noexcept { return PathView<const Real>(m_data + i * m_stride, m_nb_points); }
+
+    /**
+     * @brief Get a view over one time step of every path
+     *
+     * @param j Point index
+     * @return TimeSliceView<Real> Time slice view
+     */
+    TimeSliceView<Real> time_slice(size_t j) noexcept { return TimeSliceView<Real>(m_data + j, m_nb_paths, m_stride); }
+
+    /**
+     * @brief Get a view over one time step of every path
+     *
+     * @param j Point index
+     * @return TimeSliceView<const Real> Time slice view
+     */
+    TimeSliceView<const Real> time_slice(size_t j) const noexcept { return TimeSliceView<const Real>(m_data + j, m_nb_paths, m_stride); }
+
+    /**
+     * @brief Get the underlying data
+     *
+     * @return Real* First element of the block
+     */
+    Real *data() noexcept { return m_data; }
+
+    /**
+     * @brief Get the underlying data
+     *
+     * @return const Real* First element of the block
+     */
+    const Real *data() const noexcept { return m_data; }
+
+private:
+    Real *m_data;
+    size_t m_nb_paths;
+    size_t m_nb_points;
+    size_t m_stride;
+    bool m_mapped;
+};
+
+/**
+ * @brief Block of paths in double
+ *
+ */
+typedef BasicPathBlock<double> PathBlock;
+
+/**
+ * @brief Block of paths in float, half the memory traffic of PathBlock
+ *
+ */
+typedef BasicPathBlock<float> FloatPathBlock;
+
+extern template class BasicPathBlock<double>;
+extern template class BasicPathBlock<float>;
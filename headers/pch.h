@@ -11,9 +11,6 @@
 
 #pragma once
 
-#include <cuda.h>
-#include <cuda_runtime.h>
-
 #include <string>
 #include <stdexcept>
 #include <exception>
@@ -21,100 +18,4 @@
 #include <filesystem>
 #include <map>
 
-/**
- * @brief Exception class
- *
- */
-class Exception : public std::exception
-{
-public:
-    /**
-     * @brief Construct a new Exception object
-     *
-     * @param message Exception message
-     */
-    Exception(const std::string &message) : m_message(message) {}
-
-    /**
-     * @brief Destroy the Exception object
-     *
-     */
-    virtual ~Exception() = default;
-
-    /**
-     * @brief Get the exception message
-     *
-     * @return const char* Exception message
-     */
-    virtual const char *what() const noexcept override { return m_message.c_str(); }
-
-protected:
-    std::string m_message;
-};
-
-/**
- * @brief XVA types
- * 
- */
-enum XVA
-{
-    /**
-     * @brief Credit Valuation Adjustment
-     * 
-     */
-    CVA,
-    /**
-     * @brief Debit Valuation Adjustment
-     * 
-     */
-    DVA,
-    /**
-     * @brief Funding Valuation Adjustment
-     * 
-     */
-    FVA,
-    /**
-     * @brief Margin Valuation Adjustment
-     * 
-     */
-    MVA,
-    /**
-     * @brief Capital Valuation Adjustment
-     * 
-     */
-    KVA
-};
-
-/**
- * @brief Vector type for double
- * 
- */
-typedef std::vector<double> Vector;
-
-/**
- * @brief Matrix type for double
- * 
- */
-typedef std::vector<Vector> Matrix;
-
-/**
- * @brief External paths
- * 
- */
-enum ExternalPaths {
-    /**
-     * @brief Interest rate
-     * 
-     */
-    Interest,
-    /**
-     * @brief FX
-     * 
-     */
-    FX,
-    /**
-     * @brief Equity
-     * 
-     */
-    Equity
-};
\ No newline at end of file
+#include "../headers/types.h"
@@ -0,0 +1,183 @@
+/**
+ * @file portfolio.h
+ * @author Thomas Roiseux (thomas.roiseux@mathquantlab.com)
+ * @brief Provides the portfolio of trades of a counterparty
+ * @version 1.0
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+
+#pragma once
+
+#include "../headers/pch.h"
+#include "../headers/path_block.h"
+#include "../headers/simd.h"
+
+#include <map>
+#include <vector>
+#include <string>
+
+/**
+ * @brief Trades of a counterparty, grouped into netting sets and collateral
+ * sets
+ *
+ * Trades are stored structure-of-arrays by product type, and valued by the
+ * vectorised kernels of SIMD over a batch of scenarios at once:
+ * - swaps on the interest rate, notional * (r - fixed rate) * (maturity - t),
+ * - FX forwards, notional * (X - forward rate) until maturity,
+ * - European equity calls and puts, by Black-Scholes with the scenario rate.
+ *
+ * The values of the trades of a netting set are added up. A collateral set
+ * gathers netting sets under one margin agreement: their net value is
+ * collateralised down to [-threshold, threshold]. The exposure sets are the
+ * collateral sets, then the uncollateralised netting sets: the portfolio is
+ * valued once per exposure set, and no value nets against another, the
+ * exposure of the counterparty being the sum of their exposures.
+ *
+ * A portfolio file holds one line per trade, '#' starting a comment:
+ * "swap|fx_forward|call|put, <netting set>, <notional>, <strike>, <maturity>",
+ * and one line per collateral set: "collateral, <collateral set>,
+ * <threshold>, <netting set>[, <netting set>...]".
+ */
+class Portfolio
+{
+public:
+    /**
+     * @brief Load a portfolio file, adding its trades
+     *
+     * @param filename Portfolio file
+     * @throws Exception If the file cannot be read or holds an invalid line
+     */
+    void load(const std::string &filename);
+
+    /**
+     * @brief Check if the portfolio holds no trade
+     *
+     * @return true No trade, the engine valuing its synthetic portfolio
+     * @return false At least one trade
+     */
+    bool empty() const noexcept { return nb_trades() == 0; }
+
+    /**
+     * @brief Get the number of trades
+     *
+     * @return size_t Number of trades
+     */
+    size_t nb_trades() const noexcept { return m_swaps.size() + m_forwards.size() + m_options.size(); }
+
+    /**
+     * @brief Get the number of netting sets
+     *
+     * @return size_t Number of netting sets
+     */
+    size_t nb_netting_sets() const noexcept { return m_netting_sets.size(); }
+
+    /**
+     * @brief Get the number of collateral sets
+     *
+     * @return size_t Number of collateral sets
+     */
+    size_t nb_collateral_sets() const noexcept { return m_thresholds.size(); }
+
+    /**
+     * @brief Get the number of exposure sets: the collateral sets and the
+     * uncollateralised netting sets
+     *
+     * @return size_t Number of exposure sets
+     */
+    size_t nb_exposure_sets() const noexcept;
+
+    /**
+     * @brief Value every exposure set of the portfolio in consecutive
+     * scenarios at one date
+     *
+     * @param paths Paths of every external factor
+     * @param row First scenario
+     * @param count Number of scenarios
+     * @param point Point of the date in the paths
+     * @param t Date
+     * @param volatility Volatility of the equity
+     * @param values Values, values[r * stride + e * set_stride] for the
+     * scenario row + r and the exposure set e
+     * @param stride Distance between two scenarios
+     * @param set_stride Distance between two exposure sets
+     */
+    void value(const std::map<ExternalPaths, PathBlock> &paths, size_t row, size_t count, size_t point, double t, double volatility, double *values, size_t stride, size_t set_stride) const;
+
+private:
+    /**
+     * @brief Product types
+     *
+     */
+    enum Product
+    {
+        Swap,
+        Forward,
+        Option
+    };
+
+    /**
+     * @brief Trades of one product type
+     *
+     */
+    struct Trades
+    {
+        Vector notional;
+        Vector strike;
+        Vector maturity;
+        Vector sign;
+        std::vector<uint32_t> sets;
+        /**
+         * @brief Term of every trade of a selection, see SIMD::TradeBatch
+         *
+         */
+        Vector term;
+
+        /**
+         * @brief Get the number of trades
+         *
+         * @return size_t Number of trades
+         */
+        size_t size() const noexcept { return notional.size(); }
+
+        /**
+         * @brief Add a trade
+         *
+         * @param notional Signed notional
+         * @param strike Strike
+         * @param maturity Maturity
+         * @param sign 1 for a call, -1 for a put
+         * @param set Netting set
+         */
+        void add(double notional, double strike, double maturity, double sign, uint32_t set);
+
+        /**
+         * @brief Select the trades alive at a date, with their term
+         *
+         * @param product Product type of the trades
+         * @param t Date
+         * @param selection Trades selected, reused from call to call
+         * @return SIMD::TradeBatch Batch over the selection
+         */
+        SIMD::TradeBatch alive(Product product, double t, Trades &selection) const;
+    };
+
+    /**
+     * @brief Get the index of a netting set, adding it if new
+     *
+     * @param name Netting set
+     * @return uint32_t Index
+     */
+    uint32_t netting_set(const std::string &name);
+
+    Trades m_swaps;
+    Trades m_forwards;
+    Trades m_options;
+    std::vector<std::string> m_netting_sets;
+    std::vector<std::string> m_collateral_sets;
+    Vector m_thresholds;
+    std::vector<std::vector<uint32_t>> m_members;
+    std::vector<bool> m_collateralised;
+};
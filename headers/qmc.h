@@ -0,0 +1,125 @@
+/**
+ * @file qmc.h
+ * @author Thomas Roiseux (thomas.roiseux@mathquantlab.com)
+ * @brief Provides randomised quasi-Monte Carlo points and the Brownian bridge
+ * @version 1.0
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+
+#pragma once
+
+#include "../headers/pch.h"
+#include "../headers/rng.h"
+
+#include <vector>
+
+/**
+ * @brief Randomised quasi-Monte Carlo
+ *
+ * Points come from the Sobol sequence with the direction numbers of Joe and
+ * Kuo (new-joe-kuo-6.21201), Owen-scrambled by a hash of the reversed bits.
+ * Every replicate uses independent scrambles, so the spread of the replicate
+ * estimates gives the error bars.
+ */
+namespace QMC
+{
+    /**
+     * @brief Number of Sobol dimensions available
+     *
+     */
+    constexpr size_t max_dimension = 1024;
+
+    /**
+     * @brief Get a coordinate of an unscrambled Sobol point
+     *
+     * @param index Point index
+     * @param dimension Dimension, less than max_dimension
+     * @return uint32_t Coordinate, in units of 2^-32
+     */
+    uint32_t sobol(uint32_t index, size_t dimension) noexcept;
+
+    /**
+     * @brief Get the scrambling seed of a dimension in a replicate
+     *
+     * @param seed Seed of the run
+     * @param replicate Replicate index
+     * @param dimension Dimension
+     * @return uint32_t Scrambling seed
+     */
+    uint32_t scramble_seed(RNG::Seed seed, uint32_t replicate, uint32_t dimension) noexcept;
+
+    /**
+     * @brief Nested uniform (Owen) scrambling of a coordinate
+     *
+     * @param x Coordinate, in units of 2^-32
+     * @param seed Scrambling seed
+     * @return uint32_t Scrambled coordinate
+     */
+    uint32_t scramble(uint32_t x, uint32_t seed) noexcept;
+
+    /**
+     * @brief Inverse of the standard normal distribution function
+     *
+     * Rational approximation of Acklam refined by a Halley step, accurate to
+     * a few ulps.
+     *
+     * @param u Probability, in (0, 1)
+     * @return double Standard normal quantile
+     */
+    double inverse_normal(double u) noexcept;
+
+    /**
+     * @brief Brownian bridge over a time grid
+     *
+     * The first sample sets the end of the path, each next one the midpoint
+     * (in steps) of the largest interval left, so the leading samples carry
+     * most of the variance of the path.
+     */
+    class BrownianBridge
+    {
+    public:
+        /**
+         * @brief Construct a new BrownianBridge object over a uniform grid
+         *
+         * @param nb_steps Number of steps
+         */
+        explicit BrownianBridge(size_t nb_steps = 0);
+
+        /**
+         * @brief Construct a new BrownianBridge object over a non-uniform grid
+         *
+         * Steps of equal lengths give the bridge of the uniform grid.
+         *
+         * @param steps Length of every step
+         */
+        explicit BrownianBridge(const std::vector<double> &steps);
+
+        /**
+         * @brief Get the number of steps
+         *
+         * @return size_t Number of steps
+         */
+        size_t nb_steps() const noexcept { return m_bridge.size(); }
+
+        /**
+         * @brief Build the increments of a path
+         *
+         * @param z Standard normal samples, in order of importance
+         * @param increments Standard normal increments of every step, in time
+         * order, normalised by the square root of their length
+         */
+        void build(const double *z, double *increments) const;
+
+    private:
+        std::vector<double> m_scale;
+        std::vector<size_t> m_left;
+        std::vector<size_t> m_right;
+        std::vector<size_t> m_bridge;
+        std::vector<double> m_left_weight;
+        std::vector<double> m_right_weight;
+        std::vector<double> m_deviation;
+    };
+}
@@ -0,0 +1,119 @@
+/**
+ * @file regression.h
+ * @author Thomas Roiseux (thomas.roiseux@mathquantlab.com)
+ * @brief Provides the regression proxy of the nested Monte Carlo system.
+ * @version 1.0
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+
+#pragma once
+#include "../headers/nmc.h"
+
+#include <vector>
+
+/**
+ * @brief Least squares proxy of the conditional expectations, in the spirit
+ * of Longstaff and Schwartz.
+ *
+ * At every date, the first regression.pilot outer paths branch
+ * regression.inner inner paths each, and their mean portfolio values are
+ * fitted by least squares on the monomials of total degree at most
+ * regression.degree in the standardised outer state (interest rate, FX rate,
+ * equity). The conditional expectation of every outer node is then read
+ * from the fitted polynomial, so the inner cost no longer grows with m0 or
+ * m1.
+ *
+ * The last regression.check outer paths are then valued with m1 inner paths
+ * as the nested estimator would, and the two are compared. Only paths
+ * outside the pilot are checked, so the check is out of sample.
+ */
+class RegressionNMC : public NMC
+{
+public:
+    using NMC::NMC;
+
+    /**
+     * @brief Run the regression estimator for one XVA.
+     *
+     * @param xva XVA type
+     * @param factor Factor
+     * @param external_paths External paths simulated
+     * @param paths Path simulated, one value per point
+     */
+    void run(XVA xva, double factor, const std::map<ExternalPaths, PathBlock> &external_paths, PathView<double> paths) const override;
+
+    /**
+     * @brief Run the regression estimator for several XVA at once, then
+     * check it against the nested estimator.
+     *
+     * @param xvas XVA types and their factors
+     * @param external_paths External paths simulated
+     * @param paths Paths simulated, one row per XVA in the order of the map
+     * @param errors Monte Carlo standard errors of the outer paths, same
+     * layout as paths, leaving out the regression error
+     * @param pfe Potential future exposure, one row per level
+     */
+    void run(const std::map<XVA, double> &xvas, const std::map<ExternalPaths, PathBlock> &external_paths, PathBlock &paths, PathBlock &errors, PathBlock &pfe) const override;
+
+    /**
+     * @brief Regress the conditional expectations on the outer state.
+     *
+     * @param external_paths External paths
+     * @param values Conditional expectations, one row per outer path
+     */
+    void nested_values(const std::map<ExternalPaths, PathBlock> &external_paths, PathBlock &values) const override;
+
+private:
+    /**
+     * @brief Polynomial of the outer state at one date
+     *
+     */
+    struct Fit
+    {
+        /**
+         * @brief Mean of every factor over the pilot
+         *
+         */
+        double mean[nb_factors];
+        /**
+         * @brief Standard deviation of every factor over the pilot, 0 if constant
+         *
+         */
+        double deviation[nb_factors];
+        /**
+         * @brief Coefficient of every monomial
+         *
+         */
+        Vector coefficients;
+    };
+
+    /**
+     * @brief Exponents of the factors in every monomial of the basis
+     *
+     * @return std::vector<std::vector<size_t>> Monomials, constant first
+     */
+    std::vector<std::vector<size_t>> basis() const;
+
+    /**
+     * @brief Evaluate the basis at an outer node
+     *
+     * @param monomials Basis, see basis
+     * @param fit Fit holding the standardisation
+     * @param state Value of every factor
+     * @param phi Value of every monomial
+     */
+    static void evaluate(const std::vector<std::vector<size_t>> &monomials, const Fit &fit, const double state[nb_factors], double *phi);
+
+    /**
+     * @brief Compare the regression with nested Monte Carlo on the last
+     * outer paths outside the pilot, and print the differences
+     *
+     * @param xvas XVA types and their factors
+     * @param external_paths External paths
+     * @param values Regressed conditional expectations
+     */
+    void check(const std::map<XVA, double> &xvas, const std::map<ExternalPaths, PathBlock> &external_paths, const PathBlock &values) const;
+};
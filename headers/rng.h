@@ -0,0 +1,187 @@
+/**
+ * @file rng.h
+ * @author Thomas Roiseux (thomas.roiseux@mathquantlab.com)
+ * @brief Provides the counter-based random number generator shared by the CPU and the GPU
+ * @version 1.0
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <cmath>
+#include <cstring>
+
+#ifdef __CUDACC__
+#define XVA_HOST_DEVICE __host__ __device__
+#else
+#define XVA_HOST_DEVICE
+#endif
+
+/**
+ * @brief Counter-based random number generation (Philox4x32-10)
+ *
+ * Every random number is a pure function of (seed, factor, outer path,
+ * inner path, step): no state is carried from one draw to the next, so any
+ * chunk of work can run on any thread, in any order, and still draw the
+ * same numbers. The inner path 0 is the outer path itself; internal paths
+ * use inner indices starting at 1.
+ */
+namespace RNG
+{
+    /**
+     * @brief Seed type
+     *
+     */
+    typedef uint64_t Seed;
+
+    /**
+     * @brief Default seed, the one the GPU kernels used to hard-code
+     *
+     */
+    constexpr Seed default_seed = 1234;
+
+    /**
+     * @brief Apply the ten Philox4x32 rounds in place
+     *
+     * @param counter Counter, replaced by the random output
+     * @param key Key
+     */
+    XVA_HOST_DEVICE inline void philox4x32_10(uint32_t counter[4], const uint32_t key[2])
+    {
+        const uint32_t M0 = 0xD2511F53u, M1 = 0xCD9E8D57u;
+        const uint32_t W0 = 0x9E3779B9u, W1 = 0xBB67AE85u;
+
+        uint32_t k0 = key[0], k1 = key[1];
+        for (int round = 0; round < 10; round++)
+        {
+            uint64_t p0 = uint64_t(M0) * counter[0];
+            uint64_t p1 = uint64_t(M1) * counter[2];
+            uint32_t c0 = uint32_t(p1 >> 32) ^ counter[1] ^ k0;
+            uint32_t c1 = uint32_t(p1);
+            uint32_t c2 = uint32_t(p0 >> 32) ^ counter[3] ^ k1;
+            uint32_t c3 = uint32_t(p0);
+            counter[0] = c0;
+            counter[1] = c1;
+            counter[2] = c2;
+            counter[3] = c3;
+            k0 += W0;
+            k1 += W1;
+        }
+    }
+
+    /**
+     * @brief Convert 64 random bits to a double in the open interval (0, 1)
+     *
+     * The 52 high bits become the mantissa of a double in [1, 2), which only
+     * takes integer operations and vectorises on every instruction set.
+     *
+     * @param hi High bits
+     * @param lo Low bits
+     * @return double Uniform sample
+     */
+    XVA_HOST_DEVICE inline double to_uniform(uint32_t hi, uint32_t lo)
+    {
+        uint64_t bits = 0x3FF0000000000000ull | (uint64_t(hi) << 32 | lo) >> 12;
+        double one_two;
+        memcpy(&one_two, &bits, sizeof(double));
+        return (one_two - 1.0) + 1.1102230246251565e-16;
+    }
+
+    /**
+     * @brief Draw the two standard normal samples of a counter (Box-Muller)
+     *
+     * @param seed Seed
+     * @param factor Risk factor
+     * @param outer Outer path index
+     * @param inner Inner path index, 0 for the outer path itself
+     * @param pair Step pair index: steps 2 * pair and 2 * pair + 1
+     * @param z0 Sample of the even step
+     * @param z1 Sample of the odd step
+     */
+    XVA_HOST_DEVICE inline void normal_pair(Seed seed, uint32_t factor, uint32_t outer, uint32_t inner, uint32_t pair, double &z0, double &z1)
+    {
+        uint32_t counter[4] = {pair, inner, outer, factor};
+        const uint32_t key[2] = {uint32_t(seed), uint32_t(seed >> 32)};
+        philox4x32_10(counter, key);
+
+        double u1 = to_uniform(counter[0], counter[1]);
+        double u2 = to_uniform(counter[2], counter[3]);
+        double r = sqrt(-2.0 * log(u1));
+        double theta = 6.283185307179586 * u2;
+        z0 = r * cos(theta);
+        z1 = r * sin(theta);
+    }
+
+    /**
+     * @brief Draw the standard normal sample of a step
+     *
+     * @param seed Seed
+     * @param factor Risk factor
+     * @param outer Outer path index
+     * @param inner Inner path index, 0 for the outer path itself
+     * @param step Step index
+     * @return double Standard normal sample
+     */
+    XVA_HOST_DEVICE inline double normal(Seed seed, uint32_t factor, uint32_t outer, uint32_t inner, uint32_t step)
+    {
+        double z0, z1;
+        normal_pair(seed, factor, outer, inner, step / 2, z0, z1);
+        return (step & 1) ? z1 : z0;
+    }
+
+    /**
+     * @brief Random stream of one path
+     *
+     */
+    class Stream
+    {
+    public:
+        /**
+         * @brief Construct a new Stream object
+         *
+         * @param seed Seed
+         * @param factor Risk factor
+         * @param outer Outer path index
+         * @param inner Inner path index, 0 for the outer path itself
+         * @param negated Draw the negated samples, for the antithetic
+         * partner of a path
+         */
+        Stream(Seed seed, uint32_t factor, uint32_t outer, uint32_t inner, bool negated = false) noexcept
+            : m_seed(seed), m_factor(factor), m_outer(outer), m_inner(inner), m_negated(negated) {}
+
+        /**
+         * @brief Draw the standard normal sample of a step
+         *
+         * @param step Step index
+         * @return double Standard normal sample
+         */
+        double normal(size_t step) const
+        {
+            double z = RNG::normal(m_seed, m_factor, m_outer, m_inner, uint32_t(step));
+            return m_negated ? -z : z;
+        }
+
+        /**
+         * @brief Draw the standard normal samples of consecutive steps
+         *
+         * Batched and vectorised, see SIMD::normals.
+         *
+         * @param first First step index
+         * @param count Number of steps
+         * @param out Samples, out[k] being the sample of step first + k
+         */
+        void normals(size_t first, size_t count, double *out) const;
+
+    private:
+        Seed m_seed;
+        uint32_t m_factor;
+        uint32_t m_outer;
+        uint32_t m_inner;
+        bool m_negated;
+    };
+}
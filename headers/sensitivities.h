@@ -0,0 +1,106 @@
+/**
+ * @file sensitivities.h
+ * @author Thomas Roiseux (thomas.roiseux@mathquantlab.com)
+ * @brief Provides the sensitivities of the XVA to the model parameters
+ * @version 1.0
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+
+#pragma once
+
+#include "../headers/pch.h"
+#include "../headers/config.h"
+#include "../headers/time_grid.h"
+#include "../headers/path_block.h"
+#include "../headers/rng.h"
+
+#include <map>
+#include <vector>
+#include <string>
+
+/**
+ * @brief Sensitivity of an XVA to a model parameter
+ *
+ */
+struct Sensitivity
+{
+    /**
+     * @brief Parameter key, see Config::parameter
+     *
+     */
+    std::string parameter;
+    /**
+     * @brief XVA type
+     *
+     */
+    XVA xva;
+    /**
+     * @brief XVA of the base run, summed over the exposure dates
+     *
+     */
+    double value;
+    /**
+     * @brief Absolute bump of the parameter
+     *
+     */
+    double bump;
+    /**
+     * @brief Central finite difference
+     *
+     */
+    double finite_difference;
+    /**
+     * @brief Pathwise derivative, NaN if not computed
+     *
+     */
+    double pathwise;
+};
+
+/**
+ * @brief Provides the sensitivities of the XVA to the model parameters
+ *
+ * Every bumped run reuses the random numbers of the base run: the correlated
+ * normal samples of the outer paths are drawn once and only the factor
+ * owning the bumped parameter is evolved again, the other factors keeping
+ * their base paths, while the inner paths draw the same streams from the
+ * same seed. The noise of the base and bumped runs then cancels in the
+ * central differences.
+ */
+namespace Sensitivities
+{
+    /**
+     * @brief Get the parameters whose sensitivities are requested, "all"
+     * expanded to the fields of the models in use
+     *
+     * @param config Models and Config::sensitivity_parameters
+     * @return std::vector<std::string> Parameter keys, without duplicates
+     * @throws Exception If a parameter is not read by the model of its
+     * factor
+     */
+    std::vector<std::string> parameters(const Config &config);
+
+    /**
+     * @brief Compute the sensitivities of several XVA by central finite
+     * differences, and their pathwise derivatives if
+     * Config::sensitivity_pathwise is set
+     *
+     * @param xvas XVA types and their factors
+     * @param m0 Number of external paths
+     * @param m1 Number of internal paths
+     * @param grid Simulation points and exposure dates
+     * @param paths Paths of the base run, one row per XVA in the order of
+     * the map
+     * @param config Risk factor models and sensitivity settings
+     * @param nb_threads Number of threads, 0 for the hardware concurrency
+     * @param seed Seed of the base run
+     * @param streaming Fold internal paths into running statistics instead of storing them
+     * @return std::vector<Sensitivity> Sensitivities, by parameter then XVA
+     * @throws Exception If importance sampling changes the outer paths with
+     * the models
+     */
+    std::vector<Sensitivity> compute(const std::map<XVA, double> &xvas, size_t m0, size_t m1, const TimeGrid &grid, const PathBlock &paths,
+                                     const Config &config, size_t nb_threads = 0, RNG::Seed seed = RNG::default_seed, bool streaming = false);
+}
@@ -0,0 +1,152 @@
+/**
+ * @file shard.h
+ * @author Thomas Roiseux (thomas.roiseux@mathquantlab.com)
+ * @brief Provides the sharding of the outer paths over worker processes
+ * @version 1.0
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+
+#pragma once
+
+#include "../headers/pch.h"
+#include "../headers/path_block.h"
+#include "../headers/accumulator.h"
+#include "../headers/sketch.h"
+
+#include <functional>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief Provides the sharding of the outer paths over worker processes
+ *
+ * A coordinator splits the outer paths into contiguous ranges, one per
+ * shard. The worker of a shard simulates its range with the random streams
+ * of the outer path indices, so a shard draws the numbers a single process
+ * would, and reduces it into a Partial. Partials travel as bytes, whatever
+ * launches the workers, and are merged in the order of their ranges: the
+ * results only depend on the number of shards.
+ */
+namespace Shard
+{
+    /**
+     * @brief Statistics of a range of outer paths
+     *
+     */
+    struct Partial
+    {
+        /**
+         * @brief First outer path index
+         *
+         */
+        size_t first = 0;
+        /**
+         * @brief Number of outer paths
+         *
+         */
+        size_t count = 0;
+        /**
+         * @brief Number of quasi-Monte Carlo replicates, 1 without
+         *
+         */
+        size_t replicates = 1;
+        /**
+         * @brief Payoff statistics, replicates accumulators per XVA in the
+         * order of the map
+         *
+         */
+        std::vector<PathAccumulator> estimates;
+        /**
+         * @brief Sketch of the conditional portfolio values, weighted by
+         * their likelihood ratios
+         *
+         */
+        PathSketch sketch;
+
+        /**
+         * @brief Write the statistics in binary
+         *
+         * @param out Stream
+         */
+        void write(std::ostream &out) const;
+
+        /**
+         * @brief Read statistics written by write
+         *
+         * @param in Stream
+         * @throws Exception If the stream is truncated
+         */
+        void read(std::istream &in);
+    };
+
+    /**
+     * @brief Launcher of the workers of the shards
+     *
+     * A launcher only moves bytes: a transport across nodes implements it
+     * without changing how the partials are computed or merged.
+     */
+    class Launcher
+    {
+    public:
+        /**
+         * @brief Destroy the Launcher object
+         *
+         */
+        virtual ~Launcher() = default;
+
+        /**
+         * @brief Run every task in a worker
+         *
+         * @param nb_tasks Number of tasks
+         * @param task Task, returning the bytes sent back to the coordinator
+         * @return std::vector<std::string> Bytes of every task, in the order
+         * of the tasks
+         * @throws Exception If a worker fails
+         */
+        virtual std::vector<std::string> run(size_t nb_tasks, const std::function<std::string(size_t task)> &task) = 0;
+    };
+
+    /**
+     * @brief Launcher forking a local process per task, its bytes coming
+     * back through a pipe
+     *
+     * Forking copies the coordinator, so it must not hold any thread yet;
+     * every worker starts its own thread pool.
+     */
+    class ForkLauncher : public Launcher
+    {
+    public:
+        std::vector<std::string> run(size_t nb_tasks, const std::function<std::string(size_t task)> &task) override;
+    };
+
+    /**
+     * @brief Split paths into contiguous ranges of near equal sizes
+     *
+     * @param nb_paths Number of paths
+     * @param nb_shards Number of shards, fewer if there are not enough
+     * aligned ranges
+     * @param alignment Every range but the last starts and ends on a
+     * multiple of it, so SIMD groups and antithetic pairs are not split
+     * @return std::vector<std::pair<size_t, size_t>> First path and number
+     * of paths of every range
+     */
+    std::vector<std::pair<size_t, size_t>> ranges(size_t nb_paths, size_t nb_shards, size_t alignment);
+
+    /**
+     * @brief Merge the partials of the shards, in the order of their ranges
+     *
+     * @param partials Partials, covering every outer path exactly once
+     * @param levels Level of every row of the potential future exposure
+     * @param paths Paths simulated, one row per XVA, one value per exposure
+     * date
+     * @param errors Monte Carlo standard errors, same layout as paths
+     * @param pfe Potential future exposure, one row per level
+     * @throws Exception If the ranges of the partials leave a gap or overlap
+     */
+    void merge(std::vector<Partial> partials, const std::vector<double> &levels, PathBlock &paths, PathBlock &errors, PathBlock &pfe);
+}
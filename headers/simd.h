@@ -0,0 +1,253 @@
+/**
+ * @file simd.h
+ * @author Thomas Roiseux (thomas.roiseux@mathquantlab.com)
+ * @brief Provides vectorised kernels, dispatched at runtime on the instruction set
+ * @version 1.0
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+
+#pragma once
+
+#include "../headers/pch.h"
+#include "../headers/rng.h"
+#include "../headers/models.h"
+
+/**
+ * @brief Vectorised kernels
+ *
+ * Every kernel is compiled once per instruction set. The best one supported
+ * by the processor is selected on first use, and can be overridden.
+ */
+namespace SIMD
+{
+    /**
+     * @brief Instruction sets
+     *
+     */
+    enum ISA
+    {
+        /**
+         * @brief Portable scalar code
+         *
+         */
+        Scalar,
+        /**
+         * @brief SSE4.1, 2 doubles per register
+         *
+         */
+        SSE,
+        /**
+         * @brief AVX2 and FMA, 4 doubles per register
+         *
+         */
+        AVX2,
+        /**
+         * @brief AVX-512 F and DQ, 8 doubles per register
+         *
+         */
+        AVX512
+    };
+
+    /**
+     * @brief Granularity of the kernel arguments, in doubles: one AVX-512 register
+     *
+     */
+    constexpr size_t block = 8;
+
+    /**
+     * @brief Number of paths evolved together: several registers per step,
+     * so that independent chains hide the latency of exp
+     *
+     */
+    constexpr size_t group = 4 * block;
+
+    /**
+     * @brief Get the best instruction set supported by the processor and the build
+     *
+     * @return ISA Best instruction set
+     */
+    ISA detect() noexcept;
+
+    /**
+     * @brief Check if an instruction set can be used
+     *
+     * @param isa Instruction set
+     * @return true Instruction set is supported by the processor and the build
+     * @return false Instruction set cannot be used
+     */
+    bool is_supported(ISA isa) noexcept;
+
+    /**
+     * @brief Get the instruction set used by the kernels
+     *
+     * @return ISA Instruction set
+     */
+    ISA active() noexcept;
+
+    /**
+     * @brief Select the instruction set used by the kernels
+     *
+     * @param isa Instruction set
+     * @throws Exception If the instruction set is not supported
+     */
+    void select(ISA isa);
+
+    /**
+     * @brief Parse an instruction set name
+     *
+     * @param str Name (scalar, sse, avx2, avx512)
+     * @return ISA Instruction set
+     * @throws Exception If the name is unknown
+     */
+    ISA parse(const std::string &str);
+
+    /**
+     * @brief Pretty print an instruction set name
+     *
+     * @param isa Instruction set
+     * @return const char* Instruction set name
+     */
+    const char *name(ISA isa) noexcept;
+
+    /**
+     * @brief Draw the standard normal samples of consecutive steps of a path
+     *
+     * Same samples as RNG::normal, up to the last bits: the Box-Muller
+     * transform uses vectorised polynomial approximations of log, sin and cos.
+     *
+     * @param seed Seed
+     * @param factor Risk factor
+     * @param outer Outer path index
+     * @param inner Inner path index
+     * @param first First step index
+     * @param count Number of steps
+     * @param out Samples, out[k] being the sample of step first + k
+     */
+    void normals(RNG::Seed seed, uint32_t factor, uint32_t outer, uint32_t inner, size_t first, size_t count, double *out);
+
+    /**
+     * @brief Evolve paths of a model, several paths per register
+     *
+     * Paths are processed in groups of SIMD::group, transposed so that each
+     * register holds the same step of several paths, then stepped with
+     * Model::step. Float paths are stepped in float registers, twice as
+     * many paths per register.
+     *
+     * @tparam Model Model policy (Models::GBM, CIR, Vasicek, HullWhite)
+     * @tparam Real Element type of the paths, double or float
+     * @param paths First path, holding the standard normal sample of step j
+     * at point j >= 1 on input, and the path on output
+     * @param stride Distance between two paths, in elements
+     * @param nb_paths Number of paths
+     * @param nb_points Number of points per path
+     * @param x0 Initial value
+     * @param constants Model constants of every step, constants[j] leading
+     * to the point j, see Model::precompute
+     */
+    template <class Model, typename Real>
+    void evolve(Real *paths, size_t stride, size_t nb_paths, size_t nb_points, double x0, const typename Model::Constants *constants);
+
+    /**
+     * @brief Evolve paths of a model from their own initial values
+     *
+     * @tparam Model Model policy (Models::GBM, CIR, Vasicek, HullWhite)
+     * @tparam Real Element type of the paths, double or float
+     * @param paths First path, holding its initial value at point 0 and the
+     * standard normal sample of step j at point j >= 1 on input, and the
+     * path on output
+     * @param stride Distance between two paths, in elements
+     * @param nb_paths Number of paths
+     * @param nb_points Number of points per path
+     * @param constants Model constants of every step, constants[j] leading
+     * to the point j, see Model::precompute
+     */
+    template <class Model, typename Real>
+    void evolve(Real *paths, size_t stride, size_t nb_paths, size_t nb_points, const typename Model::Constants *constants);
+
+    /**
+     * @brief Trades of one product type, structure of arrays
+     *
+     */
+    struct TradeBatch
+    {
+        /**
+         * @brief Number of trades
+         *
+         */
+        size_t nb_trades;
+        /**
+         * @brief Signed notional of every trade, positive when receiving the
+         * underlying
+         *
+         */
+        const double *notional;
+        /**
+         * @brief Strike, fixed rate or forward rate of every trade
+         *
+         */
+        const double *strike;
+        /**
+         * @brief Date dependent term of every trade: accrual factor of the
+         * linear trades, time to maturity of the options
+         *
+         */
+        const double *term;
+        /**
+         * @brief 1 for a call, -1 for a put
+         *
+         */
+        const double *sign;
+        /**
+         * @brief Netting set of every trade
+         *
+         */
+        const uint32_t *sets;
+    };
+
+    /**
+     * @brief Value linear trades, notional * term * (x - strike), and add
+     * them to their netting sets
+     *
+     * @param trades Trades
+     * @param states Underlying of every scenario
+     * @param count Number of scenarios, a multiple of SIMD::block
+     * @param sets Netting set values, sets[s * count + l] for the set s in
+     * the scenario l
+     */
+    void value_linear(const TradeBatch &trades, const double *states, size_t count, double *sets);
+
+    /**
+     * @brief Value European equity options by Black-Scholes, and add them
+     * to their netting sets
+     *
+     * The cumulative normal distribution is the rational approximation 26.2.17
+     * of Abramowitz and Stegun, accurate to 7.5e-8.
+     *
+     * @param trades Trades, every one alive
+     * @param volatility Volatility of the equity
+     * @param spots Equity of every scenario, positive
+     * @param rates Interest rate of every scenario
+     * @param count Number of scenarios, a multiple of SIMD::block
+     * @param sets Netting set values, see value_linear
+     */
+    void value_options(const TradeBatch &trades, double volatility, const double *spots, const double *rates, size_t count, double *sets);
+
+    /**
+     * @brief Compare the vectorised normal samples with the scalar reference
+     * and with std::normal_distribution
+     *
+     * The samples of every instruction set must match RNG::normal to
+     * rounding, and bit for bit the first kernel of the same arithmetic,
+     * scalar for separate multiply-adds and AVX2 for fused ones, on the seed
+     * and two others derived from it.
+     *
+     * @param nb_samples Number of samples per seed
+     * @param seed Seed of the run
+     * @return true Every supported instruction set is accurate
+     * @return false At least one check failed
+     */
+    bool check_normals(size_t nb_samples, RNG::Seed seed);
+}
@@ -0,0 +1,468 @@
+/**
+ * @file simd_kernels.h
+ * @author Thomas Roiseux (thomas.roiseux@mathquantlab.com)
+ * @brief Provides the kernels compiled once per instruction set
+ * @version 1.0
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2024
+ *
+ * This header is only included by the translation units compiled for a
+ * given instruction set, each of which exports a KernelTable. The kernels
+ * must not call inline functions shared with the other translation units:
+ * the linker could keep their copy compiled for the wider instruction set.
+ */
+
+#pragma once
+
+#include "../headers/simd.h"
+#include "../headers/simd_pack.h"
+
+#include <limits>
+
+namespace SIMD
+{
+    /**
+     * @brief Path evolution kernel of a model
+     *
+     * @tparam Model Model policy
+     * @tparam Real Element type of the lanes
+     */
+    template <class Model, typename Real = double>
+    using Evolve = void (*)(Real *lanes, size_t nb_points, const typename Model::Constants *constants);
+
+    /**
+     * @brief Kernels of one instruction set
+     *
+     */
+    struct KernelTable
+    {
+        /**
+         * @brief See Kernels::box_muller
+         *
+         */
+        void (*box_muller)(const double *u1, const double *u2, size_t count, double *z0, double *z1);
+
+        /**
+         * @brief See Kernels::evolve
+         *
+         */
+        Evolve<Models::GBM> gbm;
+
+        /**
+         * @brief See Kernels::evolve
+         *
+         */
+        Evolve<Models::CIR> cir;
+
+        /**
+         * @brief See Kernels::evolve
+         *
+         */
+        Evolve<Models::Vasicek> vasicek;
+
+        /**
+         * @brief See Kernels::evolve
+         *
+         */
+        Evolve<Models::HullWhite> hull_white;
+
+        /**
+         * @brief See Kernels::evolve, in float registers
+         *
+         */
+        Evolve<Models::GBM, float> gbm_float;
+
+        /**
+         * @brief See Kernels::evolve, in float registers
+         *
+         */
+        Evolve<Models::CIR, float> cir_float;
+
+        /**
+         * @brief See Kernels::evolve, in float registers
+         *
+         */
+        Evolve<Models::Vasicek, float> vasicek_float;
+
+        /**
+         * @brief See Kernels::evolve, in float registers
+         *
+         */
+        Evolve<Models::HullWhite, float> hull_white_float;
+
+        /**
+         * @brief See Kernels::value_linear
+         *
+         */
+        void (*value_linear)(const TradeBatch &trades, const double *states, size_t count, double *sets);
+
+        /**
+         * @brief See Kernels::value_options
+         *
+         */
+        void (*value_options)(const TradeBatch &trades, double volatility, const double *spots, const double *rates, size_t count, double *sets);
+    };
+
+    /**
+     * @brief Get the portable kernels
+     *
+     * @return const KernelTable* Kernels
+     */
+    const KernelTable *scalar_kernels() noexcept;
+
+    /**
+     * @brief Get the SSE4.1 kernels
+     *
+     * @return const KernelTable* Kernels, nullptr if the build does not support SSE4.1
+     */
+    const KernelTable *sse_kernels() noexcept;
+
+    /**
+     * @brief Get the AVX2 kernels
+     *
+     * @return const KernelTable* Kernels, nullptr if the build does not support AVX2
+     */
+    const KernelTable *avx2_kernels() noexcept;
+
+    /**
+     * @brief Get the AVX-512 kernels
+     *
+     * @return const KernelTable* Kernels, nullptr if the build does not support AVX-512
+     */
+    const KernelTable *avx512_kernels() noexcept;
+
+    /**
+     * @brief Kernel implementations, generic over the register type
+     *
+     */
+    namespace Kernels
+    {
+        /**
+         * @brief Natural logarithm of positive, normal numbers
+         *
+         * x = m * 2^e with m in [sqrt(2)/2, sqrt(2)), and log(m) = 2 atanh(s)
+         * with s = (m - 1) / (m + 1), |s| < 0.172, expanded up to s^21.
+         *
+         * @tparam P Register type
+         * @param x Argument
+         * @return P::V Logarithm
+         */
+        template <class P>
+        inline typename P::V log(typename P::V x)
+        {
+            typedef typename P::V V;
+            const V one = P::set1(1.0);
+
+            // Biased exponent, converted to double through the mantissa of 2^52
+            V exponent = P::sub(P::bit_or(P::template shift_right<52>(x), 0x4330000000000000ull), P::set1(4503599627370496.0 + 1023.0));
+            V m = P::bit_or(P::bit_and(x, 0x000FFFFFFFFFFFFFull), 0x3FF0000000000000ull);
+
+            auto big = P::cmp_gt(m, P::set1(1.4142135623730951));
+            m = P::select(big, P::mul(m, P::set1(0.5)), m);
+            exponent = P::select(big, P::add(exponent, one), exponent);
+
+            V s = P::div(P::sub(m, one), P::add(m, one));
+            V s2 = P::mul(s, s);
+            V p = P::set1(1.0 / 21);
+            p = P::fmadd(p, s2, P::set1(1.0 / 19));
+            p = P::fmadd(p, s2, P::set1(1.0 / 17));
+            p = P::fmadd(p, s2, P::set1(1.0 / 15));
+            p = P::fmadd(p, s2, P::set1(1.0 / 13));
+            p = P::fmadd(p, s2, P::set1(1.0 / 11));
+            p = P::fmadd(p, s2, P::set1(1.0 / 9));
+            p = P::fmadd(p, s2, P::set1(1.0 / 7));
+            p = P::fmadd(p, s2, P::set1(1.0 / 5));
+            p = P::fmadd(p, s2, P::set1(1.0 / 3));
+            p = P::fmadd(p, s2, one);
+            V log_m = P::mul(P::add(s, s), p);
+
+            return P::fmadd(exponent, P::set1(0.6931471803691238), P::fmadd(exponent, P::set1(1.9082149292705877e-10), log_m));
+        }
+
+        /**
+         * @brief Exponential, for arguments clamped to [-708, 709] in double
+         * and [-87, 88] in float
+         *
+         * exp(x) = 2^k exp(r) with k = round(x / log(2)) and |r| <= log(2) / 2,
+         * exp(r) being expanded up to r^13. Float registers evaluate the same
+         * polynomial, its coefficients rounded to float.
+         *
+         * @tparam P Register type
+         * @param x Argument
+         * @return P::V Exponential
+         */
+        template <class P>
+        inline typename P::V exp(typename P::V x)
+        {
+            typedef typename P::V V;
+            typedef typename P::T T;
+            constexpr int mantissa = std::numeric_limits<T>::digits - 1;
+            constexpr int bias = std::numeric_limits<T>::max_exponent - 1;
+            constexpr bool wide = sizeof(T) == sizeof(double);
+            x = P::min(P::max(x, P::set1(wide ? -708.0 : -87.0)), P::set1(wide ? 709.0 : 88.0));
+
+            V k = P::round(P::mul(x, P::set1(1.4426950408889634)));
+            V r = P::fmadd(k, P::set1(-0.6931471803691238), x);
+            r = P::fmadd(k, P::set1(-1.9082149292705877e-10), r);
+
+            V p = P::set1(1.0 / 6227020800.0);
+            p = P::fmadd(p, r, P::set1(1.0 / 479001600.0));
+            p = P::fmadd(p, r, P::set1(1.0 / 39916800.0));
+            p = P::fmadd(p, r, P::set1(1.0 / 3628800.0));
+            p = P::fmadd(p, r, P::set1(1.0 / 362880.0));
+            p = P::fmadd(p, r, P::set1(1.0 / 40320.0));
+            p = P::fmadd(p, r, P::set1(1.0 / 5040.0));
+            p = P::fmadd(p, r, P::set1(1.0 / 720.0));
+            p = P::fmadd(p, r, P::set1(1.0 / 120.0));
+            p = P::fmadd(p, r, P::set1(1.0 / 24.0));
+            p = P::fmadd(p, r, P::set1(1.0 / 6.0));
+            p = P::fmadd(p, r, P::set1(0.5));
+            p = P::fmadd(p, r, P::set1(1.0));
+            p = P::fmadd(p, r, P::set1(1.0));
+
+            // 2^k, built from the low bits of k + bias + 2^mantissa
+            V biased = P::bit_and(P::add(k, P::set1(double(1ull << mantissa) + bias)), uint64_t(2 * bias + 1));
+            return P::mul(p, P::template shift_left<mantissa>(biased));
+        }
+
+        /**
+         * @brief Sine and cosine of 2 pi u
+         *
+         * The reduction is done on u, where it is exact: u is brought back to
+         * [-1/2, 1/2], then to an octant [-1/8, 1/8] around a quadrant q.
+         *
+         * @tparam P Register type
+         * @param u Argument, in turns
+         * @param s Sine
+         * @param c Cosine
+         */
+        template <class P>
+        inline void sincos_2pi(typename P::V u, typename P::V &s, typename P::V &c)
+        {
+            typedef typename P::V V;
+            V x = P::sub(u, P::round(u));
+            V q = P::round(P::mul(x, P::set1(4.0)));
+            V a = P::mul(P::fmadd(q, P::set1(-0.25), x), P::set1(6.283185307179586));
+            V a2 = P::mul(a, a);
+
+            V ps = P::set1(-1.0 / 1307674368000.0);
+            ps = P::fmadd(ps, a2, P::set1(1.0 / 6227020800.0));
+            ps = P::fmadd(ps, a2, P::set1(-1.0 / 39916800.0));
+            ps = P::fmadd(ps, a2, P::set1(1.0 / 362880.0));
+            ps = P::fmadd(ps, a2, P::set1(-1.0 / 5040.0));
+            ps = P::fmadd(ps, a2, P::set1(1.0 / 120.0));
+            ps = P::fmadd(ps, a2, P::set1(-1.0 / 6.0));
+            V sin_a = P::fmadd(P::mul(ps, a2), a, a);
+
+            V pc = P::set1(1.0 / 20922789888000.0);
+            pc = P::fmadd(pc, a2, P::set1(-1.0 / 87178291200.0));
+            pc = P::fmadd(pc, a2, P::set1(1.0 / 479001600.0));
+            pc = P::fmadd(pc, a2, P::set1(-1.0 / 3628800.0));
+            pc = P::fmadd(pc, a2, P::set1(1.0 / 40320.0));
+            pc = P::fmadd(pc, a2, P::set1(-1.0 / 720.0));
+            pc = P::fmadd(pc, a2, P::set1(1.0 / 24.0));
+            pc = P::fmadd(pc, a2, P::set1(-0.5));
+            V cos_a = P::fmadd(pc, a2, P::set1(1.0));
+
+            // Rotate by q quarter turns, q in {-2, -1, 0, 1, 2}
+            V q2 = P::mul(q, q);
+            auto odd = P::cmp_eq(q2, P::set1(1.0));
+            auto half_turn = P::cmp_gt(q2, P::set1(2.5));
+            V s0 = P::select(odd, cos_a, sin_a);
+            V c0 = P::select(odd, sin_a, cos_a);
+            V zero = P::set1(0.0);
+            s = P::select(P::mask_or(half_turn, P::cmp_eq(q, P::set1(-1.0))), P::sub(zero, s0), s0);
+            c = P::select(P::mask_or(half_turn, P::cmp_eq(q, P::set1(1.0))), P::sub(zero, c0), c0);
+        }
+
+        /**
+         * @brief Box-Muller transform of pairs of uniform samples
+         *
+         * @tparam P Register type
+         * @param u1 Uniform samples giving the radius
+         * @param u2 Uniform samples giving the angle
+         * @param count Number of pairs, a multiple of SIMD::block
+         * @param z0 Cosine samples
+         * @param z1 Sine samples
+         */
+        template <class P>
+        void box_muller(const double *u1, const double *u2, size_t count, double *z0, double *z1)
+        {
+            typedef typename P::V V;
+            for (size_t p = 0; p < count; p += P::width)
+            {
+                V r = P::sqrt(P::mul(P::set1(-2.0), log<P>(P::load(u1 + p))));
+                V s, c;
+                sincos_2pi<P>(P::load(u2 + p), s, c);
+                P::store(z0 + p, P::mul(r, c));
+                P::store(z1 + p, P::mul(r, s));
+            }
+        }
+
+        /**
+         * @brief Register math of a model step
+         *
+         * @tparam P Register type
+         */
+        template <class P>
+        struct PackMath : P
+        {
+            static typename P::V exp(typename P::V x) { return Kernels::exp<P>(x); }
+        };
+
+        /**
+         * @brief Evolve SIMD::group paths of a model in lanes
+         *
+         * @tparam Model Model policy
+         * @tparam P Register type
+         * @param lanes Point j of lane l at lanes[j * SIMD::group + l], holding
+         * the initial value at j = 0 and the standard normal sample of step j
+         * for j >= 1 on input
+         * @param nb_points Number of points
+         * @param constants Model constants of every step, constants[j] leading
+         * to the point j
+         */
+        template <class Model, class P>
+        void evolve(typename P::T *lanes, size_t nb_points, const typename Model::Constants *constants)
+        {
+            typedef typename P::V V;
+            constexpr size_t nb_registers = group / P::width;
+            V x[nb_registers];
+
+            for (size_t r = 0; r < nb_registers; r++)
+            {
+                x[r] = P::load(lanes + r * P::width);
+            }
+
+            for (size_t j = 1; j < nb_points; j++)
+            {
+                typename P::T *point = lanes + j * group;
+                for (size_t r = 0; r < nb_registers; r++)
+                {
+                    x[r] = Model::template step<PackMath<P>>(x[r], P::load(point + r * P::width), constants[j]);
+                    P::store(point + r * P::width, x[r]);
+                }
+            }
+        }
+
+        /**
+         * @brief Cumulative standard normal distribution
+         *
+         * The upper tail of |x| is phi(|x|) times a polynomial in
+         * t = 1 / (1 + 0.2316419 |x|), reflected for negative arguments.
+         *
+         * @tparam P Register type
+         * @param x Argument
+         * @return P::V Probability
+         */
+        template <class P>
+        inline typename P::V normal_cdf(typename P::V x)
+        {
+            typedef typename P::V V;
+            V z = P::bit_and(x, 0x7FFFFFFFFFFFFFFFull);
+            V t = P::div(P::set1(1.0), P::fmadd(z, P::set1(0.2316419), P::set1(1.0)));
+            V p = P::set1(1.330274429);
+            p = P::fmadd(p, t, P::set1(-1.821255978));
+            p = P::fmadd(p, t, P::set1(1.781477937));
+            p = P::fmadd(p, t, P::set1(-0.356563782));
+            p = P::fmadd(p, t, P::set1(0.319381530));
+            p = P::mul(p, t);
+            V density = P::mul(P::set1(0.3989422804014327), exp<P>(P::mul(P::mul(z, z), P::set1(-0.5))));
+            V tail = P::mul(density, p);
+            return P::select(P::cmp_gt(x, P::set1(0.0)), P::sub(P::set1(1.0), tail), tail);
+        }
+
+        /**
+         * @brief Value linear trades in registers
+         *
+         * @tparam P Register type
+         * @param trades Trades
+         * @param states Underlying of every scenario
+         * @param count Number of scenarios, a multiple of SIMD::block
+         * @param sets Netting set values
+         */
+        template <class P>
+        void value_linear(const TradeBatch &trades, const double *states, size_t count, double *sets)
+        {
+            typedef typename P::V V;
+            for (size_t k = 0; k < trades.nb_trades; k++)
+            {
+                V slope = P::set1(trades.notional[k] * trades.term[k]);
+                V strike = P::set1(trades.strike[k]);
+                double *out = sets + trades.sets[k] * count;
+                for (size_t l = 0; l < count; l += P::width)
+                {
+                    P::store(out + l, P::fmadd(slope, P::sub(P::load(states + l), strike), P::load(out + l)));
+                }
+            }
+        }
+
+        /**
+         * @brief Value European equity options in registers, w being the
+         * sign: w (S N(w d1) - K exp(-r tau) N(w d2))
+         *
+         * @tparam P Register type
+         * @param trades Trades, every one alive
+         * @param volatility Volatility of the equity
+         * @param spots Equity of every scenario
+         * @param rates Interest rate of every scenario
+         * @param count Number of scenarios, a multiple of SIMD::block
+         * @param sets Netting set values
+         */
+        template <class P>
+        void value_options(const TradeBatch &trades, double volatility, const double *spots, const double *rates, size_t count, double *sets)
+        {
+            typedef typename P::V V;
+            for (size_t k = 0; k < trades.nb_trades; k++)
+            {
+                double tau = trades.term[k];
+                double deviation = volatility * std::sqrt(tau);
+                V w = P::set1(trades.sign[k]);
+                V strike = P::set1(trades.strike[k]);
+                V log_strike = P::set1(std::log(trades.strike[k]));
+                V inverse = P::set1(1.0 / deviation);
+                V drift = P::set1(0.5 * volatility * volatility * tau);
+                V notional = P::set1(trades.notional[k]);
+                V minus_tau = P::set1(-tau);
+                double *out = sets + trades.sets[k] * count;
+                for (size_t l = 0; l < count; l += P::width)
+                {
+                    V spot = P::load(spots + l);
+                    V r_tau = P::mul(P::load(rates + l), P::set1(tau));
+                    V d1 = P::mul(P::add(P::sub(log<P>(spot), log_strike), P::add(r_tau, drift)), inverse);
+                    V d2 = P::sub(d1, P::set1(deviation));
+                    V forward_leg = P::mul(spot, normal_cdf<P>(P::mul(w, d1)));
+                    V strike_leg = P::mul(P::mul(strike, exp<P>(P::mul(P::load(rates + l), minus_tau))), normal_cdf<P>(P::mul(w, d2)));
+                    V value = P::mul(P::mul(w, notional), P::sub(forward_leg, strike_leg));
+                    P::store(out + l, P::add(P::load(out + l), value));
+                }
+            }
+        }
+
+        /**
+         * @brief Build the kernel table of an instruction set
+         *
+         * @tparam P Register type of doubles
+         * @tparam F Register type of floats
+         * @return KernelTable Kernels
+         */
+        template <class P, class F>
+        KernelTable make_table()
+        {
+            KernelTable table;
+            table.box_muller = &box_muller<P>;
+            table.gbm = &evolve<Models::GBM, P>;
+            table.cir = &evolve<Models::CIR, P>;
+            table.vasicek = &evolve<Models::Vasicek, P>;
+            table.hull_white = &evolve<Models::HullWhite, P>;
+            table.gbm_float = &evolve<Models::GBM, F>;
+            table.cir_float = &evolve<Models::CIR, F>;
+            table.vasicek_float = &evolve<Models::Vasicek, F>;
+            table.hull_white_float = &evolve<Models::HullWhite, F>;
+            table.value_linear = &value_linear<P>;
+            table.value_options = &value_options<P>;
+            return table;
+        }
+    }
+}
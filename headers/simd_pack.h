@@ -0,0 +1,345 @@
+/**
+ * @file simd_pack.h
+ * @author Thomas Roiseux (thomas.roiseux@mathquantlab.com)
+ * @brief Provides thin wrappers over SIMD registers
+ * @version 1.0
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <cstddef>
+
+#if defined(__SSE4_1__) || defined(__AVX2__) || defined(__AVX512F__)
+#include <immintrin.h>
+#endif
+
+namespace SIMD
+{
+    /**
+     * @brief Single double, used by the portable kernels
+     *
+     */
+    struct ScalarPack
+    {
+        typedef double T;
+        typedef double V;
+        typedef bool M;
+        static constexpr size_t width = 1;
+
+        static V set1(double a) { return a; }
+        static V load(const double *p) { return *p; }
+        static void store(double *p, V a) { *p = a; }
+        static V add(V a, V b) { return a + b; }
+        static V sub(V a, V b) { return a - b; }
+        static V mul(V a, V b) { return a * b; }
+        static V div(V a, V b) { return a / b; }
+        static V fmadd(V a, V b, V c) { return a * b + c; }
+        static V sqrt(V a) { return std::sqrt(a); }
+        static V min(V a, V b) { return a < b ? a : b; }
+        static V max(V a, V b) { return a > b ? a : b; }
+        // Round to nearest even through the 2^52 + 2^51 shift, exact for |a| < 2^51
+        static V round(V a) { return (a + 6755399441055744.0) - 6755399441055744.0; }
+        static M cmp_gt(V a, V b) { return a > b; }
+        static M cmp_eq(V a, V b) { return a == b; }
+        static M mask_or(M a, M b) { return a || b; }
+        static V select(M m, V if_true, V if_false) { return m ? if_true : if_false; }
+
+        static uint64_t to_bits(V a)
+        {
+            uint64_t bits;
+            std::memcpy(&bits, &a, sizeof(bits));
+            return bits;
+        }
+        static V from_bits(uint64_t bits)
+        {
+            V a;
+            std::memcpy(&a, &bits, sizeof(bits));
+            return a;
+        }
+        static V bit_and(V a, uint64_t mask) { return from_bits(to_bits(a) & mask); }
+        static V bit_or(V a, uint64_t mask) { return from_bits(to_bits(a) | mask); }
+        template <int N>
+        static V shift_right(V a) { return from_bits(to_bits(a) >> N); }
+        template <int N>
+        static V shift_left(V a) { return from_bits(to_bits(a) << N); }
+    };
+
+    /**
+     * @brief Single float, used by the portable kernels
+     *
+     * The float packs take the masks of the bit operations on 32 bits.
+     */
+    struct ScalarFloatPack
+    {
+        typedef float T;
+        typedef float V;
+        typedef bool M;
+        static constexpr size_t width = 1;
+
+        static V set1(double a) { return float(a); }
+        static V load(const float *p) { return *p; }
+        static void store(float *p, V a) { *p = a; }
+        static V add(V a, V b) { return a + b; }
+        static V sub(V a, V b) { return a - b; }
+        static V mul(V a, V b) { return a * b; }
+        static V div(V a, V b) { return a / b; }
+        static V fmadd(V a, V b, V c) { return a * b + c; }
+        static V sqrt(V a) { return std::sqrt(a); }
+        static V min(V a, V b) { return a < b ? a : b; }
+        static V max(V a, V b) { return a > b ? a : b; }
+        // Round to nearest even through the 2^23 + 2^22 shift, exact for |a| < 2^22
+        static V round(V a) { return (a + 12582912.0f) - 12582912.0f; }
+        static M cmp_gt(V a, V b) { return a > b; }
+        static M cmp_eq(V a, V b) { return a == b; }
+        static M mask_or(M a, M b) { return a || b; }
+        static V select(M m, V if_true, V if_false) { return m ? if_true : if_false; }
+
+        static uint32_t to_bits(V a)
+        {
+            uint32_t bits;
+            std::memcpy(&bits, &a, sizeof(bits));
+            return bits;
+        }
+        static V from_bits(uint32_t bits)
+        {
+            V a;
+            std::memcpy(&a, &bits, sizeof(bits));
+            return a;
+        }
+        static V bit_and(V a, uint64_t mask) { return from_bits(to_bits(a) & uint32_t(mask)); }
+        static V bit_or(V a, uint64_t mask) { return from_bits(to_bits(a) | uint32_t(mask)); }
+        template <int N>
+        static V shift_right(V a) { return from_bits(to_bits(a) >> N); }
+        template <int N>
+        static V shift_left(V a) { return from_bits(to_bits(a) << N); }
+    };
+
+#if defined(__SSE4_1__)
+    /**
+     * @brief Two doubles in an SSE register, without fused multiply-add
+     *
+     */
+    struct SSEPack
+    {
+        typedef double T;
+        typedef __m128d V;
+        typedef __m128d M;
+        static constexpr size_t width = 2;
+
+        static V set1(double a) { return _mm_set1_pd(a); }
+        static V load(const double *p) { return _mm_loadu_pd(p); }
+        static void store(double *p, V a) { _mm_storeu_pd(p, a); }
+        static V add(V a, V b) { return _mm_add_pd(a, b); }
+        static V sub(V a, V b) { return _mm_sub_pd(a, b); }
+        static V mul(V a, V b) { return _mm_mul_pd(a, b); }
+        static V div(V a, V b) { return _mm_div_pd(a, b); }
+        static V fmadd(V a, V b, V c) { return _mm_add_pd(_mm_mul_pd(a, b), c); }
+        static V sqrt(V a) { return _mm_sqrt_pd(a); }
+        static V min(V a, V b) { return _mm_min_pd(a, b); }
+        static V max(V a, V b) { return _mm_max_pd(a, b); }
+        static V round(V a) { return _mm_round_pd(a, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC); }
+        static M cmp_gt(V a, V b) { return _mm_cmpgt_pd(a, b); }
+        static M cmp_eq(V a, V b) { return _mm_cmpeq_pd(a, b); }
+        static M mask_or(M a, M b) { return _mm_or_pd(a, b); }
+        static V select(M m, V if_true, V if_false) { return _mm_blendv_pd(if_false, if_true, m); }
+
+        static V bit_and(V a, uint64_t mask) { return _mm_and_pd(a, _mm_castsi128_pd(_mm_set1_epi64x(int64_t(mask)))); }
+        static V bit_or(V a, uint64_t mask) { return _mm_or_pd(a, _mm_castsi128_pd(_mm_set1_epi64x(int64_t(mask)))); }
+        template <int N>
+        static V shift_right(V a) { return _mm_castsi128_pd(_mm_srli_epi64(_mm_castpd_si128(a), N)); }
+        template <int N>
+        static V shift_left(V a) { return _mm_castsi128_pd(_mm_slli_epi64(_mm_castpd_si128(a), N)); }
+    };
+
+    /**
+     * @brief Four floats in an SSE register, without fused multiply-add
+     *
+     */
+    struct SSEFloatPack
+    {
+        typedef float T;
+        typedef __m128 V;
+        typedef __m128 M;
+        static constexpr size_t width = 4;
+
+        static V set1(double a) { return _mm_set1_ps(float(a)); }
+        static V load(const float *p) { return _mm_loadu_ps(p); }
+        static void store(float *p, V a) { _mm_storeu_ps(p, a); }
+        static V add(V a, V b) { return _mm_add_ps(a, b); }
+        static V sub(V a, V b) { return _mm_sub_ps(a, b); }
+        static V mul(V a, V b) { return _mm_mul_ps(a, b); }
+        static V div(V a, V b) { return _mm_div_ps(a, b); }
+        static V fmadd(V a, V b, V c) { return _mm_add_ps(_mm_mul_ps(a, b), c); }
+        static V sqrt(V a) { return _mm_sqrt_ps(a); }
+        static V min(V a, V b) { return _mm_min_ps(a, b); }
+        static V max(V a, V b) { return _mm_max_ps(a, b); }
+        static V round(V a) { return _mm_round_ps(a, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC); }
+        static M cmp_gt(V a, V b) { return _mm_cmpgt_ps(a, b); }
+        static M cmp_eq(V a, V b) { return _mm_cmpeq_ps(a, b); }
+        static M mask_or(M a, M b) { return _mm_or_ps(a, b); }
+        static V select(M m, V if_true, V if_false) { return _mm_blendv_ps(if_false, if_true, m); }
+
+        static V bit_and(V a, uint64_t mask) { return _mm_and_ps(a, _mm_castsi128_ps(_mm_set1_epi32(int32_t(mask)))); }
+        static V bit_or(V a, uint64_t mask) { return _mm_or_ps(a, _mm_castsi128_ps(_mm_set1_epi32(int32_t(mask)))); }
+        template <int N>
+        static V shift_right(V a) { return _mm_castsi128_ps(_mm_srli_epi32(_mm_castps_si128(a), N)); }
+        template <int N>
+        static V shift_left(V a) { return _mm_castsi128_ps(_mm_slli_epi32(_mm_castps_si128(a), N)); }
+    };
+#endif
+
+#if defined(__AVX2__) && defined(__FMA__)
+    /**
+     * @brief Four doubles in an AVX2 register
+     *
+     */
+    struct AVX2Pack
+    {
+        typedef double T;
+        typedef __m256d V;
+        typedef __m256d M;
+        static constexpr size_t width = 4;
+
+        static V set1(double a) { return _mm256_set1_pd(a); }
+        static V load(const double *p) { return _mm256_loadu_pd(p); }
+        static void store(double *p, V a) { _mm256_storeu_pd(p, a); }
+        static V add(V a, V b) { return _mm256_add_pd(a, b); }
+        static V sub(V a, V b) { return _mm256_sub_pd(a, b); }
+        static V mul(V a, V b) { return _mm256_mul_pd(a, b); }
+        static V div(V a, V b) { return _mm256_div_pd(a, b); }
+        static V fmadd(V a, V b, V c) { return _mm256_fmadd_pd(a, b, c); }
+        static V sqrt(V a) { return _mm256_sqrt_pd(a); }
+        static V min(V a, V b) { return _mm256_min_pd(a, b); }
+        static V max(V a, V b) { return _mm256_max_pd(a, b); }
+        static V round(V a) { return _mm256_round_pd(a, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC); }
+        static M cmp_gt(V a, V b) { return _mm256_cmp_pd(a, b, _CMP_GT_OQ); }
+        static M cmp_eq(V a, V b) { return _mm256_cmp_pd(a, b, _CMP_EQ_OQ); }
+        static M mask_or(M a, M b) { return _mm256_or_pd(a, b); }
+        static V select(M m, V if_true, V if_false) { return _mm256_blendv_pd(if_false, if_true, m); }
+
+        static V bit_and(V a, uint64_t mask) { return _mm256_and_pd(a, _mm256_castsi256_pd(_mm256_set1_epi64x(int64_t(mask)))); }
+        static V bit_or(V a, uint64_t mask) { return _mm256_or_pd(a, _mm256_castsi256_pd(_mm256_set1_epi64x(int64_t(mask)))); }
+        template <int N>
+        static V shift_right(V a) { return _mm256_castsi256_pd(_mm256_srli_epi64(_mm256_castpd_si256(a), N)); }
+        template <int N>
+        static V shift_left(V a) { return _mm256_castsi256_pd(_mm256_slli_epi64(_mm256_castpd_si256(a), N)); }
+    };
+
+    /**
+     * @brief Eight floats in an AVX2 register
+     *
+     */
+    struct AVX2FloatPack
+    {
+        typedef float T;
+        typedef __m256 V;
+        typedef __m256 M;
+        static constexpr size_t width = 8;
+
+        static V set1(double a) { return _mm256_set1_ps(float(a)); }
+        static V load(const float *p) { return _mm256_loadu_ps(p); }
+        static void store(float *p, V a) { _mm256_storeu_ps(p, a); }
+        static V add(V a, V b) { return _mm256_add_ps(a, b); }
+        static V sub(V a, V b) { return _mm256_sub_ps(a, b); }
+        static V mul(V a, V b) { return _mm256_mul_ps(a, b); }
+        static V div(V a, V b) { return _mm256_div_ps(a, b); }
+        static V fmadd(V a, V b, V c) { return _mm256_fmadd_ps(a, b, c); }
+        static V sqrt(V a) { return _mm256_sqrt_ps(a); }
+        static V min(V a, V b) { return _mm256_min_ps(a, b); }
+        static V max(V a, V b) { return _mm256_max_ps(a, b); }
+        static V round(V a) { return _mm256_round_ps(a, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC); }
+        static M cmp_gt(V a, V b) { return _mm256_cmp_ps(a, b, _CMP_GT_OQ); }
+        static M cmp_eq(V a, V b) { return _mm256_cmp_ps(a, b, _CMP_EQ_OQ); }
+        static M mask_or(M a, M b) { return _mm256_or_ps(a, b); }
+        static V select(M m, V if_true, V if_false) { return _mm256_blendv_ps(if_false, if_true, m); }
+
+        static V bit_and(V a, uint64_t mask) { return _mm256_and_ps(a, _mm256_castsi256_ps(_mm256_set1_epi32(int32_t(mask)))); }
+        static V bit_or(V a, uint64_t mask) { return _mm256_or_ps(a, _mm256_castsi256_ps(_mm256_set1_epi32(int32_t(mask)))); }
+        template <int N>
+        static V shift_right(V a) { return _mm256_castsi256_ps(_mm256_srli_epi32(_mm256_castps_si256(a), N)); }
+        template <int N>
+        static V shift_left(V a) { return _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_castps_si256(a), N)); }
+    };
+#endif
+
+#if defined(__AVX512F__) && defined(__AVX512DQ__)
+    /**
+     * @brief Eight doubles in an AVX-512 register
+     *
+     */
+    struct AVX512Pack
+    {
+        typedef double T;
+        typedef __m512d V;
+        typedef __mmask8 M;
+        static constexpr size_t width = 8;
+
+        static V set1(double a) { return _mm512_set1_pd(a); }
+        static V load(const double *p) { return _mm512_loadu_pd(p); }
+        static void store(double *p, V a) { _mm512_storeu_pd(p, a); }
+        static V add(V a, V b) { return _mm512_add_pd(a, b); }
+        static V sub(V a, V b) { return _mm512_sub_pd(a, b); }
+        static V mul(V a, V b) { return _mm512_mul_pd(a, b); }
+        static V div(V a, V b) { return _mm512_div_pd(a, b); }
+        static V fmadd(V a, V b, V c) { return _mm512_fmadd_pd(a, b, c); }
+        static V sqrt(V a) { return _mm512_sqrt_pd(a); }
+        static V min(V a, V b) { return _mm512_min_pd(a, b); }
+        static V max(V a, V b) { return _mm512_max_pd(a, b); }
+        static V round(V a) { return _mm512_mask_roundscale_pd(a, 0xFF, a, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC); }
+        static M cmp_gt(V a, V b) { return _mm512_cmp_pd_mask(a, b, _CMP_GT_OQ); }
+        static M cmp_eq(V a, V b) { return _mm512_cmp_pd_mask(a, b, _CMP_EQ_OQ); }
+        static M mask_or(M a, M b) { return M(a | b); }
+        static V select(M m, V if_true, V if_false) { return _mm512_mask_blend_pd(m, if_false, if_true); }
+
+        static V bit_and(V a, uint64_t mask) { return _mm512_and_pd(a, _mm512_castsi512_pd(_mm512_set1_epi64(int64_t(mask)))); }
+        static V bit_or(V a, uint64_t mask) { return _mm512_or_pd(a, _mm512_castsi512_pd(_mm512_set1_epi64(int64_t(mask)))); }
+        template <int N>
+        static V shift_right(V a) { return _mm512_castsi512_pd(_mm512_srli_epi64(_mm512_castpd_si512(a), N)); }
+        template <int N>
+        static V shift_left(V a) { return _mm512_castsi512_pd(_mm512_slli_epi64(_mm512_castpd_si512(a), N)); }
+    };
+
+    /**
+     * @brief Sixteen floats in an AVX-512 register
+     *
+     */
+    struct AVX512FloatPack
+    {
+        typedef float T;
+        typedef __m512 V;
+        typedef __mmask16 M;
+        static constexpr size_t width = 16;
+
+        static V set1(double a) { return _mm512_set1_ps(float(a)); }
+        static V load(const float *p) { return _mm512_loadu_ps(p); }
+        static void store(float *p, V a) { _mm512_storeu_ps(p, a); }
+        static V add(V a, V b) { return _mm512_add_ps(a, b); }
+        static V sub(V a, V b) { return _mm512_sub_ps(a, b); }
+        static V mul(V a, V b) { return _mm512_mul_ps(a, b); }
+        static V div(V a, V b) { return _mm512_div_ps(a, b); }
+        static V fmadd(V a, V b, V c) { return _mm512_fmadd_ps(a, b, c); }
+        static V sqrt(V a) { return _mm512_sqrt_ps(a); }
+        static V min(V a, V b) { return _mm512_min_ps(a, b); }
+        static V max(V a, V b) { return _mm512_max_ps(a, b); }
+        static V round(V a) { return _mm512_mask_roundscale_ps(a, 0xFFFF, a, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC); }
+        static M cmp_gt(V a, V b) { return _mm512_cmp_ps_mask(a, b, _CMP_GT_OQ); }
+        static M cmp_eq(V a, V b) { return _mm512_cmp_ps_mask(a, b, _CMP_EQ_OQ); }
+        static M mask_or(M a, M b) { return M(a | b); }
+        static V select(M m, V if_true, V if_false) { return _mm512_mask_blend_ps(m, if_false, if_true); }
+
+        static V bit_and(V a, uint64_t mask) { return _mm512_and_ps(a, _mm512_castsi512_ps(_mm512_set1_epi32(int32_t(mask)))); }
+        static V bit_or(V a, uint64_t mask) { return _mm512_or_ps(a, _mm512_castsi512_ps(_mm512_set1_epi32(int32_t(mask)))); }
+        template <int N>
+        static V shift_right(V a) { return _mm512_castsi512_ps(_mm512_srli_epi32(_mm512_castps_si512(a), N)); }
+        template <int N>
+        static V shift_left(V a) { return _mm512_castsi512_ps(_mm512_slli_epi32(_mm512_castps_si512(a), N)); }
+    };
+#endif
+}
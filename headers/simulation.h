@@ -12,8 +12,12 @@
 #pragma once
 #include "../headers/pch.h"
 #include "../headers/nmc.h"
+#include "../headers/config.h"
+#include "../headers/time_grid.h"
+#include "../headers/shard.h"
 
 #include <map>
+#include <memory>
 
 /**
  * @brief Provides simulation functions on CPU
@@ -21,20 +25,83 @@
  */
 namespace CPUSimulation
 {
+    /**
+     * @brief Build the engine of the estimator of the configuration
+     *
+     * @param m0 Number of external paths
+     * @param m1 Number of internal paths
+     * @param grid Simulation points and exposure dates
+     * @param pool Thread pool running every stage
+     * @param config Risk factor models and estimator
+     * @param seed Seed of the random streams
+     * @param streaming Fold internal paths into running statistics instead of storing them
+     * @return std::unique_ptr<NMC> Engine
+     */
+    std::unique_ptr<NMC> make_engine(size_t m0, size_t m1, const TimeGrid &grid, ThreadPool &pool, const Config &config, RNG::Seed seed, bool streaming);
+
     /**
      * @brief Run the simulation on CPU
      *
      * @param xva XVA types
      * @param m0 Number of external paths
      * @param m1 Number of internal paths
-     * @param nb_points Number of points
-     * @param T Time horizon
-     * @param external_paths External paths simulated
-     * @param paths Paths simulated
+     * @param grid Simulation points and exposure dates
+     * @param external_paths External paths simulated, one value per
+     * simulation point
+     * @param paths Paths simulated, one row per XVA in the order of the map,
+     * one value per exposure date
+     * @param errors Monte Carlo standard errors, same layout as paths. Empty
+     * unless streaming is enabled.
+     * @param pfe Potential future exposure, one row per level of
+     * config.pfe_levels
+     * @param config Risk factor models
+     * @param nb_threads Number of threads, 0 for the hardware concurrency
+     * @param seed Seed of the random streams
+     * @param streaming Fold internal paths into running statistics instead of storing them
      */
     void run_simulation(const std::map<XVA, double>& xva,
                         size_t m0, size_t m1,
-                        size_t nb_points, double T,
-                        std::map<ExternalPaths, std::vector<Vector>> &external_paths,
-                        std::map<XVA, Vector> &paths);
+                        const TimeGrid &grid,
+                        std::map<ExternalPaths, PathBlock> &external_paths,
+                        PathBlock &paths,
+                        PathBlock &errors,
+                        PathBlock &pfe,
+                        const Config &config,
+                        size_t nb_threads = 0,
+                        RNG::Seed seed = RNG::default_seed,
+                        bool streaming = false);
+
+    /**
+     * @brief Run the nested estimator with its outer paths sharded over
+     * workers, and merge their statistics
+     *
+     * @param xva XVA types
+     * @param m0 Number of external paths
+     * @param m1 Number of internal paths
+     * @param grid Simulation points and exposure dates
+     * @param paths Paths simulated, one row per XVA in the order of the map,
+     * one value per exposure date
+     * @param errors Monte Carlo standard errors, same layout as paths
+     * @param pfe Potential future exposure, one row per level of
+     * config.pfe_levels
+     * @param config Risk factor models
+     * @param launcher Launcher of the workers
+     * @param nb_shards Number of shards
+     * @param nb_threads Number of threads of every worker, 0 for its share
+     * of the hardware concurrency
+     * @param seed Seed of the random streams
+     * @throws Exception If the estimator is not nested, or control variates
+     * are requested
+     */
+    void run_sharded(const std::map<XVA, double>& xva,
+                     size_t m0, size_t m1,
+                     const TimeGrid &grid,
+                     PathBlock &paths,
+                     PathBlock &errors,
+                     PathBlock &pfe,
+                     const Config &config,
+                     Shard::Launcher &launcher,
+                     size_t nb_shards,
+                     size_t nb_threads = 0,
+                     RNG::Seed seed = RNG::default_seed);
 }
\ No newline at end of file
@@ -0,0 +1,204 @@
+/**
+ * @file sketch.h
+ * @author Thomas Roiseux (thomas.roiseux@mathquantlab.com)
+ * @brief Provides mergeable streaming quantile sketches
+ * @version 1.0
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+
+#pragma once
+
+#include "../headers/pch.h"
+#include "../headers/path_block.h"
+
+#include <vector>
+#include <iostream>
+
+/**
+ * @brief Weighted quantile sketch of a stream of values (merging t-digest)
+ *
+ * Values are clustered into centroids whose size shrinks towards both ends
+ * of the distribution (arcsine scale), so the tail quantiles are resolved
+ * finely while the memory stays O(compression) whatever the number of
+ * values. Sketches of disjoint streams merge into the sketch of their union.
+ */
+class QuantileSketch
+{
+public:
+    /**
+     * @brief Default compression, bounding the number of centroids
+     *
+     */
+    static constexpr double default_compression = 500;
+
+    /**
+     * @brief Construct a new QuantileSketch object
+     *
+     * @param compression Compression, about the number of centroids kept
+     */
+    explicit QuantileSketch(double compression = default_compression);
+
+    /**
+     * @brief Fold a value in
+     *
+     * @param x Value
+     * @param weight Weight, the likelihood ratio of an importance sample
+     */
+    void add(double x, double weight = 1);
+
+    /**
+     * @brief Fold the values of another sketch in
+     *
+     * @param other Sketch to merge
+     */
+    void merge(const QuantileSketch &other);
+
+    /**
+     * @brief Get the number of values folded in
+     *
+     * @return size_t Number of values
+     */
+    size_t count() const noexcept { return m_count; }
+
+    /**
+     * @brief Merge the pending values into the centroids and release their
+     * buffer, before the sketch is kept for a while
+     *
+     */
+    void flush();
+
+    /**
+     * @brief Get a quantile
+     *
+     * The upper tail is read relative to the number of values rather than
+     * to their total weight, the unbiased estimator of a tail probability
+     * under importance sampling; both agree for unit weights.
+     *
+     * @param level Quantile level, in [0, 1]
+     * @return double Quantile, 0 for an empty sketch
+     */
+    double quantile(double level) const;
+
+    /**
+     * @brief Write the sketch in binary, for another process to merge
+     *
+     * @param out Stream
+     */
+    void write(std::ostream &out) const;
+
+    /**
+     * @brief Read a sketch written by write
+     *
+     * @param in Stream
+     * @throws Exception If the stream is truncated
+     */
+    void read(std::istream &in);
+
+private:
+    /**
+     * @brief Cluster of values
+     *
+     */
+    struct Centroid
+    {
+        double mean;
+        double weight;
+    };
+
+    /**
+     * @brief Merge the pending values into the centroids
+     *
+     */
+    void compress();
+
+    double m_compression;
+    size_t m_count;
+    double m_total;
+    double m_min;
+    double m_max;
+    std::vector<Centroid> m_centroids;
+    std::vector<Centroid> m_buffer;
+};
+
+/**
+ * @brief Quantile sketches of paths, point by point
+ *
+ * The streaming counterpart of PathAccumulator for quantiles: every worker
+ * sketches its own paths and the sketches are merged, memory being
+ * O(nb_points * compression).
+ */
+class PathSketch
+{
+public:
+    /**
+     * @brief Construct a new PathSketch object
+     *
+     * @param nb_points Number of points per path
+     */
+    explicit PathSketch(size_t nb_points = 0) : m_points(nb_points) {}
+
+    /**
+     * @brief Fold a path in
+     *
+     * @param path Path, one value per point
+     */
+    void add(PathView<const double> path);
+
+    /**
+     * @brief Fold a weighted path in
+     *
+     * @param path Path, one value per point
+     * @param weights Weight of every point
+     */
+    void add(PathView<const double> path, PathView<const double> weights);
+
+    /**
+     * @brief Fold the paths of another sketch in
+     *
+     * @param other Sketch to merge
+     */
+    void merge(const PathSketch &other);
+
+    /**
+     * @brief Release the buffers of every point, see QuantileSketch::flush
+     *
+     */
+    void flush();
+
+    /**
+     * @brief Get the number of points per path
+     *
+     * @return size_t Number of points
+     */
+    size_t nb_points() const noexcept { return m_points.size(); }
+
+    /**
+     * @brief Get a quantile at a point
+     *
+     * @param j Point index
+     * @param level Quantile level
+     * @return double Quantile
+     */
+    double quantile(size_t j, double level) const { return m_points[j].quantile(level); }
+
+    /**
+     * @brief Write the sketches in binary, see QuantileSketch::write
+     *
+     * @param out Stream
+     */
+    void write(std::ostream &out) const;
+
+    /**
+     * @brief Read sketches written by write
+     *
+     * @param in Stream
+     * @throws Exception If the stream is truncated
+     */
+    void read(std::istream &in);
+
+private:
+    std::vector<QuantileSketch> m_points;
+};
@@ -0,0 +1,165 @@
+/**
+ * @file thread_pool.h
+ * @author Thomas Roiseux (thomas.roiseux@mathquantlab.com)
+ * @brief Provides a work-stealing thread pool
+ * @version 1.0
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+
+#pragma once
+
+#include "../headers/pch.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+/**
+ * @brief Persistent work-stealing thread pool
+ *
+ * Each worker owns a queue of tasks. A worker pops its own tasks from the
+ * back of its queue and, once it is empty, steals from the front of the
+ * other queues. A thread waiting for a parallel loop to complete runs
+ * pending tasks instead of blocking, so parallel loops can be nested.
+ *
+ * The queues of the workers are spread over the NUMA nodes in contiguous
+ * blocks, and the chunks of a loop are dealt to them by their position in
+ * its range: the loops over the same paths send every path to the same node
+ * whatever their grain. Thieves steal from the queues of their own node
+ * first. Workers are pinned to the CPUs of their node if NUMA::pinning is
+ * set. The calling thread is left unpinned, so it is dealt no chunk and
+ * only steals.
+ */
+class ThreadPool
+{
+public:
+    /**
+     * @brief Loop body, called with a half-open range [begin, end)
+     *
+     */
+    typedef std::function<void(size_t, size_t)> RangeFunction;
+
+    /**
+     * @brief Construct a new ThreadPool object
+     *
+     * The calling thread takes part in the loops it submits, so nb_threads - 1
+     * workers are started.
+     *
+     * @param nb_threads Number of threads, 0 for the hardware concurrency
+     */
+    explicit ThreadPool(size_t nb_threads = 0);
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    /**
+     * @brief Destroy the ThreadPool object, after all workers are joined
+     *
+     */
+    ~ThreadPool();
+
+    /**
+     * @brief Get the number of threads, including the calling thread
+     *
+     * @return size_t Number of threads
+     */
+    size_t size() const noexcept { return m_workers.size() + 1; }
+
+    /**
+     * @brief Run a loop in parallel and wait for its completion
+     *
+     * The range is split in chunks of grain iterations which are spread over
+     * the workers. The first exception thrown by the body is rethrown once
+     * every chunk is done.
+     *
+     * @param begin First index
+     * @param end Past the last index
+     * @param grain Number of iterations per chunk, 0 to choose it from the pool size
+     * @param body Loop body
+     */
+    void parallel_for(size_t begin, size_t end, size_t grain, const RangeFunction &body);
+
+private:
+    /**
+     * @brief Parallel loop being run
+     *
+     */
+    struct Job
+    {
+        const RangeFunction *body;
+        std::atomic<size_t> pending;
+        std::exception_ptr error;
+        std::mutex error_mutex;
+    };
+
+    /**
+     * @brief Chunk of a parallel loop
+     *
+     */
+    struct Task
+    {
+        Job *job;
+        size_t begin;
+        size_t end;
+    };
+
+    /**
+     * @brief Task queue owned by a worker
+     *
+     */
+    struct Queue
+    {
+        std::deque<Task> tasks;
+        std::mutex mutex;
+    };
+
+    /**
+     * @brief Worker main loop
+     *
+     * @param index Worker index
+     */
+    void worker_loop(size_t index);
+
+    /**
+     * @brief Pop a task from a queue, then steal one from the other queues,
+     * those of the same node first
+     *
+     * @param index Queue to pop from first
+     * @param task Task found
+     * @return true A task was found
+     * @return false Every queue is empty
+     */
+    bool find_task(size_t index, Task &task);
+
+    /**
+     * @brief Run a task and mark it as done
+     *
+     * @param task Task to run
+     */
+    static void execute(const Task &task);
+
+    std::vector<std::thread> m_workers;
+    std::vector<std::unique_ptr<Queue>> m_queues;
+    /**
+     * @brief Queues visited by find_task, per queue: its own, those of its
+     * node, then the others
+     *
+     */
+    std::vector<std::vector<size_t>> m_steal_order;
+    /**
+     * @brief Node of every queue, an index of NUMA::nodes
+     *
+     */
+    std::vector<size_t> m_nodes;
+    std::atomic<size_t> m_queued;
+    std::atomic<bool> m_stop;
+    std::mutex m_sleep_mutex;
+    std::condition_variable m_sleep;
+};
@@ -0,0 +1,153 @@
+/**
+ * @file time_grid.h
+ * @author Thomas Roiseux (thomas.roiseux@mathquantlab.com)
+ * @brief Provides the simulation and exposure dates
+ * @version 1.0
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+
+#pragma once
+
+#include "../headers/pch.h"
+#include "../headers/config.h"
+#include "../headers/models.h"
+
+#include <vector>
+#include <algorithm>
+
+/**
+ * @brief Time grid of a run
+ *
+ * Paths are simulated at the simulation points, starting at 0, and only
+ * the exposure dates, a subset of them, go through the reduction and the
+ * payoffs. Models with exact transitions jump from one exposure date to the
+ * next in a single step whatever its length; the others are sub-stepped
+ * every grid.step at most, T / N by default.
+ */
+class TimeGrid
+{
+public:
+    /**
+     * @brief Construct a new uniform TimeGrid object: the points j T / N,
+     * j < N, every one an exposure date
+     *
+     * @param nb_points Number of points N
+     * @param T Horizon
+     */
+    explicit TimeGrid(size_t nb_points = 0, double T = 0);
+
+    /**
+     * @brief Construct a new TimeGrid object from the grid keys of a
+     * configuration
+     *
+     * @param config Configuration, see Config::grid_dates, grid_growth and
+     * grid_step
+     * @param nb_points Number of points N, unless the dates are listed
+     * @param T Horizon
+     * @throws Exception If the grid has no exposure date, or a date beyond
+     * the horizon
+     */
+    TimeGrid(const Config &config, size_t nb_points, double T);
+
+    /**
+     * @brief Get the number of simulation points, the initial one included
+     *
+     * @return size_t Number of points
+     */
+    size_t nb_points() const noexcept { return m_times.size(); }
+
+    /**
+     * @brief Get the number of exposure dates
+     *
+     * @return size_t Number of dates
+     */
+    size_t nb_dates() const noexcept { return m_exposures.size(); }
+
+    /**
+     * @brief Get the horizon
+     *
+     * @return double Horizon
+     */
+    double horizon() const noexcept { return m_horizon; }
+
+    /**
+     * @brief Get the time of a simulation point
+     *
+     * @param j Point index
+     * @return double Time
+     */
+    double time(size_t j) const { return m_times[j]; }
+
+    /**
+     * @brief Get the simulation point of an exposure date
+     *
+     * @param d Date index
+     * @return size_t Point index
+     */
+    size_t point(size_t d) const { return m_exposures[d]; }
+
+    /**
+     * @brief Get the time of an exposure date
+     *
+     * @param d Date index
+     * @return double Time
+     */
+    double date(size_t d) const { return m_times[m_exposures[d]]; }
+
+    /**
+     * @brief Get the times of every exposure date
+     *
+     * @return Vector Times
+     */
+    Vector dates() const;
+
+    /**
+     * @brief Get the length of every simulation step
+     *
+     * @return Vector Lengths, the step j leading to the point j + 1
+     */
+    Vector steps() const;
+
+    /**
+     * @brief Whether this is the uniform grid of N points, every one an
+     * exposure date
+     *
+     * @return true Uniform grid
+     * @return false Listed, spaced or sub-stepped dates
+     */
+    bool uniform() const noexcept { return m_uniform; }
+
+    /**
+     * @brief Precompute the constants of a model over consecutive steps
+     *
+     * @tparam Model Model policy
+     * @param parameters Model parameters
+     * @param first First point
+     * @param length Number of points
+     * @param constants Constants, constants[k] leading to the point first + k
+     * for 0 < k < length
+     */
+    template <class Model>
+    void precompute(const Models::Parameters &parameters, size_t first, size_t length, std::vector<typename Model::Constants> &constants) const
+    {
+        constants.resize(length);
+        if (m_uniform)
+        {
+            std::fill(constants.begin(), constants.end(), Model::precompute(parameters, m_horizon / double(m_times.size())));
+            return;
+        }
+        for (size_t k = 1; k < length; k++)
+        {
+            constants[k] = Model::precompute(parameters, m_times[first + k] - m_times[first + k - 1]);
+        }
+    }
+
+private:
+    double m_horizon;
+    bool m_uniform;
+    std::vector<double> m_times;
+    std::vector<size_t> m_exposures;
+};
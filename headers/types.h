@@ -0,0 +1,115 @@
+/**
+ * @file types.h
+ * @author Thomas Roiseux (thomas.roiseux@mathquantlab.com)
+ * @brief Provides the data types shared by every backend
+ * @version 1.0
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+
+#pragma once
+
+#include <string>
+#include <exception>
+#include <vector>
+
+/**
+ * @brief Exception class
+ *
+ */
+class Exception : public std::exception
+{
+public:
+    /**
+     * @brief Construct a new Exception object
+     *
+     * @param message Exception message
+     */
+    Exception(const std::string &message) : m_message(message) {}
+
+    /**
+     * @brief Destroy the Exception object
+     *
+     */
+    virtual ~Exception() = default;
+
+    /**
+     * @brief Get the exception message
+     *
+     * @return const char* Exception message
+     */
+    virtual const char *what() const noexcept override { return m_message.c_str(); }
+
+    /**
+     * @brief Get the exit code of the program failing with the exception
+     *
+     * @return int Exit code
+     */
+    virtual int code() const noexcept { return 1; }
+
+protected:
+    std::string m_message;
+};
+
+/**
+ * @brief XVA types
+ * 
+ */
+enum XVA
+{
+    /**
+     * @brief Credit Valuation Adjustment
+     * 
+     */
+    CVA,
+    /**
+     * @brief Debit Valuation Adjustment
+     * 
+     */
+    DVA,
+    /**
+     * @brief Funding Valuation Adjustment
+     * 
+     */
+    FVA,
+    /**
+     * @brief Margin Valuation Adjustment
+     * 
+     */
+    MVA,
+    /**
+     * @brief Capital Valuation Adjustment
+     * 
+     */
+    KVA
+};
+
+/**
+ * @brief Vector type for double
+ * 
+ */
+typedef std::vector<double> Vector;
+
+/**
+ * @brief External paths
+ * 
+ */
+enum ExternalPaths {
+    /**
+     * @brief Interest rate
+     * 
+     */
+    Interest,
+    /**
+     * @brief FX
+     * 
+     */
+    FX,
+    /**
+     * @brief Equity
+     * 
+     */
+    Equity
+};
@@ -12,6 +12,11 @@
 #pragma once
 
 #include "../headers/pch.h"
+#include "../headers/path_block.h"
+#include "../headers/rng.h"
+#include "../headers/config.h"
+#include "../headers/sensitivities.h"
+#include "../headers/backend.h"
 
 #include <map>
 
@@ -33,9 +38,12 @@ namespace Utils
      *
      * @param argc Number of arguments
      * @param argv Arguments
-     * @param gpu GPU flag
+     * @param backend Backend selection and options, the GPU being only
+     * probed when the backend is created
+     * @param seed Seed of the random streams
+     * @param config Run configuration, loaded from --config files
      */
-    int parse_options(int argc, char *argv[], bool &gpu);
+    int parse_options(int argc, char *argv[], Backend::Options &backend, RNG::Seed &seed, Config &config);
 
     /**
      * @brief Parse mandatory arguments
@@ -74,12 +82,34 @@ namespace Utils
      */
     const char *pretty_print_xva_name(XVA xva);
 
+    /**
+     * @brief Pretty print risk factor name
+     *
+     * @param factor Risk factor
+     * @return const char* Risk factor name
+     */
+    const char *pretty_print_factor_name(ExternalPaths factor);
+
     /**
      * @brief Print results
      *
-     * @param results Results
+     * @param xvas XVA types, in the order of the rows of the results
+     * @param results Results, one row per XVA
+     * @param errors Standard errors, same layout as results. Written next to
+     * each XVA when not empty.
+     * @param pfe Potential future exposure, one row per level, written after
+     * the XVA columns
+     * @param levels Level of every row of the potential future exposure
+     * @param filename Filename
+     * @param dates Time of every exposure date, one per row of the file
+     */
+    void print_results(const std::map<XVA, double> &xvas, const PathBlock &results, const PathBlock &errors, const PathBlock &pfe, const std::vector<double> &levels, const std::string &filename, const std::vector<double> &dates);
+
+    /**
+     * @brief Print sensitivities, one row per parameter and XVA
+     *
+     * @param sensitivities Sensitivities
      * @param filename Filename
-     * @param T Horizon
      */
-    void print_results(const std::map<XVA, Vector> &results, const std::string &filename, double T);
+    void print_sensitivities(const std::vector<Sensitivity> &sensitivities, const std::string &filename);
 }
\ No newline at end of file
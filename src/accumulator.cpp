@@ -0,0 +1,96 @@
+/**
+ * @file accumulator.cpp
+ * @author Thomas Roiseux (thomas.roiseux@mathquantlab.com)
+ * @brief Implements {@link accumulator.h}
+ * @version 1.0
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+
+#include "../headers/accumulator.h"
+
+#include <cmath>
+#include <cstdint>
+
+void PathAccumulator::reset(size_t nb_points)
+{
+    m_count = 0;
+    m_mean.assign(nb_points, 0.0);
+    m_m2.assign(nb_points, 0.0);
+}
+
+void PathAccumulator::add(PathView<const double> path)
+{
+    m_count++;
+    double weight = 1.0 / m_count;
+    double *mean = m_mean.data();
+    double *m2 = m_m2.data();
+    for (size_t j = 0; j < m_mean.size(); j++)
+    {
+        double delta = path[j] - mean[j];
+        mean[j] += delta * weight;
+        m2[j] += delta * (path[j] - mean[j]);
+    }
+}
+
+void PathAccumulator::merge(const PathAccumulator &other)
+{
+    if (other.m_count == 0)
+    {
+        return;
+    }
+    if (m_count == 0)
+    {
+        *this = other;
+        return;
+    }
+
+    // Chan et al. pairwise update
+    double na = double(m_count);
+    double nb = double(other.m_count);
+    double n = na + nb;
+    for (size_t j = 0; j < m_mean.size(); j++)
+    {
+        double delta = other.m_mean[j] - m_mean[j];
+        m_mean[j] += delta * nb / n;
+        m_m2[j] += other.m_m2[j] + delta * delta * na * nb / n;
+    }
+    m_count += other.m_count;
+}
+
+double PathAccumulator::variance(size_t j) const noexcept
+{
+    return m_count > 1 ? m_m2[j] / (m_count - 1) : 0.0;
+}
+
+double PathAccumulator::standard_error(size_t j) const noexcept
+{
+    return m_count > 0 ? std::sqrt(variance(j) / m_count) : 0.0;
+}
+
+void PathAccumulator::write(std::ostream &out) const
+{
+    uint64_t header[2] = {m_count, m_mean.size()};
+    out.write(reinterpret_cast<const char *>(header), sizeof(header));
+    out.write(reinterpret_cast<const char *>(m_mean.data()), std::streamsize(m_mean.size() * sizeof(double)));
+    out.write(reinterpret_cast<const char *>(m_m2.data()), std::streamsize(m_m2.size() * sizeof(double)));
+}
+
+void PathAccumulator::read(std::istream &in)
+{
+    uint64_t header[2];
+    if (!in.read(reinterpret_cast<char *>(header), sizeof(header)))
+    {
+        throw Exception("Truncated path accumulator");
+    }
+    reset(size_t(header[1]));
+    m_count = size_t(header[0]);
+    in.read(reinterpret_cast<char *>(m_mean.data()), std::streamsize(m_mean.size() * sizeof(double)));
+    in.read(reinterpret_cast<char *>(m_m2.data()), std::streamsize(m_m2.size() * sizeof(double)));
+    if (!in)
+    {
+        throw Exception("Truncated path accumulator");
+    }
+}
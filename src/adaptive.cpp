@@ -0,0 +1,159 @@
+/**
+ * @file adaptive.cpp
+ * @author Thomas Roiseux (thomas.roiseux@mathquantlab.com)
+ * @brief Implements {@link adaptive.h}
+ * @version 1.0
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+
+#include "../headers/adaptive.h"
+#include "../headers/simd.h"
+
+#include <iostream>
+#include <thread>
+#include <cmath>
+#include <limits>
+#include <algorithm>
+
+void AdaptiveNMC::run(XVA xva, double factor, const std::map<ExternalPaths, PathBlock> &external_paths, PathView<double> final_path) const
+{
+    std::cout << "Running adaptive NMC for XVA " << Utils::pretty_print_xva_name(xva) << " on thread " << std::this_thread::get_id() << " with factor " << factor << std::endl;
+
+    PathBlock paths, errors, pfe;
+    run({{xva, factor}}, external_paths, paths, errors, pfe);
+    for (size_t i = 0; i < nb_dates; i++)
+    {
+        final_path[i] = paths(0, i);
+    }
+}
+
+void AdaptiveNMC::run(const std::map<XVA, double> &xvas, const std::map<ExternalPaths, PathBlock> &external_paths, PathBlock &final_paths, PathBlock &errors, PathBlock &pfe) const
+{
+    size_t nb_nodes = size_t(m0) * nb_dates;
+    size_t max_inner = std::max<size_t>(size_t(m1), 1);
+    size_t budget = config.adaptive_budget ? config.adaptive_budget : nb_nodes * max_inner;
+    if (budget < nb_nodes)
+    {
+        throw Exception("The adaptive budget must give every outer node a pilot path: at least " + std::to_string(nb_nodes) + " inner paths");
+    }
+    size_t pilot = std::min(SIMD::group, max_inner);
+    if (nb_nodes > 0 && budget / nb_nodes < pilot)
+    {
+        pilot = budget / nb_nodes;
+    }
+
+    std::cout << "Running adaptive NMC for " << xvas.size() << " XVA with a budget of " << budget << " inner paths on thread " << std::this_thread::get_id() << std::endl;
+
+    std::vector<double> kinks;
+    for (auto const &xva : xvas)
+    {
+        kinks.push_back(xva.second);
+    }
+
+    std::vector<Node> nodes(nb_nodes, Node{0, 0.0, 0.0});
+    std::vector<std::pair<size_t, size_t>> batches;
+    for (size_t n = 0; n < nb_nodes; n++)
+    {
+        batches.emplace_back(n, pilot);
+    }
+    refine(external_paths, nodes, batches);
+    size_t spent = nb_nodes * pilot;
+
+    // Rounds double the inner paths of the uncertain nodes, closest to a kink first
+    for (;;)
+    {
+        std::vector<std::pair<double, size_t>> candidates;
+        for (size_t n = 0; n < nb_nodes; n++)
+        {
+            double distance = kink_distance(nodes[n], kinks);
+            if (nodes[n].count < max_inner && distance < config.adaptive_threshold)
+            {
+                candidates.emplace_back(distance, n);
+            }
+        }
+        std::sort(candidates.begin(), candidates.end());
+
+        batches.clear();
+        for (auto const &candidate : candidates)
+        {
+            if (spent >= budget)
+            {
+                break;
+            }
+            const Node &node = nodes[candidate.second];
+            size_t count = std::min({node.count, max_inner - node.count, budget - spent});
+            if (count == 0)
+            {
+                break;
+            }
+            batches.emplace_back(candidate.second, count);
+            spent += count;
+        }
+        if (batches.empty())
+        {
+            break;
+        }
+        refine(external_paths, nodes, batches);
+    }
+
+    PathBlock values(size_t(m0), nb_dates);
+    size_t refined = 0, untouched = 0;
+    for (size_t n = 0; n < nb_nodes; n++)
+    {
+        values(n / nb_dates, n % nb_dates) = nodes[n].sum / nodes[n].count;
+        refined += nodes[n].count == max_inner;
+        untouched += nodes[n].count == pilot && pilot < max_inner;
+    }
+
+    std::cout << "Adaptive inner paths: " << spent << " of a budget of " << budget << ", nested Monte Carlo: " << nb_nodes * max_inner
+              << " (" << double(nb_nodes * max_inner) / spent << "x)" << std::endl;
+    std::cout << "Outer nodes: " << nb_nodes << ", refined to " << max_inner << " inner paths: " << refined
+              << ", left at the pilot batch: " << untouched << std::endl;
+
+    reduce_nested(xvas, external_paths, values, final_paths, errors, pfe);
+}
+
+double AdaptiveNMC::kink_distance(const Node &node, const std::vector<double> &kinks)
+{
+    double mean = node.sum / node.count;
+    double variance = node.count > 1 ? std::max(node.sum_squares - node.sum * mean, 0.0) / (node.count - 1) : 0.0;
+    double standard_error = std::sqrt(variance / node.count);
+
+    double distance = std::numeric_limits<double>::infinity();
+    for (double kink : kinks)
+    {
+        if (node.count == 1 || mean == kink)
+        {
+            return 0.0;
+        }
+        if (standard_error > 0)
+        {
+            distance = std::min(distance, std::abs(mean - kink) / standard_error);
+        }
+    }
+    return distance;
+}
+
+void AdaptiveNMC::refine(const std::map<ExternalPaths, PathBlock> &external_paths, std::vector<Node> &nodes, const std::vector<std::pair<size_t, size_t>> &batches) const
+{
+    // Each batch touches its own node, so batches run in any order
+    pool->parallel_for(0, batches.size(), 1, [&](size_t begin, size_t end)
+                       {
+        std::map<ExternalPaths, PathBlock> inner_paths;
+        for (auto const &external_path : external_paths)
+        {
+            inner_paths[external_path.first].resize(SIMD::group, nb_points);
+        }
+
+        for (size_t b = begin; b < end; b++)
+        {
+            Node &node = nodes[batches[b].first];
+            size_t outer = batches[b].first / nb_dates;
+            size_t date = batches[b].first % nb_dates;
+            node.sum += inner_sum(external_paths, outer, outer, grid.point(date), node.count, batches[b].second, inner_paths, &node.sum_squares);
+            node.count += batches[b].second;
+        } });
+}
@@ -0,0 +1,167 @@
+/**
+ * @file backend.cpp
+ * @author Thomas Roiseux (thomas.roiseux@mathquantlab.com)
+ * @brief Implements {@link backend.h}, but the GPU backend
+ * @version 1.0
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+
+#include "../headers/backend.h"
+#include "../headers/simulation.h"
+#include "../headers/simd.h"
+#include "../headers/numa.h"
+#include "../headers/shard.h"
+#include "../headers/utils.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <thread>
+
+std::unique_ptr<Backend> Backend::create(const Options &options)
+{
+    if (options.name != "auto" && options.name != "cpu" && options.name != "gpu")
+    {
+        throw Exception("Unknown backend: " + options.name);
+    }
+    if (options.name == "gpu" && !gpu_built())
+    {
+        throw Exception("This binary is built without CUDA, use the CPU backend");
+    }
+
+#ifndef XVA_CPU_ONLY
+    if (options.name == "gpu" || (options.name == "auto" && GPUBackend::available()))
+    {
+        return std::make_unique<GPUBackend>(options);
+    }
+#endif
+    return std::make_unique<CPUBackend>(options);
+}
+
+bool Backend::gpu_built() noexcept
+{
+#ifdef XVA_CPU_ONLY
+    return false;
+#else
+    return true;
+#endif
+}
+
+std::vector<Sensitivity> Backend::sensitivities(const std::map<XVA, double> &, size_t, size_t, const TimeGrid &,
+                                                const PathBlock &, const Config &, RNG::Seed)
+{
+    throw Exception("Sensitivities are computed on CPU only");
+}
+
+/**
+ * @brief Print the accuracy of a run in float or mixed precision against the
+ * double precision run of the same seed
+ *
+ * The XVA are compared on their sum over the exposure dates, the largest
+ * difference at a date in standard errors of the reference when they are
+ * estimated.
+ *
+ * @param xva XVA types
+ * @param config Configuration of the run
+ * @param paths Paths of the run
+ * @param reference Paths of the double precision run
+ * @param errors Standard errors of the double precision run, possibly empty
+ * @param seconds Duration of the run
+ * @param reference_seconds Duration of the double precision run
+ */
+static void report_accuracy(const std::map<XVA, double> &xva, const Config &config, const PathBlock &paths, const PathBlock &reference,
+                            const PathBlock &errors, double seconds, double reference_seconds)
+{
+    std::cout << "Accuracy of " << precision_name(config.precision) << " against double on the same seed:" << std::endl;
+
+    size_t k = 0;
+    for (auto const &requested : xva)
+    {
+        double total = 0, reference_total = 0, largest = 0;
+        for (size_t d = 0; d < paths.nb_points(); d++)
+        {
+            total += paths(k, d);
+            reference_total += reference(k, d);
+            double difference = std::abs(paths(k, d) - reference(k, d));
+            if (errors.nb_paths() > 0)
+            {
+                difference = errors(k, d) > 0 ? difference / errors(k, d) : 0.0;
+            }
+            largest = std::max(largest, difference);
+        }
+
+        std::cout << "  " << Utils::pretty_print_xva_name(requested.first) << ": " << total << " against " << reference_total
+                  << ", relative difference " << (reference_total != 0 ? std::abs(total - reference_total) / std::abs(reference_total) : 0.0)
+                  << ", largest difference at a date " << largest << (errors.nb_paths() > 0 ? " standard errors" : "") << std::endl;
+        k++;
+    }
+
+    // The normals are drawn in double either way, so float paths only save
+    // time once the internal paths no longer fit in cache
+    double speedup = reference_seconds / seconds;
+    std::cout << "  Time: " << seconds << " s against " << reference_seconds << " s, ";
+    if (speedup > 1)
+    {
+        std::cout << "speedup " << speedup << "x" << std::endl;
+    }
+    else
+    {
+        std::cout << "no speedup, " << speedup << "x the speed of double: float paths only pay off when memory bandwidth dominates, at large m1 * N" << std::endl;
+    }
+}
+
+void CPUBackend::run(const std::map<XVA, double> &xva, size_t m0, size_t m1, const TimeGrid &grid,
+                     PathBlock &paths, PathBlock &errors, PathBlock &pfe, const Config &config, RNG::Seed seed)
+{
+    std::cout << "Running on CPU with maximum " << (m_threads ? m_threads : std::thread::hardware_concurrency()) << " threads simultaneously." << std::endl;
+    std::cout << "Instruction set: " << SIMD::name(SIMD::active()) << std::endl;
+    if (NUMA::nodes().size() > 1 || NUMA::pinning() || NUMA::pages() != NUMA::Default)
+    {
+        std::cout << "NUMA: " << NUMA::nodes().size() << " nodes" << (NUMA::pinning() ? ", workers pinned per node" : "")
+                  << ", huge pages: " << NUMA::pages_name(NUMA::pages()) << std::endl;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    simulate(xva, m0, m1, grid, paths, errors, pfe, config, seed);
+    if (config.precision == Precision::Double)
+    {
+        return;
+    }
+    std::chrono::duration<double> duration = std::chrono::steady_clock::now() - start;
+
+    // The reference draws the same normals, so the difference is the rounding only
+    std::cout << "Running the double precision reference" << std::endl;
+    Config reference_config = config;
+    reference_config.precision = Precision::Double;
+    PathBlock reference, reference_errors, reference_pfe;
+    start = std::chrono::steady_clock::now();
+    simulate(xva, m0, m1, grid, reference, reference_errors, reference_pfe, reference_config, seed);
+    std::chrono::duration<double> reference_duration = std::chrono::steady_clock::now() - start;
+
+    report_accuracy(xva, config, paths, reference, reference_errors, duration.count(), reference_duration.count());
+}
+
+void CPUBackend::simulate(const std::map<XVA, double> &xva, size_t m0, size_t m1, const TimeGrid &grid,
+                          PathBlock &paths, PathBlock &errors, PathBlock &pfe, const Config &config, RNG::Seed seed) const
+{
+    if (m_shards > 0)
+    {
+        Shard::ForkLauncher launcher;
+        CPUSimulation::run_sharded(xva, m0, m1, grid, paths, errors, pfe, config, launcher, m_shards, m_threads, seed);
+    }
+    else
+    {
+        std::map<ExternalPaths, PathBlock> external_paths;
+        CPUSimulation::run_simulation(xva, m0, m1, grid, external_paths, paths, errors, pfe, config, m_threads, seed, m_streaming);
+    }
+}
+
+std::vector<Sensitivity> CPUBackend::sensitivities(const std::map<XVA, double> &xva, size_t m0, size_t m1, const TimeGrid &grid,
+                                                   const PathBlock &paths, const Config &config, RNG::Seed seed)
+{
+    return Sensitivities::compute(xva, m0, m1, grid, paths, config, m_threads, seed, m_streaming);
+}
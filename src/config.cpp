@@ -0,0 +1,498 @@
+/**
+ * @file config.cpp
+ * @author Thomas Roiseux (thomas.roiseux@mathquantlab.com)
+ * @brief Implements {@link config.h}
+ * @version 1.0
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+
+#include "../headers/config.h"
+
+#include <fstream>
+#include <cstdio>
+#include <algorithm>
+
+/**
+ * @brief Remove leading and trailing blanks
+ *
+ * @param str String
+ * @return std::string Trimmed string
+ */
+static std::string trim(const std::string &str)
+{
+    size_t begin = str.find_first_not_of(" \t\r");
+    if (begin == std::string::npos)
+    {
+        return "";
+    }
+    size_t end = str.find_last_not_of(" \t\r");
+    return str.substr(begin, end - begin + 1);
+}
+
+/**
+ * @brief Parse an external factor name
+ *
+ * @param name Name (interest, fx, equity)
+ * @param factor Risk factor
+ * @return true Name is an external factor
+ * @return false Name is unknown
+ */
+static bool parse_factor(const std::string &name, ExternalPaths &factor)
+{
+    if (name == "interest")
+    {
+        factor = ExternalPaths::Interest;
+    }
+    else if (name == "fx")
+    {
+        factor = ExternalPaths::FX;
+    }
+    else if (name == "equity")
+    {
+        factor = ExternalPaths::Equity;
+    }
+    else
+    {
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Parse a comma-separated list of numbers, sorted in increasing order
+ *
+ * @tparam Predicate Callable taking a number
+ * @param key Key, for the error message
+ * @param value Value
+ * @param valid Whether a number is in range
+ * @return std::vector<double> Numbers
+ * @throws Exception If a number is invalid
+ */
+template <class Predicate>
+static std::vector<double> parse_list(const std::string &key, const std::string &value, Predicate valid)
+{
+    std::vector<double> list;
+    size_t begin = 0;
+    while (begin <= value.size())
+    {
+        size_t end = std::min(value.find(',', begin), value.size());
+        double number;
+        if (sscanf(trim(value.substr(begin, end - begin)).c_str(), "%lf", &number) != 1 || !valid(number))
+        {
+            throw Exception("Invalid value for " + key + ": " + value);
+        }
+        list.push_back(number);
+        begin = end + 1;
+    }
+    std::sort(list.begin(), list.end());
+    return list;
+}
+
+Estimator parse_estimator(const std::string &str)
+{
+    if (str == "profile")
+    {
+        return Estimator::Profile;
+    }
+    if (str == "nested")
+    {
+        return Estimator::Nested;
+    }
+    if (str == "mlmc")
+    {
+        return Estimator::MLMC;
+    }
+    if (str == "adaptive")
+    {
+        return Estimator::Adaptive;
+    }
+    if (str == "regression")
+    {
+        return Estimator::Regression;
+    }
+    throw Exception("Unknown estimator: " + str);
+}
+
+const char *estimator_name(Estimator estimator) noexcept
+{
+    switch (estimator)
+    {
+    case Estimator::Profile:
+        return "exposure profile";
+    case Estimator::Nested:
+        return "conditional nested Monte Carlo";
+    case Estimator::MLMC:
+        return "multilevel nested Monte Carlo";
+    case Estimator::Adaptive:
+        return "adaptive nested Monte Carlo";
+    case Estimator::Regression:
+        return "regression on the outer state";
+    }
+    return "unknown";
+}
+
+Importance parse_importance(const std::string &str)
+{
+    if (str == "none")
+    {
+        return Importance::None;
+    }
+    if (str == "auto")
+    {
+        return Importance::Auto;
+    }
+    if (str == "cross-entropy")
+    {
+        return Importance::CrossEntropy;
+    }
+    throw Exception("Unknown measure change: " + str);
+}
+
+const char *importance_name(Importance importance) noexcept
+{
+    switch (importance)
+    {
+    case Importance::None:
+        return "none";
+    case Importance::Auto:
+        return "automatic drift shift";
+    case Importance::CrossEntropy:
+        return "cross-entropy drift shift";
+    }
+    return "unknown";
+}
+
+Precision parse_precision(const std::string &str)
+{
+    if (str == "double")
+    {
+        return Precision::Double;
+    }
+    if (str == "float")
+    {
+        return Precision::Float;
+    }
+    if (str == "mixed")
+    {
+        return Precision::Mixed;
+    }
+    throw Exception("Unknown precision: " + str);
+}
+
+const char *precision_name(Precision precision) noexcept
+{
+    switch (precision)
+    {
+    case Precision::Double:
+        return "double";
+    case Precision::Float:
+        return "float";
+    case Precision::Mixed:
+        return "mixed, float paths and double sums";
+    }
+    return "unknown";
+}
+
+Config::Config() : estimator(Estimator::Profile), precision(Precision::Double), mlmc_epsilon(1e-3), adaptive_budget(0), adaptive_threshold(3),
+                   regression_pilot(256), regression_inner(8), regression_degree(2), regression_check(16), qmc_replicates(0),
+                   antithetic(false), control_variates(false), importance(Importance::None), importance_pilot(4096), pfe_levels({0.95, 0.99}),
+                   grid_growth(1), grid_step(0), market_discount(0.03), market_hazard_counterparty(0.01), market_hazard_own(0.01),
+                   market_recovery_counterparty(0.4), market_recovery_own(0.4), market_funding(0.05), market_capital(0.1),
+                   sensitivity_bump(0.01), sensitivity_pathwise(false)
+{
+    external[ExternalPaths::Interest] = Models::Parameters{Models::Kind::CIR, 0.03, 0.0, 0.5, 0.04, 0.1};
+    external[ExternalPaths::FX] = Models::Parameters{Models::Kind::GBM, 1.15, 0.02, 0.0, 0.0, 0.1};
+    external[ExternalPaths::Equity] = Models::Parameters{Models::Kind::GBM, 100, 0.08, 0.0, 0.0, 0.2};
+    internal = Models::Parameters{Models::Kind::GBM, 0.0, 0.05, 0.0, 0.0, 0.2};
+}
+
+void Config::load(const std::string &filename)
+{
+    std::ifstream file(filename);
+    if (!file)
+    {
+        throw Exception("Cannot read configuration file: " + filename);
+    }
+
+    std::string line;
+    for (size_t number = 1; std::getline(file, line); number++)
+    {
+        line = trim(line.substr(0, line.find('#')));
+        if (line.empty())
+        {
+            continue;
+        }
+
+        size_t equal = line.find('=');
+        if (equal == std::string::npos)
+        {
+            throw Exception(filename + ":" + std::to_string(number) + ": expected key = value");
+        }
+        set(trim(line.substr(0, equal)), trim(line.substr(equal + 1)));
+    }
+}
+
+void Config::set(const std::string &key, const std::string &value)
+{
+    if (key == "estimator")
+    {
+        estimator = parse_estimator(value);
+        return;
+    }
+    if (key == "precision")
+    {
+        precision = parse_precision(value);
+        return;
+    }
+    if (key == "importance")
+    {
+        importance = parse_importance(value);
+        return;
+    }
+    if (key == "portfolio")
+    {
+        portfolio.load(value);
+        return;
+    }
+
+    size_t dot = key.find('.');
+    if (dot == std::string::npos)
+    {
+        throw Exception("Unknown configuration key: " + key);
+    }
+
+    std::string factor = key.substr(0, dot);
+    std::string field = key.substr(dot + 1);
+    ExternalPaths external_factor;
+
+    if (key == "mlmc.epsilon")
+    {
+        if (sscanf(value.c_str(), "%lf", &mlmc_epsilon) != 1 || mlmc_epsilon <= 0)
+        {
+            throw Exception("Invalid value for " + key + ": " + value);
+        }
+        return;
+    }
+
+    std::map<std::string, size_t *> counts = {{"adaptive.budget", &adaptive_budget},
+                                              {"regression.pilot", &regression_pilot},
+                                              {"regression.inner", &regression_inner},
+                                              {"regression.degree", &regression_degree},
+                                              {"regression.check", &regression_check},
+                                              {"qmc.replicates", &qmc_replicates},
+                                              {"importance.pilot", &importance_pilot}};
+    if (counts.count(key))
+    {
+        unsigned long long count;
+        if (sscanf(value.c_str(), "%llu", &count) != 1)
+        {
+            throw Exception("Invalid value for " + key + ": " + value);
+        }
+        *counts[key] = size_t(count);
+        return;
+    }
+
+    if (key == "pfe.levels")
+    {
+        pfe_levels = parse_list(key, value, [](double level)
+                                { return level > 0 && level < 1; });
+        return;
+    }
+
+    if (key == "grid.dates")
+    {
+        grid_dates = parse_list(key, value, [](double date)
+                                { return date >= 0; });
+        if (std::adjacent_find(grid_dates.begin(), grid_dates.end()) != grid_dates.end())
+        {
+            throw Exception("Invalid value for " + key + ": " + value);
+        }
+        return;
+    }
+
+    if (key == "sensitivity.parameters")
+    {
+        std::vector<std::string> parameters;
+        size_t begin = 0;
+        while (begin <= value.size())
+        {
+            size_t end = std::min(value.find(',', begin), value.size());
+            std::string parameter_key = trim(value.substr(begin, end - begin));
+            if (parameter_key != "all" && (!parameter(parameter_key) || parameter_key == "internal.x0"))
+            {
+                throw Exception("Invalid value for " + key + ": " + value);
+            }
+            parameters.push_back(parameter_key);
+            begin = end + 1;
+        }
+        sensitivity_parameters = parameters;
+        return;
+    }
+
+    if (key == "sensitivity.bump")
+    {
+        if (sscanf(value.c_str(), "%lf", &sensitivity_bump) != 1 || sensitivity_bump <= 0)
+        {
+            throw Exception("Invalid value for " + key + ": " + value);
+        }
+        return;
+    }
+
+    if (key == "grid.growth")
+    {
+        if (sscanf(value.c_str(), "%lf", &grid_growth) != 1 || grid_growth <= 0)
+        {
+            throw Exception("Invalid value for " + key + ": " + value);
+        }
+        return;
+    }
+
+    if (key == "grid.step")
+    {
+        if (sscanf(value.c_str(), "%lf", &grid_step) != 1 || grid_step < 0)
+        {
+            throw Exception("Invalid value for " + key + ": " + value);
+        }
+        return;
+    }
+
+    std::map<std::string, Curve *> curves = {{"market.discount", &market_discount},
+                                             {"market.hazard.counterparty", &market_hazard_counterparty},
+                                             {"market.hazard.own", &market_hazard_own}};
+    if (curves.count(key))
+    {
+        *curves[key] = Curve::parse(value);
+        return;
+    }
+
+    std::map<std::string, double *> rates = {{"market.recovery.counterparty", &market_recovery_counterparty},
+                                             {"market.recovery.own", &market_recovery_own},
+                                             {"market.funding", &market_funding},
+                                             {"market.capital", &market_capital}};
+    if (rates.count(key))
+    {
+        double rate;
+        if (sscanf(value.c_str(), "%lf", &rate) != 1 || (key.find("recovery") != std::string::npos && !(rate >= 0 && rate <= 1)))
+        {
+            throw Exception("Invalid value for " + key + ": " + value);
+        }
+        *rates[key] = rate;
+        return;
+    }
+
+    std::map<std::string, bool *> flags = {{"variance.antithetic", &antithetic},
+                                           {"variance.control", &control_variates},
+                                           {"sensitivity.pathwise", &sensitivity_pathwise}};
+    if (flags.count(key))
+    {
+        if (value != "0" && value != "1")
+        {
+            throw Exception("Invalid value for " + key + ": " + value);
+        }
+        *flags[key] = value == "1";
+        return;
+    }
+
+    if (key == "adaptive.threshold")
+    {
+        if (sscanf(value.c_str(), "%lf", &adaptive_threshold) != 1 || adaptive_threshold < 0)
+        {
+            throw Exception("Invalid value for " + key + ": " + value);
+        }
+        return;
+    }
+
+    if (factor == "correlation")
+    {
+        ExternalPaths other;
+        size_t second = field.find('.');
+        double rho;
+        if (second == std::string::npos || !parse_factor(field.substr(0, second), external_factor) ||
+            !parse_factor(field.substr(second + 1), other))
+        {
+            throw Exception("Unknown configuration key: " + key);
+        }
+        if (sscanf(value.c_str(), "%lf", &rho) != 1)
+        {
+            throw Exception("Invalid value for " + key + ": " + value);
+        }
+        correlation.set(external_factor, other, rho);
+        return;
+    }
+
+    if (field == "model")
+    {
+        if (parse_factor(factor, external_factor))
+        {
+            external[external_factor].kind = Models::parse(value);
+            return;
+        }
+        if (factor == "internal")
+        {
+            internal.kind = Models::parse(value);
+            return;
+        }
+    }
+
+    double *target = parameter(key);
+    if (!target)
+    {
+        throw Exception("Unknown configuration key: " + key);
+    }
+
+    if (sscanf(value.c_str(), "%lf", target) != 1)
+    {
+        throw Exception("Invalid value for " + key + ": " + value);
+    }
+}
+
+double *Config::parameter(const std::string &key)
+{
+    size_t dot = key.find('.');
+    if (dot == std::string::npos)
+    {
+        return nullptr;
+    }
+
+    std::string factor = key.substr(0, dot);
+    std::string field = key.substr(dot + 1);
+    ExternalPaths external_factor;
+    Models::Parameters *parameters;
+    if (parse_factor(factor, external_factor))
+    {
+        parameters = &external[external_factor];
+    }
+    else if (factor == "internal")
+    {
+        parameters = &internal;
+    }
+    else
+    {
+        return nullptr;
+    }
+
+    if (field == "x0")
+    {
+        return &parameters->x0;
+    }
+    if (field == "mu")
+    {
+        return &parameters->mu;
+    }
+    if (field == "kappa")
+    {
+        return &parameters->kappa;
+    }
+    if (field == "theta")
+    {
+        return &parameters->theta;
+    }
+    if (field == "sigma")
+    {
+        return &parameters->sigma;
+    }
+    return nullptr;
+}
@@ -0,0 +1,86 @@
+/**
+ * @file correlation.cpp
+ * @author Thomas Roiseux (thomas.roiseux@mathquantlab.com)
+ * @brief Implements {@link correlation.h}
+ * @version 1.0
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+
+#include "../headers/correlation.h"
+#include "../headers/pch.h"
+
+#include <cmath>
+
+CorrelationMatrix::CorrelationMatrix() noexcept
+{
+    for (size_t i = 0; i < nb_factors; i++)
+    {
+        for (size_t j = 0; j < nb_factors; j++)
+        {
+            m_rho[i][j] = i == j ? 1.0 : 0.0;
+        }
+    }
+}
+
+void CorrelationMatrix::set(size_t i, size_t j, double rho)
+{
+    if (i >= nb_factors || j >= nb_factors || i == j)
+    {
+        throw Exception("Invalid correlation factors");
+    }
+    if (!(rho >= -1 && rho <= 1))
+    {
+        throw Exception("Correlation out of [-1, 1]: " + std::to_string(rho));
+    }
+    m_rho[i][j] = rho;
+    m_rho[j][i] = rho;
+}
+
+bool CorrelationMatrix::is_identity() const noexcept
+{
+    for (size_t i = 0; i < nb_factors; i++)
+    {
+        for (size_t j = 0; j < i; j++)
+        {
+            if (m_rho[i][j] != 0)
+            {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+Cholesky CorrelationMatrix::cholesky() const
+{
+    Cholesky factor = {};
+
+    for (size_t i = 0; i < nb_factors; i++)
+    {
+        for (size_t j = 0; j <= i; j++)
+        {
+            double sum = m_rho[i][j];
+            for (size_t k = 0; k < j; k++)
+            {
+                sum -= factor.L[i][k] * factor.L[j][k];
+            }
+
+            if (i == j)
+            {
+                if (sum <= 0)
+                {
+                    throw Exception("Correlation matrix is not positive definite");
+                }
+                factor.L[i][i] = std::sqrt(sum);
+            }
+            else
+            {
+                factor.L[i][j] = sum / factor.L[j][j];
+            }
+        }
+    }
+    return factor;
+}
@@ -1,7 +1,7 @@
 /**
  * @file cuda_simulation.cu
  * @author Thomas Roiseux (thomas.roiseux@mathquantlab.com)
- * @brief Implements {@link cuda_simulation.h}
+ * @brief Implements {@link cuda_simulation.h} and the GPU backend of {@link backend.h}
  * @version 1.0
  * @date 2024-04-22
  *
@@ -10,107 +10,88 @@
  */
 
 #include "../headers/cuda_simulation.h"
+#include "../headers/cuda_utils.h"
+#include "../headers/backend.h"
 
-#include <curand_kernel.h>
+#include <cuda_runtime.h>
 
-/**
- * @brief Generate a sample from a Gaussian distribution
- * 
- * @param mean 
- * @param std_dev 
- * @param state 
- * @return double Gaussian sample
- */
-__device__ double generate_gaussian_sample(double mean, double std_dev, curandState *state)
-{
-    return mean + std_dev * curand_normal_double(state);
-}
+#include <iostream>
 
 /**
- * @brief Generate the external path for the interest rate on GPU
+ * @brief Fill the external paths of a risk factor with standard normal samples on GPU
+ * 
+ * Samples come from the same counter-based streams as on the CPU, so both
+ * backends draw the same numbers for a given seed.
  * 
- * @param paths External paths
+ * @param paths External paths, path[i] receiving the sample of step i >= 1
  * @param m0 Number of paths
  * @param N Size of each path
- * @param T Time horizon
+ * @param seed Seed of the random streams
+ * @param factor Risk factor
  */
-__global__ void generate_external_path_interest_rate(double **paths, size_t *m0, size_t *N, double *T)
+__global__ void draw_normals(double **paths, size_t *m0, size_t *N, RNG::Seed seed, uint32_t factor)
 {
-    double r0 = 0.03;
-    double k(0.5);
-    double theta = 0.04;
-    double sigma = 0.1;
-
-    double dt = *T / *N;
-
     int idx = blockIdx.x * blockDim.x + threadIdx.x;
 
-    curandState state;
-    curand_init(1234, idx, 0, &state);
-
     if (idx < *m0)
     {
-        paths[idx][0] = r0;
         for (size_t i = 1; i < *N; i++)
         {
-            double dW = generate_gaussian_sample(0, sqrt(dt), &state);
-            paths[idx][i] = paths[idx][i - 1] + k * (theta - paths[idx][i - 1]) * dt + sigma * dW * sqrt(paths[idx][i - 1]);
+            paths[idx][i] = RNG::normal(seed, factor, idx, 0, i);
         }
     }
 }
 
 /**
- * @brief Generate the external path for the FX rate on GPU
+ * @brief Correlate the samples of the external paths of every factor on GPU
  * 
- * @param paths External paths
+ * @param interest Interest rate samples
+ * @param fx FX rate samples
+ * @param equity Equity samples
  * @param m0 Number of paths
  * @param N Size of each path
- * @param T Time horizon
+ * @param cholesky Cholesky factor of the correlation
  */
-__global__ void generate_external_path_fx(double **paths, size_t *m0, size_t *N, double *T)
+__global__ void correlate(double **interest, double **fx, double **equity, size_t *m0, size_t *N, Cholesky cholesky)
 {
-    double S0 = 1.15;
-    double mu = 0.02;
-    double sigma = 0.1;
-
-    double dt = *T / *N;
-
     int idx = blockIdx.x * blockDim.x + threadIdx.x;
 
-    curandState state;
-    curand_init(1234, idx, 0, &state);
-
     if (idx < *m0)
     {
-        paths[idx][0] = S0;
         for (size_t i = 1; i < *N; i++)
         {
-            double dW = generate_gaussian_sample(0, sqrt(dt), &state);
-            paths[idx][i] = paths[idx][i - 1] * exp((mu - 0.5 * sigma * sigma) * dt + sigma * dW);
+            double z[nb_factors] = {interest[idx][i], fx[idx][i], equity[idx][i]};
+            cholesky.apply(z);
+            interest[idx][i] = z[ExternalPaths::Interest];
+            fx[idx][i] = z[ExternalPaths::FX];
+            equity[idx][i] = z[ExternalPaths::Equity];
         }
     }
 }
 
-__global__ void generate_external_path_equity(double **paths, size_t *m0, size_t *N, double *T)
+/**
+ * @brief Evolve the external paths of a risk factor on GPU
+ * 
+ * One loop for every model, specialised at compile time.
+ * 
+ * @tparam Model Model policy
+ * @param paths External paths, holding their standard normal samples
+ * @param m0 Number of paths
+ * @param N Size of each path
+ * @param x0 Initial value
+ * @param constants Model constants, precomputed on the host
+ */
+template <class Model>
+__global__ void generate_external_path(double **paths, size_t *m0, size_t *N, double x0, typename Model::Constants constants)
 {
-    double S0 = 100;
-    double mu = 0.05;
-    double sigma = 0.2;
-
-    double dt = *T / *N;
-
     int idx = blockIdx.x * blockDim.x + threadIdx.x;
 
-    curandState state;
-    curand_init(1234, idx, 0, &state);
-
     if (idx < *m0)
     {
-        paths[idx][0] = S0;
+        paths[idx][0] = x0;
         for (size_t i = 1; i < *N; i++)
         {
-            double dW = generate_gaussian_sample(0, sqrt(dt), &state);
-            paths[idx][i] = paths[idx][i - 1] * exp((mu - 0.5 * sigma * sigma) * dt + sigma * dW);
+            paths[idx][i] = Model::template step<Models::ScalarMath>(paths[idx][i - 1], paths[idx][i], constants);
         }
     }
 }
@@ -118,14 +99,14 @@ __global__ void generate_external_path_equity(double **paths, size_t *m0, size_t
 void CUDA::Simulation::run_simulation(const std::map<XVA, double>& xva,
                     size_t m0, size_t m1,
                     size_t nb_points, double T,
-                    std::map<ExternalPaths, std::vector<Vector>> &external_paths,
-                    std::map<XVA, Vector> &paths)
+                    std::map<ExternalPaths, PathBlock> &external_paths,
+                    PathBlock &paths,
+                    const Config &config,
+                    RNG::Seed seed)
 {
     double *d_T;
     size_t *d_N, *d_m0, *d_m1;
-    double **d_paths_interest, **d_paths_fx, **d_paths_equity;
-    double **generated_paths = new double*[m0];
-
+    std::map<ExternalPaths, double **> d_paths;
 
     cudaMalloc(&d_m0, sizeof(size_t));
     cudaMalloc(&d_m1, sizeof(size_t));
@@ -137,79 +118,98 @@ void CUDA::Simulation::run_simulation(const std::map<XVA, double>& xva,
     cudaMemcpy(d_T, &T, sizeof(double), cudaMemcpyHostToDevice);
     cudaMemcpy(d_N, &nb_points, sizeof(size_t), cudaMemcpyHostToDevice);
 
-    cudaMalloc(&d_paths_interest, m0 * sizeof(double *));
-
-    for (size_t i = 0; i < m0; i++)
-    {
-        cudaMalloc(&d_paths_interest[i], nb_points * sizeof(double));
-    }
-
-    generate_external_path_interest_rate<<<m0, 1>>>(d_paths_interest, d_m0, d_N, d_T);
-    for (size_t i = 0; i < m0; i++)
+    for (auto const &model : config.external)
     {
-        generated_paths[i] = new double[nb_points];
-        cudaMemcpy(generated_paths[i], d_paths_interest[i], nb_points * sizeof(double), cudaMemcpyDeviceToHost);
-        external_paths[ExternalPaths::Interest].push_back(Vector(nb_points));
-        for (size_t j = 0; j < nb_points; j++)
+        double **&d_factor_paths = d_paths[model.first];
+        cudaMalloc(&d_factor_paths, m0 * sizeof(double *));
+        for (size_t i = 0; i < m0; i++)
         {
-            external_paths[ExternalPaths::Interest][i][j] = generated_paths[i][j];
+            cudaMalloc(&d_factor_paths[i], nb_points * sizeof(double));
         }
+        draw_normals<<<m0, 1>>>(d_factor_paths, d_m0, d_N, seed, model.first);
     }
 
-    cudaMalloc(&d_paths_fx, m0 * sizeof(double *));
-    for (size_t i = 0; i < m0; i++)
+    if (!config.correlation.is_identity())
     {
-        cudaMalloc(&d_paths_fx[i], nb_points * sizeof(double));
+        correlate<<<m0, 1>>>(d_paths[ExternalPaths::Interest], d_paths[ExternalPaths::FX], d_paths[ExternalPaths::Equity], d_m0, d_N, config.correlation.cholesky());
     }
 
-    generate_external_path_fx<<<m0, 1>>>(d_paths_fx, d_m0, d_N, d_T);
-    for (size_t i = 0; i < m0; i++)
+    double dt = T / nb_points;
+    for (auto const &model : config.external)
     {
-        generated_paths[i] = new double[nb_points];
-        cudaMemcpy(generated_paths[i], d_paths_fx[i], nb_points * sizeof(double), cudaMemcpyDeviceToHost);
-        external_paths[ExternalPaths::FX].push_back(Vector(nb_points));
-        for (size_t j = 0; j < nb_points; j++)
+        ExternalPaths factor = model.first;
+        const Models::Parameters &parameters = model.second;
+
+        Models::visit(parameters.kind, [&](auto policy)
+                      {
+            typedef decltype(policy) Model;
+            generate_external_path<Model><<<m0, 1>>>(d_paths[factor], d_m0, d_N, parameters.x0, Model::precompute(parameters, dt)); });
+
+        external_paths[factor].resize(m0, nb_points);
+        for (size_t i = 0; i < m0; i++)
         {
-            external_paths[ExternalPaths::FX][i][j] = generated_paths[i][j];
+            cudaMemcpy(external_paths[factor].path(i).data(), d_paths[factor][i], nb_points * sizeof(double), cudaMemcpyDeviceToHost);
         }
     }
 
-    cudaMalloc(&d_paths_equity, m0 * sizeof(double *));
-    for (size_t i = 0; i < m0; i++)
-    {
-        cudaMalloc(&d_paths_equity[i], nb_points * sizeof(double));
-    }
-
-    generate_external_path_equity<<<m0, 1>>>(d_paths_equity, d_m0, d_N, d_T);
-    for (size_t i = 0; i < m0; i++)
+    for (auto const &factor_paths : d_paths)
     {
-        generated_paths[i] = new double[nb_points];
-        cudaMemcpy(generated_paths[i], d_paths_equity[i], nb_points * sizeof(double), cudaMemcpyDeviceToHost);
-        external_paths[ExternalPaths::Equity].push_back(Vector(nb_points));
-        for (size_t j = 0; j < nb_points; j++)
+        for (size_t i = 0; i < m0; i++)
         {
-            external_paths[ExternalPaths::Equity][i][j] = generated_paths[i][j];
+            cudaFree(factor_paths.second[i]);
         }
+        cudaFree(factor_paths.second);
     }
 
-    for (size_t i = 0; i < m0; i++)
+    cudaFree(d_m0);
+    cudaFree(d_m1);
+    cudaFree(d_T);
+    cudaFree(d_N);
+}
+
+GPUBackend::GPUBackend(const Options &options)
+{
+    if (options.shards > 0)
+    {
+        throw Exception("Sharding runs worker processes on CPU only");
+    }
+    if (options.device >= 0)
     {
-        delete[] generated_paths[i];
+        CUDA::Utils::select_gpu(options.device);
     }
-    delete[] generated_paths;
+}
+
+GPUBackend::~GPUBackend()
+{
+    cudaDeviceReset();
+}
 
-    for (size_t i = 0; i < m0; i++)
+bool GPUBackend::available() noexcept
+{
+    return CUDA::Utils::is_gpu_available();
+}
+
+void GPUBackend::run(const std::map<XVA, double> &xva, size_t m0, size_t m1, const TimeGrid &grid,
+                     PathBlock &paths, PathBlock &, PathBlock &, const Config &config, RNG::Seed seed)
+{
+    std::cout << "Running on GPU" << std::endl;
+    if (!grid.uniform())
+    {
+        throw Exception("The GPU simulation needs the uniform time grid");
+    }
+    if (!config.portfolio.empty())
+    {
+        throw Exception("The GPU simulation values the synthetic portfolio only");
+    }
+    if (config.precision != Precision::Double)
+    {
+        throw Exception("The GPU simulation runs in double precision");
+    }
+    if (!config.sensitivity_parameters.empty())
     {
-        cudaFree(d_paths_interest[i]);
-        cudaFree(d_paths_fx[i]);
-        cudaFree(d_paths_equity[i]);
+        throw Exception("Sensitivities are computed on CPU only");
     }
 
-    cudaFree(d_paths_interest);
-    cudaFree(d_paths_fx);
-    cudaFree(d_paths_equity);
-    cudaFree(d_m0);
-    cudaFree(d_m1);
-    cudaFree(d_T);
-    cudaFree(d_N);
+    std::map<ExternalPaths, PathBlock> external_paths;
+    CUDA::Simulation::run_simulation(xva, m0, m1, grid.nb_points(), grid.horizon(), external_paths, paths, config, seed);
 }
@@ -0,0 +1,68 @@
+/**
+ * @file curve.cpp
+ * @author Thomas Roiseux (thomas.roiseux@mathquantlab.com)
+ * @brief Implements {@link curve.h}
+ * @version 1.0
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+
+#include "../headers/curve.h"
+
+#include <cmath>
+#include <cstdio>
+#include <algorithm>
+
+Curve Curve::parse(const std::string &str)
+{
+    Curve curve;
+    double rate;
+    if (str.find(':') == std::string::npos)
+    {
+        if (sscanf(str.c_str(), "%lf", &rate) != 1)
+        {
+            throw Exception("Invalid curve: " + str);
+        }
+        curve.m_rates[0] = rate;
+        return curve;
+    }
+
+    curve.m_ends.clear();
+    curve.m_rates.clear();
+    size_t begin = 0;
+    while (begin <= str.size())
+    {
+        size_t end = std::min(str.find(',', begin), str.size());
+        double time;
+        if (sscanf(str.substr(begin, end - begin).c_str(), " %lf : %lf", &time, &rate) != 2 ||
+            time <= (curve.m_ends.empty() ? 0.0 : curve.m_ends.back()))
+        {
+            throw Exception("Invalid curve: " + str);
+        }
+        curve.m_ends.push_back(time);
+        curve.m_rates.push_back(rate);
+        begin = end + 1;
+    }
+    return curve;
+}
+
+double Curve::integral(double t) const
+{
+    // Whole pillars before t, then the part of the pillar holding t, the
+    // last one extending beyond the curve
+    double sum = 0, start = 0;
+    size_t k = 0;
+    for (; k + 1 < m_rates.size() && m_ends[k] < t; k++)
+    {
+        sum += m_rates[k] * (m_ends[k] - start);
+        start = m_ends[k];
+    }
+    return sum + m_rates[k] * (t - start);
+}
+
+double Curve::factor(double t) const
+{
+    return std::exp(-integral(t));
+}
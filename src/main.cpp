@@ -10,12 +10,11 @@
  */
 
 #include <iostream>
-#include <thread>
+#include <cmath>
 
-#include "../headers/cuda_utils.h"
 #include "../headers/utils.h"
-#include "../headers/simulation.h"
-#include "../headers/cuda_simulation.h"
+#include "../headers/backend.h"
+#include "../headers/sensitivities.h"
 
 using namespace std;
 
@@ -37,11 +36,13 @@ int main(int argc, char *argv[])
 
     try
     {
-        bool gpu = CUDA::Utils::is_gpu_available();
         size_t m0(0), m1(0), N(0);
+        Backend::Options options;
+        RNG::Seed seed(RNG::default_seed);
+        Config config;
         double T(0);
 
-        int first_mandatory_argument = Utils::parse_options(argc, argv, gpu);
+        int first_mandatory_argument = Utils::parse_options(argc, argv, options, seed, config);
 
         if (argc < 6)
         {
@@ -65,6 +66,46 @@ int main(int argc, char *argv[])
         cout << "Points number: " << N << endl;
         cout << "Horizon: " << T << endl;
 
+        TimeGrid grid(config, N, T);
+        if (!grid.uniform())
+        {
+            cout << "Time grid: " << grid.nb_dates() << " exposure dates, " << grid.nb_points() - 1 << " simulation steps" << endl;
+        }
+        cout << "Seed: " << seed << endl;
+        for (auto const &model : config.external)
+        {
+            cout << "Model of " << Utils::pretty_print_factor_name(model.first) << ": " << Models::name(model.second.kind) << endl;
+        }
+
+        cout << "Estimator: " << estimator_name(config.estimator) << endl;
+        if (config.precision != Precision::Double)
+        {
+            cout << "Precision: " << precision_name(config.precision) << endl;
+        }
+        if (!config.portfolio.empty())
+        {
+            cout << "Portfolio: " << config.portfolio.nb_trades() << " trades in " << config.portfolio.nb_netting_sets() << " netting sets, "
+                 << config.portfolio.nb_collateral_sets() << " collateral sets" << endl;
+        }
+        if (config.qmc_replicates > 0)
+        {
+            cout << "External paths: scrambled Sobol with " << config.qmc_replicates << " replicates" << endl;
+        }
+        if (config.importance != Importance::None)
+        {
+            cout << "Importance sampling: " << importance_name(config.importance) << ", PFE level " << config.pfe_levels.back() << endl;
+        }
+        if (config.antithetic || config.control_variates)
+        {
+            cout << "Variance reduction: " << (config.antithetic ? "antithetic paths" : "")
+                 << (config.antithetic && config.control_variates ? ", " : "") << (config.control_variates ? "control variates" : "") << endl;
+        }
+        if (!config.sensitivity_parameters.empty())
+        {
+            size_t nb_parameters = Sensitivities::parameters(config).size();
+            cout << "Sensitivities: " << nb_parameters << " parameters" << endl;
+        }
+
         std::map<XVA, double> xvas;
         Utils::parse_type(argv[argc - 1], xvas);
 
@@ -78,34 +119,38 @@ int main(int argc, char *argv[])
 
         cout << xvas.size() << " XVA requested" << endl;
 
-        std::map<ExternalPaths, std::vector<Vector>> external_paths;
-        std::map<XVA, Vector> results;
+        PathBlock results, errors, pfe;
 
-        if (!gpu)
-        {
-            cout << "Running on CPU with maximum " << std::thread::hardware_concurrency() << " threads simultaneously." << endl;
-            CPUSimulation::run_simulation(xvas, m0, m1, N, T, external_paths, results);
-        }
-        else
+        std::unique_ptr<Backend> backend = Backend::create(options);
+        backend->run(xvas, m0, m1, grid, results, errors, pfe, config, seed);
+
+        if (!config.sensitivity_parameters.empty())
         {
-            cout << "Running on GPU" << endl;
-            atexit([]() -> void
-                   { cudaDeviceReset(); });
-            CUDA::Simulation::run_simulation(xvas, m0, m1, N, T, external_paths, results);
+            cout << "Computing sensitivities with common random numbers" << endl;
+            std::vector<Sensitivity> sensitivities = backend->sensitivities(xvas, m0, m1, grid, results, config, seed);
+            for (const Sensitivity &sensitivity : sensitivities)
+            {
+                cout << "d" << Utils::pretty_print_xva_name(sensitivity.xva) << "/d" << sensitivity.parameter << ": " << sensitivity.finite_difference;
+                if (!std::isnan(sensitivity.pathwise))
+                {
+                    cout << " (pathwise " << sensitivity.pathwise << ")";
+                }
+                cout << endl;
+            }
+            Utils::print_sensitivities(sensitivities, "Data/sensitivities.csv");
         }
 
         cout << "Simulation done" << endl;
         cout << "Writing results to file" << endl;
 
-        Utils::print_results(results, "Data/results.csv", T);
+        Utils::print_results(xvas, results, errors, pfe, config.pfe_levels, "Data/results.csv", grid.dates());
 
         cout << "Results written to file" << endl;
     }
-    catch (const CUDA::CUDAException &e)
+    catch (const Exception &e)
     {
-        std::cerr << "Error with CUDA" << endl;
-        std::cerr << e.what() << " (" << e.get_error() << ")" << endl;
-        return e.get_error();
+        std::cerr << e.what() << endl;
+        return e.code();
     }
     catch (const std::exception &e)
     {
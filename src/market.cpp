@@ -0,0 +1,43 @@
+/**
+ * @file market.cpp
+ * @author Thomas Roiseux (thomas.roiseux@mathquantlab.com)
+ * @brief Implements {@link market.h}
+ * @version 1.0
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+
+#include "../headers/market.h"
+
+MarketCurves::MarketCurves(const Config &config, const TimeGrid &grid) : m_tables(nb_rows, grid.nb_dates())
+{
+    const Curve *hazards[2] = {&config.market_hazard_counterparty, &config.market_hazard_own};
+    const double loss[2] = {1 - config.market_recovery_counterparty, 1 - config.market_recovery_own};
+
+    double previous = 0;
+    double previous_survival[2] = {1, 1};
+    for (size_t d = 0; d < grid.nb_dates(); d++)
+    {
+        double t = grid.date(d);
+        double discount = config.market_discount.factor(t);
+        m_tables(discount_row, d) = discount;
+        for (size_t p = 0; p < 2; p++)
+        {
+            double survival = hazards[p]->factor(t);
+            m_tables(survival_row + p, d) = survival;
+            m_tables(default_row + p, d) = previous_survival[p] - survival;
+            previous_survival[p] = survival;
+        }
+
+        double both = m_tables(survival_row + Counterparty, d) * m_tables(survival_row + Own, d);
+        double interval = t - previous;
+        m_tables(weight_row + CVA, d) = loss[Counterparty] * discount * m_tables(survival_row + Own, d) * m_tables(default_row + Counterparty, d);
+        m_tables(weight_row + DVA, d) = loss[Own] * discount * m_tables(survival_row + Counterparty, d) * m_tables(default_row + Own, d);
+        m_tables(weight_row + FVA, d) = config.market_funding * discount * both * interval;
+        m_tables(weight_row + MVA, d) = config.market_funding * discount * both * interval;
+        m_tables(weight_row + KVA, d) = config.market_capital * discount * both * interval;
+        previous = t;
+    }
+}
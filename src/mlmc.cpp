@@ -0,0 +1,294 @@
+/**
+ * @file mlmc.cpp
+ * @author Thomas Roiseux (thomas.roiseux@mathquantlab.com)
+ * @brief Implements {@link mlmc.h}
+ * @version 1.0
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+
+#include "../headers/mlmc.h"
+#include "../headers/simd.h"
+
+#include <iostream>
+#include <thread>
+#include <chrono>
+#include <cmath>
+#include <algorithm>
+#include <limits>
+
+/**
+ * @brief Number of sample groups whose partial results are kept at once
+ *
+ */
+static constexpr size_t sample_wave = 64;
+
+/**
+ * @brief Bits of the outer path index holding the sample index of a level
+ *
+ */
+static constexpr size_t level_shift = 24;
+
+void MLMC::run(XVA xva, double factor, const std::map<ExternalPaths, PathBlock> &external_paths, PathView<double> final_path) const
+{
+    std::cout << "Running MLMC for XVA " << Utils::pretty_print_xva_name(xva) << " on thread " << std::this_thread::get_id() << " with factor " << factor << std::endl;
+
+    PathBlock paths, errors, pfe;
+    run({{xva, factor}}, external_paths, paths, errors, pfe);
+    for (size_t i = 0; i < nb_dates; i++)
+    {
+        final_path[i] = paths(0, i);
+    }
+}
+
+void MLMC::run(const std::map<XVA, double> &xvas, const std::map<ExternalPaths, PathBlock> &, PathBlock &final_paths, PathBlock &errors, PathBlock &) const
+{
+    std::vector<std::pair<XVA, double>> requested(xvas.begin(), xvas.end());
+    double epsilon = config.mlmc_epsilon;
+
+    size_t nb_levels = 1;
+    while ((size_t(2) << (nb_levels - 1)) <= size_t(m1))
+    {
+        nb_levels++;
+    }
+    if (nb_levels > (size_t(1) << (32 - level_shift)))
+    {
+        throw Exception("Too many MLMC levels");
+    }
+
+    std::cout << "Running MLMC for " << xvas.size() << " XVA on " << nb_levels << " levels with target error " << epsilon << " on thread " << std::this_thread::get_id() << std::endl;
+
+    // Steps of the outer path and of one inner path branched from every date
+    double outer_steps = double(nb_factors) * (nb_points - 1);
+    double inner_steps = 0;
+    for (size_t d = 0; d < nb_dates; d++)
+    {
+        inner_steps += double(nb_factors) * (nb_points - 1 - grid.point(d));
+    }
+
+    std::vector<Level> levels(nb_levels);
+    std::vector<size_t> targets(nb_levels, std::max<size_t>(size_t(m0), 2));
+    for (size_t l = 0; l < nb_levels; l++)
+    {
+        levels[l].nb_inner = size_t(1) << l;
+        levels[l].differences.assign(requested.size(), PathAccumulator(nb_dates));
+        levels[l].variance = 0;
+        levels[l].cost = outer_steps + inner_steps * levels[l].nb_inner;
+        levels[l].seconds = 0;
+    }
+
+    for (;;)
+    {
+        for (size_t l = 0; l < nb_levels; l++)
+        {
+            size_t done = levels[l].differences[0].count();
+            if (targets[l] > done)
+            {
+                // Sample indices of a level past 2^level_shift would reach the streams of the next level
+                if (targets[l] > (size_t(1) << level_shift))
+                {
+                    throw Exception("Too many MLMC samples, increase mlmc.epsilon");
+                }
+                auto start = std::chrono::steady_clock::now();
+                sample(requested, l, levels[l], done, targets[l] - done);
+                levels[l].seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            }
+
+            levels[l].variance = 0;
+            for (auto const &differences : levels[l].differences)
+            {
+                for (size_t j = 0; j < nb_dates; j++)
+                {
+                    levels[l].variance = std::max(levels[l].variance, differences.variance(j));
+                }
+            }
+        }
+
+        double sum = 0;
+        for (auto const &level : levels)
+        {
+            sum += std::sqrt(level.variance * level.cost);
+        }
+
+        bool converged = true;
+        for (size_t l = 0; l < nb_levels; l++)
+        {
+            size_t optimal = size_t(std::ceil(2 / (epsilon * epsilon) * std::sqrt(levels[l].variance / levels[l].cost) * sum));
+            if (optimal > levels[l].differences[0].count())
+            {
+                targets[l] = optimal;
+                converged = false;
+            }
+        }
+        if (converged)
+        {
+            break;
+        }
+    }
+
+    final_paths.resize(requested.size(), nb_dates);
+    errors.resize(requested.size(), nb_dates);
+    for (size_t k = 0; k < requested.size(); k++)
+    {
+        for (size_t j = 0; j < nb_dates; j++)
+        {
+            double mean = 0, variance = 0;
+            for (auto const &level : levels)
+            {
+                const PathAccumulator &differences = level.differences[k];
+                mean += differences.mean()[j];
+                variance += differences.variance(j) / differences.count();
+            }
+            final_paths(k, j) = mean;
+            errors(k, j) = std::sqrt(variance);
+        }
+    }
+
+    double total_cost = 0;
+    std::cout << "MLMC level, inner paths, samples, variance, cost per sample (steps), time (s)" << std::endl;
+    for (size_t l = 0; l < nb_levels; l++)
+    {
+        const Level &level = levels[l];
+        size_t count = level.differences[0].count();
+        total_cost += count * level.cost;
+        std::cout << l << ", " << level.nb_inner << ", " << count << ", " << level.variance << ", " << level.cost << ", " << level.seconds << std::endl;
+    }
+
+    // A correction whose variance is rounding noise of the level 0 comes
+    // from a payoff linear in the inner mean: the levels then bring nothing
+    // to compare against plain nested Monte Carlo
+    std::vector<size_t> degenerate;
+    for (size_t l = 1; l < nb_levels; l++)
+    {
+        if (levels[l].variance <= levels[0].variance * std::numeric_limits<double>::epsilon())
+        {
+            degenerate.push_back(l);
+        }
+    }
+    if (levels[0].variance == 0 || !degenerate.empty())
+    {
+        std::cout << "MLMC cost: " << total_cost << " steps, no cost comparison: ";
+        if (levels[0].variance == 0)
+        {
+            std::cout << "the level 0 has no variance";
+        }
+        else
+        {
+            std::cout << "levels";
+            for (size_t l : degenerate)
+            {
+                std::cout << " " << l;
+            }
+            std::cout << " have no variance beyond rounding, the payoff being linear in their inner paths";
+        }
+        std::cout << std::endl;
+    }
+    else
+    {
+        // Plain nested Monte Carlo at the finest level needs 2 V / epsilon^2
+        // samples, V being close to the variance of the level 0
+        double nested_cost = 2 / (epsilon * epsilon) * levels[0].variance * levels.back().cost;
+        std::cout << "MLMC cost: " << total_cost << " steps, nested Monte Carlo at the same accuracy: " << nested_cost
+                  << " steps (" << nested_cost / total_cost << "x)" << std::endl;
+    }
+
+    // Antithetic nested levels converge at first order, so the bias of the
+    // finest level is about the magnitude of its mean difference
+    double bias = 0;
+    for (auto const &differences : levels.back().differences)
+    {
+        for (size_t j = 0; j < nb_dates; j++)
+        {
+            bias = std::max(bias, std::abs(differences.mean()[j]));
+        }
+    }
+    if (nb_levels > 1 && bias > epsilon / std::sqrt(2.0))
+    {
+        std::cout << "Warning: MLMC bias estimate " << bias << " above the target error, increase m1" << std::endl;
+    }
+}
+
+void MLMC::sample(const std::vector<std::pair<XVA, double>> &xvas, size_t index, Level &level, size_t first, size_t count) const
+{
+    size_t nb_groups = (count + SIMD::group - 1) / SIMD::group;
+    size_t nb_inner = level.nb_inner;
+    size_t half = nb_inner / 2;
+    std::vector<std::vector<PathAccumulator>> partials(std::min(sample_wave, nb_groups));
+
+    // Groups are merged in order, wave after wave, so results do not depend on the threads
+    for (size_t wave = 0; wave < nb_groups; wave += sample_wave)
+    {
+        size_t last = std::min(nb_groups, wave + sample_wave);
+
+        pool->parallel_for(wave, last, 1, [&](size_t begin, size_t end)
+                           {
+            std::map<ExternalPaths, PathBlock> outer_paths, inner_paths;
+            for (auto const &model : config.external)
+            {
+                outer_paths[model.first].resize(SIMD::group, nb_points);
+                inner_paths[model.first].resize(SIMD::group, nb_points);
+            }
+            std::vector<std::vector<Vector>> differences(SIMD::group, std::vector<Vector>(xvas.size(), Vector(nb_dates)));
+            Vector sums_a(SIMD::group), sums_b(SIMD::group);
+
+            for (size_t g = begin; g < end; g++)
+            {
+                std::vector<PathAccumulator> &partial = partials[g - wave];
+                partial.assign(xvas.size(), PathAccumulator(nb_dates));
+
+                size_t sample_first = first + g * SIMD::group;
+                size_t sample_count = std::min(SIMD::group, first + count - sample_first);
+                size_t outer_first = (index << level_shift) + sample_first;
+                generate_external_paths(outer_first, sample_count, outer_paths, 0);
+
+                for (size_t j = 0; j < nb_dates; j++)
+                {
+                    // One inner path of every sample of the group per lane sweep
+                    std::fill(sums_a.begin(), sums_a.end(), 0.0);
+                    std::fill(sums_b.begin(), sums_b.end(), 0.0);
+                    for (size_t i = 0; i < nb_inner; i++)
+                    {
+                        branch(outer_paths, 0, outer_first, sample_count, grid.point(j), i, inner_paths, i < half ? sums_a.data() : sums_b.data());
+                    }
+
+                    for (size_t r = 0; r < sample_count; r++)
+                    {
+                        double coarse_a = half > 0 ? sums_a[r] / half : 0;
+                        double coarse_b = half > 0 ? sums_b[r] / half : 0;
+                        double fine = (sums_a[r] + sums_b[r]) / nb_inner;
+
+                        for (size_t k = 0; k < xvas.size(); k++)
+                        {
+                            XVA xva = xvas[k].first;
+                            double factor = xvas[k].second;
+                            double weight = market.weight(xva, j);
+                            double difference = xva_value(xva, factor, fine, weight);
+                            if (half > 0)
+                            {
+                                difference -= 0.5 * (xva_value(xva, factor, coarse_a, weight) + xva_value(xva, factor, coarse_b, weight));
+                            }
+                            differences[r][k][j] = difference;
+                        }
+                    }
+                }
+
+                for (size_t r = 0; r < sample_count; r++)
+                {
+                    for (size_t k = 0; k < xvas.size(); k++)
+                    {
+                        partial[k].add(PathView<const double>(differences[r][k].data(), nb_dates));
+                    }
+                }
+            } });
+
+        for (size_t g = wave; g < last; g++)
+        {
+            for (size_t k = 0; k < xvas.size(); k++)
+            {
+                level.differences[k].merge(partials[g - wave][k]);
+            }
+        }
+    }
+}
@@ -0,0 +1,149 @@
+/**
+ * @file models.cpp
+ * @author Thomas Roiseux (thomas.roiseux@mathquantlab.com)
+ * @brief Implements {@link models.h}
+ * @version 1.0
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+
+#include "../headers/models.h"
+#include "../headers/pch.h"
+
+#include <cmath>
+#include <algorithm>
+
+Models::Kind Models::parse(const std::string &str)
+{
+    if (str == "gbm")
+    {
+        return Kind::GBM;
+    }
+    if (str == "cir")
+    {
+        return Kind::CIR;
+    }
+    if (str == "vasicek")
+    {
+        return Kind::Vasicek;
+    }
+    if (str == "hull-white")
+    {
+        return Kind::HullWhite;
+    }
+    throw Exception("Unknown model: " + str);
+}
+
+const char *Models::name(Kind kind) noexcept
+{
+    switch (kind)
+    {
+    case Kind::GBM:
+        return "gbm";
+    case Kind::CIR:
+        return "cir";
+    case Kind::Vasicek:
+        return "vasicek";
+    case Kind::HullWhite:
+        return "hull-white";
+    default:
+        return "unknown";
+    }
+}
+
+bool Models::exact(Kind kind) noexcept
+{
+    return kind != Kind::CIR;
+}
+
+bool Models::expectation(const Parameters &p, double x0, double t, double &mean) noexcept
+{
+    switch (p.kind)
+    {
+    case Kind::GBM:
+        mean = x0 * std::exp(p.mu * t);
+        return true;
+    case Kind::Vasicek:
+        mean = p.kappa == 0 ? x0 : p.theta + (x0 - p.theta) * std::exp(-p.kappa * t);
+        return true;
+    case Kind::HullWhite:
+        mean = p.kappa == 0 ? x0 + p.theta * t : p.theta / p.kappa + (x0 - p.theta / p.kappa) * std::exp(-p.kappa * t);
+        return true;
+    default:
+        return false;
+    }
+}
+
+bool Models::tangent(const Parameters &p, Field field, const double *times, const double *path, size_t nb_points, double *tangent) noexcept
+{
+    if (p.kind == Kind::GBM)
+    {
+        // x(t) = x0 exp((mu - sigma^2 / 2) t + sigma W(t))
+        for (size_t j = 0; j < nb_points; j++)
+        {
+            double x = path[j];
+            double t = times[j] - times[0];
+            switch (field)
+            {
+            case Field::X0:
+                tangent[j] = p.x0 != 0 ? x / p.x0 : 0.0;
+                break;
+            case Field::Mu:
+                tangent[j] = x * t;
+                break;
+            case Field::Sigma:
+                tangent[j] = p.sigma != 0 && x > 0 && p.x0 > 0 ? x * (std::log(x / p.x0) - (p.mu + 0.5 * p.sigma * p.sigma) * t) / p.sigma : 0.0;
+                break;
+            default:
+                tangent[j] = 0.0;
+                break;
+            }
+        }
+        return true;
+    }
+
+    if (p.kind == Kind::CIR)
+    {
+        // x' = max(x + kappa dt (theta - x) + sigma sqrt(dt) sqrt(x) z, 0)
+        tangent[0] = field == Field::X0 ? 1.0 : 0.0;
+        for (size_t j = 1; j < nb_points; j++)
+        {
+            double x = path[j - 1];
+            double dx = tangent[j - 1];
+            double dt = times[j] - times[j - 1];
+            double vol = p.sigma * std::sqrt(dt);
+            if (path[j] <= 0)
+            {
+                tangent[j] = 0.0;
+                continue;
+            }
+
+            double root = std::sqrt(std::max(x, 0.0));
+            double diffusion = path[j] - x - p.kappa * dt * (p.theta - x);
+            double next = dx * (1 - p.kappa * dt);
+            if (field == Field::Kappa)
+            {
+                next += dt * (p.theta - x);
+            }
+            else if (field == Field::Theta)
+            {
+                next += p.kappa * dt;
+            }
+            if (root > 0 && vol > 0)
+            {
+                // diffusion = vol root z
+                next += diffusion * dx / (2 * x);
+                if (field == Field::Sigma)
+                {
+                    next += diffusion / p.sigma;
+                }
+            }
+            tangent[j] = next;
+        }
+        return true;
+    }
+
+    return false;
+}
@@ -10,311 +10,1628 @@
  */
 
 #include "../headers/nmc.h"
+#include "../headers/simd.h"
+#include "../headers/qmc.h"
 
 #include <iostream>
 #include <thread>
-#include <random>
 #include <cmath>
+#include <algorithm>
+#include <limits>
+#include <functional>
+#include <type_traits>
 
 /**
- * @brief Compute the maximum of two vectors element-wise
+ * @brief Number of points reduced by a single task
  *
- * @tparam T Element type
- * @param a First vector
- * @param b Second vector
- * @param c Output vector
  */
-template <typename T>
-void maximum(const std::vector<T> &a, const std::vector<T> &b, std::vector<T> &c)
+static constexpr size_t time_tile = 256;
+
+/**
+ * @brief Number of internal paths reduced by a single task, independent of
+ * the threads so the partial sums always split the same way
+ *
+ */
+static constexpr size_t reduce_chunk = 1024;
+
+/**
+ * @brief Number of paths whose portfolio is valued by a single task
+ *
+ */
+static constexpr size_t valuation_chunk = 256;
+
+/**
+ * @brief Number of internal paths folded by a single task in streaming mode
+ *
+ */
+static constexpr size_t stream_chunk = 1024;
+
+/**
+ * @brief Number of streaming tasks whose partial results are kept at once
+ *
+ */
+static constexpr size_t stream_wave = 64;
+
+/**
+ * @brief Number of partial quantile sketches kept at once
+ *
+ */
+static constexpr size_t sketch_wave = 16;
+
+/**
+ * @brief First stream factor of the cross-entropy pilot paths, above the
+ * factors of the nested inner paths
+ *
+ */
+static constexpr uint32_t pilot_stream = 0x80000000u;
+
+/**
+ * @brief Maximum number of cross-entropy iterations
+ *
+ */
+static constexpr size_t max_iterations = 10;
+
+/**
+ * @brief Bump of a normal sample in the sensitivities of the automatic drift
+ *
+ */
+static constexpr double bump = 1e-4;
+
+/**
+ * @brief Weighted quantile, reading the tail of the distribution from the
+ * top: the smallest value whose weighted upper tail reaches 1 - level
+ *
+ * @param samples Values and their likelihood ratios, sorted in place
+ * @param level Quantile level
+ * @return double Quantile
+ */
+static double weighted_quantile(std::vector<std::pair<double, double>> &samples, double level)
 {
-    if (a.size() != b.size())
+    std::sort(samples.begin(), samples.end(), std::greater<std::pair<double, double>>());
+    double tail = 0;
+    for (auto const &sample : samples)
     {
-        throw std::invalid_argument("Vectors a and b must have the same size");
+        tail += sample.second / samples.size();
+        if (tail >= 1 - level)
+        {
+            return sample.first;
+        }
     }
-    c.resize(a.size());
-    for (size_t i = 0; i < a.size(); i++)
+    return samples.empty() ? 0.0 : samples.back().first;
+}
+
+double NMC::xva_value(XVA xva, double factor, double value, double weight)
+{
+    double EPE = std::max(value, factor) - factor;
+    double DPE = factor - std::max(value, factor);
+
+    switch (xva)
     {
-        c[i] = std::max(a[i], b[i]);
+    case CVA:
+    case MVA:
+    case KVA:
+        return EPE * weight;
+    case DVA:
+        return DPE * weight;
+    case FVA:
+        return std::max(EPE - DPE, 0.0) * weight;
+    default:
+        return 0.0;
     }
 }
 
-/**
- * @brief Compute the maximum of two vectors element-wise
- *
- * @tparam T Element type
- * @param a First vector
- * @param b Second vector
- * @param c Output vector
- */
-template <typename T>
-void maximum(const std::vector<T> &a, const T &b, std::vector<T> &c)
+double NMC::payoff(XVA xva, double factor, const double *values, double weight) const
 {
-    c.resize(a.size());
-    for (size_t i = 0; i < a.size(); i++)
+    double value = xva_value(xva, factor, values[0], weight);
+    for (size_t s = 1; s < nb_sets; s++)
     {
-        c[i] = std::max(a[i], b);
+        value += xva_value(xva, factor, values[s * nb_dates], weight);
     }
+    return value;
 }
 
-/**
- * @brief Compute the minimum of two vectors element-wise
- *
- * @tparam T Element type
- * @param a First vector
- * @param b Second vector
- * @param c Output vector
- */
-template <typename T>
-void minimum(const std::vector<T> &a, const std::vector<T> &b, std::vector<T> &c)
+double NMC::exposure(const double *values) const
 {
-    if (a.size() != b.size())
+    if (config.portfolio.empty())
     {
-        throw std::invalid_argument("Vectors a and b must have the same size");
+        return values[0];
     }
-    c.resize(a.size());
-    for (size_t i = 0; i < a.size(); i++)
+    double value = 0;
+    for (size_t s = 0; s < nb_sets; s++)
     {
-        c[i] = std::min(a[i], b[i]);
+        value += std::max(values[s * nb_dates], 0.0);
     }
+    return value;
 }
 
-/**
- * @brief Compute the minimum of two vectors element-wise
- *
- * @tparam T Element type
- * @param a First vector
- * @param b Second vector
- * @param c Output vector
- */
-template <typename T>
-void minimum(const std::vector<T> &a, const T &b, std::vector<T> &c)
+double NMC::xva_slope(XVA xva, double factor, double value, double weight)
 {
-    c.resize(a.size());
-    for (size_t i = 0; i < a.size(); i++)
+    if (!(value > factor))
+    {
+        return 0.0;
+    }
+
+    switch (xva)
     {
-        c[i] = std::min(a[i], b);
+    case CVA:
+    case MVA:
+    case KVA:
+        return weight;
+    case DVA:
+        return -weight;
+    case FVA:
+        return 2 * weight;
+    default:
+        return 0.0;
     }
 }
 
-void NMC::run(XVA xva, double factor, const std::map<ExternalPaths, std::vector<Vector>> &external_paths, Vector &final_path) const
+void NMC::run(XVA xva, double factor, const std::map<ExternalPaths, PathBlock> &external_paths, PathView<double> final_path) const
 {
     std::cout << "Running NMC for XVA " << Utils::pretty_print_xva_name(xva) << " on thread " << std::this_thread::get_id() << " with factor " << factor << std::endl;
 
-    std::map<ExternalPaths, Matrix> internal_paths;
-    std::map<ExternalPaths, Vector> mean_internal_paths;
-    Vector path(nb_points);
+    if (config.estimator == Estimator::Nested)
+    {
+        PathBlock paths, errors, pfe;
+        run_nested({{xva, factor}}, external_paths, paths, errors, pfe);
+        for (size_t i = 0; i < nb_dates; i++)
+        {
+            final_path[i] = paths(0, i);
+        }
+        return;
+    }
 
-#ifdef DEBUG
-    std::cout << "Internal paths and mean internal paths initialized" << std::endl;
-#endif
+    Vector path, standard_error;
+    PathBlock pfe;
+    compute_exposure(external_paths, path, standard_error, pfe);
 
-    for (auto &external_path : external_paths)
+    for (size_t i = 0; i < nb_dates; i++)
     {
-        generate_internal_paths(external_paths.at(external_path.first),
-                                internal_paths[external_path.first]);
+        final_path[i] = payoff(xva, factor, &path[i], market.weight(xva, i));
     }
+}
 
-#ifdef DEBUG
-    std::cout << "Internal paths generated" << std::endl;
-#endif
+void NMC::run(const std::map<XVA, double> &xvas, const std::map<ExternalPaths, PathBlock> &external_paths, PathBlock &final_paths, PathBlock &errors, PathBlock &pfe) const
+{
+    std::cout << "Running NMC for " << xvas.size() << " XVA in a single pass on thread " << std::this_thread::get_id() << std::endl;
+
+    if (config.estimator == Estimator::Nested)
+    {
+        run_nested(xvas, external_paths, final_paths, errors, pfe);
+        return;
+    }
+
+    Vector path, standard_error;
+    compute_exposure(external_paths, path, standard_error, pfe);
+
+    std::vector<std::pair<XVA, double>> requested(xvas.begin(), xvas.end());
+    final_paths.resize(requested.size(), nb_dates);
+    errors.resize(standard_error.empty() ? 0 : requested.size(), nb_dates);
+
+    for (size_t i = 0; i < nb_dates; i++)
+    {
+        for (size_t k = 0; k < requested.size(); k++)
+        {
+            XVA xva = requested[k].first;
+            double factor = requested[k].second;
+            double weight = market.weight(xva, i);
+            final_paths(k, i) = payoff(xva, factor, &path[i], weight);
+
+            // Delta method, with a central difference across the payoff kink,
+            // the errors of the exposure sets added up
+            if (!standard_error.empty())
+            {
+                double error = 0;
+                for (size_t e = i; e < nb_sets * nb_dates; e += nb_dates)
+                {
+                    error += 0.5 * std::abs(xva_value(xva, factor, path[e] + standard_error[e], weight) -
+                                            xva_value(xva, factor, path[e] - standard_error[e], weight));
+                }
+                errors(k, i) = error;
+            }
+        }
+    }
+}
+
+bool NMC::pathwise(const std::map<XVA, double> &xvas, const std::map<ExternalPaths, PathBlock> &external_paths, const std::vector<std::pair<size_t, Models::Field>> &parameters, PathBlock &greeks) const
+{
+    if (config.estimator != Estimator::Profile || streaming || config.control_variates || !config.portfolio.empty() ||
+        config.precision != Precision::Double)
+    {
+        return false;
+    }
+
+    std::map<ExternalPaths, PathBlock> internal_paths;
+    generate_internal_paths(external_paths, internal_paths);
+
+    Vector times(nb_points);
+    for (size_t j = 0; j < nb_points; j++)
+    {
+        times[j] = grid.time(j);
+    }
 
+    // Exposure profile, as in compute_exposure
+    Vector path(nb_dates, 0.0);
     for (auto const &internal_path : internal_paths)
     {
-        mean_internal_paths[internal_path.first] = Vector(nb_points);
-        for (size_t j = 0; j < nb_points; j++)
+        const PathBlock &block = internal_path.second;
+        for (size_t d = 0; d < nb_dates; d++)
         {
             double sum = 0;
-            for (size_t i = 0; i < m1; i++)
+            for (size_t i = 0; i < block.nb_paths(); i++)
             {
-                sum += internal_path.second[i][j];
+                sum += block(i, grid.point(d));
             }
-            mean_internal_paths[internal_path.first][j] = sum / m1;
+            path[d] += sum / m1 / 3;
         }
     }
 
-#ifdef DEBUG
-    std::cout << "Mean internal paths computed" << std::endl;
-#endif
+    std::vector<std::pair<XVA, double>> requested(xvas.begin(), xvas.end());
+    greeks.resize(parameters.size(), requested.size());
 
-    for (size_t i = 0; i < nb_points; i++)
+    for (size_t p = 0; p < parameters.size(); p++)
     {
-        double sum = 0;
+        size_t owner = parameters[p].first;
+        Models::Field field = parameters[p].second;
+        Vector profile(nb_dates, 0.0);
+        bool known = true;
+
         for (auto const &internal_path : internal_paths)
         {
-            sum += mean_internal_paths[internal_path.first][i];
+            size_t g = size_t(internal_path.first);
+            const PathBlock &block = internal_path.second;
+            PathView<const double> start = external_paths.at(internal_path.first).path(0);
+
+            // The first internal path is the first external path
+            if (owner == g)
+            {
+                Vector tangent(nb_points);
+                known = known && Models::tangent(config.external.at(internal_path.first), field, times.data(), start.data(), nb_points, tangent.data());
+                for (size_t d = 0; d < nb_dates; d++)
+                {
+                    profile[d] += tangent[grid.point(d)] / m1 / 3;
+                }
+            }
+
+            // The other internal paths start from the initial external value
+            bool internal = owner == nb_factors || (owner == g && field == Models::Field::X0);
+            if (!internal || block.nb_paths() < 2)
+            {
+                continue;
+            }
+            Models::Parameters model = config.internal;
+            model.x0 = start[0];
+            Models::Field internal_field = owner == nb_factors ? field : Models::Field::X0;
+
+            size_t nb_chunks = (block.nb_paths() - 1 + valuation_chunk - 1) / valuation_chunk;
+            PathBlock sums(nb_chunks, nb_dates);
+            std::vector<char> supported(nb_chunks, 1);
+            pool->parallel_for(0, nb_chunks, 1, [&](size_t begin, size_t end)
+                               {
+                Vector tangent(nb_points);
+                for (size_t c = begin; c < end; c++)
+                {
+                    PathView<double> sum = sums.path(c);
+                    std::fill(sum.data(), sum.data() + nb_dates, 0.0);
+                    size_t last = std::min(block.nb_paths(), 1 + (c + 1) * valuation_chunk);
+                    for (size_t i = 1 + c * valuation_chunk; i < last; i++)
+                    {
+                        supported[c] = supported[c] && Models::tangent(model, internal_field, times.data(), block.path(i).data(), nb_points, tangent.data());
+                        for (size_t d = 0; d < nb_dates; d++)
+                        {
+                            sum[d] += tangent[grid.point(d)];
+                        }
+                    }
+                } });
+
+            // Chunks merged in order, so results do not depend on the threads
+            for (size_t c = 0; c < nb_chunks; c++)
+            {
+                known = known && supported[c];
+                for (size_t d = 0; d < nb_dates; d++)
+                {
+                    profile[d] += sums(c, d) / m1 / 3;
+                }
+            }
+        }
+
+        for (size_t k = 0; k < requested.size(); k++)
+        {
+            double greek = 0;
+            for (size_t d = 0; d < nb_dates; d++)
+            {
+                XVA xva = requested[k].first;
+                greek += xva_slope(xva, requested[k].second, path[d], market.weight(xva, d)) * profile[d];
+            }
+            greeks(p, k) = known ? greek : std::numeric_limits<double>::quiet_NaN();
         }
-        path[i] = sum / 3;
     }
+    return true;
+}
 
-    Vector EPE, DPE;
-    maximum<double>(path, factor, EPE);
-    DPE = EPE;
+void NMC::compute_exposure(const std::map<ExternalPaths, PathBlock> &external_paths, Vector &path, Vector &standard_error, PathBlock &pfe) const
+{
+    if (config.control_variates && analytic_exposure(external_paths, path))
+    {
+        standard_error.assign(streaming ? nb_dates : 0, 0.0);
+        return;
+    }
+    if (streaming)
+    {
+        switch (config.precision)
+        {
+        case Precision::Float:
+            stream_exposure<float, float>(external_paths, path, standard_error, pfe);
+            break;
+        case Precision::Mixed:
+            stream_exposure<float, double>(external_paths, path, standard_error, pfe);
+            break;
+        default:
+            stream_exposure<double, double>(external_paths, path, standard_error, pfe);
+        }
+        return;
+    }
+    standard_error.clear();
 
-    for (size_t i = 0; i < nb_points; i++)
+    if (config.portfolio.empty())
     {
-        EPE[i] -= factor;
-        DPE[i] = factor - DPE[i];
+        switch (config.precision)
+        {
+        case Precision::Float:
+            mean_exposure<float, float>(external_paths, path, pfe);
+            break;
+        case Precision::Mixed:
+            mean_exposure<float, double>(external_paths, path, pfe);
+            break;
+        default:
+            mean_exposure<double, double>(external_paths, path, pfe);
+        }
+        return;
     }
 
-    double loss_given_default = 0.4;
-    double funding_cost = 0.05;
-    double capital_cost = 0.1;
+    std::map<ExternalPaths, PathBlock> internal_paths;
+    size_t width = nb_sets * nb_dates;
+    path.assign(width, 0.0);
+    generate_internal_paths(external_paths, internal_paths);
 
-    final_path.resize(nb_points);
+    size_t nb_paths = size_t(m1);
+    PathBlock values(nb_paths, width);
+    pool->parallel_for(0, nb_paths, valuation_chunk, [&](size_t begin, size_t end)
+                       { portfolio_values(internal_paths, begin, end - begin, values, begin); });
 
-    switch (xva)
+    // Summed in the order of the paths, so results do not depend on the threads
+    for (size_t i = 0; i < nb_paths; i++)
     {
-    case CVA:
-        for (size_t i = 0; i < nb_points; i++)
+        for (size_t e = 0; e < width; e++)
         {
-            final_path[i] = EPE[i] * (1 - loss_given_default) * 0.01;
+            path[e] += values(i, e);
         }
-        break;
+    }
+    for (size_t e = 0; e < width; e++)
+    {
+        path[e] /= m1;
+    }
 
-    case DVA:
-        for (size_t i = 0; i < nb_points; i++)
+    sketch_paths(nb_paths, [&](size_t i, double *row, double *weights)
+                 {
+        for (size_t d = 0; d < nb_dates; d++)
+        {
+            row[d] = exposure(&values(i, d));
+            weights[d] = 1;
+        } }, pfe);
+}
+
+template <typename Real, typename Sum>
+void NMC::mean_exposure(const std::map<ExternalPaths, PathBlock> &external_paths, Vector &path, PathBlock &pfe) const
+{
+    std::map<ExternalPaths, BasicPathBlock<Real>> internal_paths;
+    std::map<ExternalPaths, std::vector<Sum>> mean_internal_paths;
+    path.assign(nb_dates, 0.0);
+
+#ifdef DEBUG
+    std::cout << "Internal paths and mean internal paths initialized" << std::endl;
+#endif
+
+    generate_internal_paths(external_paths, internal_paths);
+
+#ifdef DEBUG
+    std::cout << "Internal paths generated" << std::endl;
+#endif
+
+    size_t nb_chunks = (size_t(m1) + reduce_chunk - 1) / reduce_chunk;
+    size_t nb_tiles = (nb_dates + time_tile - 1) / time_tile;
+    std::vector<Sum> partials(nb_chunks * nb_dates);
+    for (auto const &internal_path : internal_paths)
+    {
+        const BasicPathBlock<Real> &block = internal_path.second;
+        std::vector<Sum> &mean = mean_internal_paths[internal_path.first];
+        mean.assign(nb_dates, Sum(0));
+
+        // Each task sums a chunk of paths over a contiguous segment of exposure dates
+        pool->parallel_for(0, nb_chunks * nb_tiles, 1, [&](size_t begin, size_t end)
+                           {
+            for (size_t t = begin; t < end; t++)
+            {
+                size_t c = t / nb_tiles;
+                size_t first_date = (t % nb_tiles) * time_tile;
+                size_t last_date = std::min(nb_dates, first_date + time_tile);
+                Sum *partial = partials.data() + c * nb_dates;
+                std::fill(partial + first_date, partial + last_date, Sum(0));
+                for (size_t i = c * reduce_chunk; i < std::min(block.nb_paths(), (c + 1) * reduce_chunk); i++)
+                {
+                    PathView<const Real> row = block.path(i);
+                    for (size_t d = first_date; d < last_date; d++)
+                    {
+                        partial[d] += row[grid.point(d)];
+                    }
+                }
+            } });
+
+        // Chunks are combined in order, so results do not depend on the threads
+        for (size_t c = 0; c < nb_chunks; c++)
+        {
+            for (size_t d = 0; d < nb_dates; d++)
+            {
+                mean[d] += partials[c * nb_dates + d];
+            }
+        }
+        for (size_t d = 0; d < nb_dates; d++)
         {
-            final_path[i] = DPE[i] * (1 - loss_given_default) * 0.01;
+            mean[d] /= Sum(m1);
         }
-        break;
+    }
 
-    case FVA:
-        for (size_t i = 0; i < nb_points; i++)
+#ifdef DEBUG
+    std::cout << "Mean internal paths computed" << std::endl;
+#endif
+
+    for (size_t i = 0; i < nb_dates; i++)
+    {
+        Sum sum = 0;
+        for (auto const &internal_path : internal_paths)
         {
-            final_path[i] = std::max(EPE[i] - DPE[i], 0.0) * funding_cost * std::exp(-0.03 * i * T / nb_points);
+            sum += mean_internal_paths[internal_path.first][i];
         }
+        path[i] = sum / 3;
+    }
+
+    sketch_paths(size_t(m1), [&](size_t i, double *row, double *weights)
+                 {
+        std::fill(row, row + nb_dates, 0.0);
+        std::fill(weights, weights + nb_dates, 1.0);
+        for (auto const &internal_path : internal_paths)
+        {
+            PathView<const Real> internal = internal_path.second.path(i);
+            for (size_t d = 0; d < nb_dates; d++)
+            {
+                row[d] += internal[grid.point(d)] / 3;
+            }
+        } }, pfe);
+}
+
+void NMC::sketch_paths(size_t nb_paths, const std::function<void(size_t, double *, double *)> &fill, PathBlock &pfe) const
+{
+    size_t nb_chunks = (nb_paths + stream_chunk - 1) / stream_chunk;
+    PathSketch sketch(nb_dates);
+    std::vector<PathSketch> partials(std::min(sketch_wave, nb_chunks));
 
-        break;
+    for (size_t first = 0; first < nb_chunks; first += sketch_wave)
+    {
+        size_t last = std::min(nb_chunks, first + sketch_wave);
 
-    case MVA:
-        for (size_t i = 0; i < nb_points; i++)
+        pool->parallel_for(first, last, 1, [&](size_t begin, size_t end)
+                           {
+            Vector row(nb_dates), weights(nb_dates);
+            for (size_t c = begin; c < end; c++)
+            {
+                PathSketch &partial = partials[c - first];
+                partial = PathSketch(nb_dates);
+                for (size_t i = c * stream_chunk; i < std::min(nb_paths, (c + 1) * stream_chunk); i++)
+                {
+                    fill(i, row.data(), weights.data());
+                    partial.add(PathView<const double>(row.data(), nb_dates), PathView<const double>(weights.data(), nb_dates));
+                }
+                partial.flush();
+            } });
+
+        for (size_t c = first; c < last; c++)
         {
-            final_path[i] = EPE[i] * funding_cost * std::exp(-0.03 * i * T / nb_points);
+            sketch.merge(partials[c - first]);
         }
-        break;
+    }
 
-    case KVA:
-        for (size_t i = 0; i < nb_points; i++)
+    pfe.resize(config.pfe_levels.size(), nb_dates);
+    for (size_t l = 0; l < config.pfe_levels.size(); l++)
+    {
+        for (size_t d = 0; d < nb_dates; d++)
         {
-            final_path[i] = EPE[i] * capital_cost * std::exp(-0.03 * i * T / nb_points);
+            pfe(l, d) = sketch.quantile(d, config.pfe_levels[l]);
         }
-        break;
+    }
+}
 
-    default:
-        break;
+bool NMC::analytic_exposure(const std::map<ExternalPaths, PathBlock> &external_paths, Vector &path) const
+{
+    double mean;
+    if (!config.portfolio.empty() || !Models::expectation(config.internal, 0.0, 0.0, mean))
+    {
+        return false;
+    }
+
+    std::cout << "Control variates: internal paths replaced by the analytic forward of the " << Models::name(config.internal.kind)
+              << " internal model, variance reduction exact" << std::endl;
+
+    // Internal paths 1 to m1 - 1 average to their expectation, the first
+    // internal path being the first external path
+    double weight = (m1 - 1) / m1;
+    path.assign(nb_dates, 0.0);
+    for (auto const &external_path : external_paths)
+    {
+        PathView<const double> start = external_path.second.path(0);
+        for (size_t d = 0; d < nb_dates; d++)
+        {
+            Models::expectation(config.internal, start[0], grid.date(d), mean);
+            path[d] += (start[grid.point(d)] / m1 + weight * mean) / 3;
+        }
     }
+    return true;
 }
 
-void NMC::generate_interest_rate_paths(std::vector<Vector> &paths) const
+template <typename Real, typename Sum>
+void NMC::stream_exposure(const std::map<ExternalPaths, PathBlock> &external_paths, Vector &path, Vector &standard_error, PathBlock &pfe) const
 {
-    std::cout << "Generating interest rate paths on thread " << std::this_thread::get_id() << std::endl;
-    double r0 = 0.03;
-    double k(0.5);
-    double theta = 0.04;
-    double sigma = 0.1;
+    std::cout << "Streaming internal paths on thread " << std::this_thread::get_id() << std::endl;
 
-    std::random_device rd;
-    std::mt19937 gen(rd());
+    size_t nb_paths = size_t(m1);
+    size_t nb_chunks = (nb_paths + stream_chunk - 1) / stream_chunk;
+    if (config.antithetic && nb_paths % 2)
+    {
+        throw Exception("Antithetic sampling needs an even number of internal paths");
+    }
 
-    double dt = T / double(nb_points);
+    // Antithetic pairs are folded in as their mean, the single paths being
+    // kept aside to report the variance reduction. Every exposure set has
+    // its run of dates in the samples.
+    size_t width = nb_sets * nb_dates;
+    PathAccumulator accumulator(width), single(width);
+    std::vector<PathAccumulator> partials(std::min(stream_wave, nb_chunks));
+    std::vector<PathAccumulator> singles(config.antithetic ? partials.size() : 0);
+    PathSketch sketch(nb_dates);
+    std::vector<PathSketch> sketches(partials.size());
 
-    for (size_t i = 0; i < paths.size(); i++)
+    // Chunks are merged in order, wave after wave, so memory stays bounded
+    for (size_t first = 0; first < nb_chunks; first += stream_wave)
     {
-        paths[i].push_back(r0);
-        for (size_t j = 1; j < nb_points; j++)
-        {
-            double dW = std::normal_distribution<double>(0.0, std::sqrt(dt))(gen);
-            paths[i].push_back(paths[i][j - 1] + k * (theta - paths[i][j - 1]) * dt + sigma * dW * std::sqrt(paths[i][j - 1]));
+        size_t last = std::min(nb_chunks, first + stream_wave);
+
+        pool->parallel_for(first, last, 1, [&](size_t begin, size_t end)
+                           {
+            PathBlock samples(SIMD::group, width);
+            Vector pair(width), exposures(nb_dates);
+            std::map<ExternalPaths, BasicPathBlock<Real>> factor_paths;
+            for (auto const &external_path : external_paths)
+            {
+                factor_paths[external_path.first].resize(SIMD::group, nb_points);
+            }
+
+            for (size_t c = begin; c < end; c++)
+            {
+                PathAccumulator &partial = partials[c - first];
+                partial.reset(width);
+                sketches[c - first] = PathSketch(nb_dates);
+                if (config.antithetic)
+                {
+                    singles[c - first].reset(width);
+                }
+
+                size_t chunk_end = std::min(nb_paths, (c + 1) * stream_chunk);
+                for (size_t i = c * stream_chunk; i < chunk_end; i += SIMD::group)
+                {
+                    size_t count = std::min(SIMD::group, chunk_end - i);
+                    std::fill(samples.data(), samples.data() + samples.nb_paths() * samples.stride(), 0.0);
+                    generate_internal_paths(external_paths, i, count, factor_paths, 0);
+                    if constexpr (std::is_same<Real, double>::value)
+                    {
+                        if (!config.portfolio.empty())
+                        {
+                            portfolio_values(factor_paths, 0, count, samples, 0);
+                        }
+                    }
+                    if (config.portfolio.empty())
+                    {
+                        for (size_t l = 0; l < count; l++)
+                        {
+                            for (size_t d = 0; d < nb_dates; d++)
+                            {
+                                Sum sample = 0;
+                                for (auto const &factor_path : factor_paths)
+                                {
+                                    sample += Sum(factor_path.second(l, grid.point(d))) / 3;
+                                }
+                                samples(l, d) = sample;
+                            }
+                        }
+                    }
+                    for (size_t l = 0; l < count; l++)
+                    {
+                        PathView<const double> sample(samples.path(l).data(), width);
+                        for (size_t d = 0; d < nb_dates; d++)
+                        {
+                            exposures[d] = exposure(&samples(l, d));
+                        }
+                        sketches[c - first].add(PathView<const double>(exposures.data(), nb_dates));
+                        if (!config.antithetic)
+                        {
+                            partial.add(sample);
+                            continue;
+                        }
+                        singles[c - first].add(sample);
+                        if (l % 2)
+                        {
+                            for (size_t e = 0; e < width; e++)
+                            {
+                                pair[e] = 0.5 * (samples(l - 1, e) + samples(l, e));
+                            }
+                            partial.add(PathView<const double>(pair.data(), width));
+                        }
+                    }
+                }
+                sketches[c - first].flush();
+            } });
 
-            if (paths[i][j] < 0)
+        for (size_t c = first; c < last; c++)
+        {
+            accumulator.merge(partials[c - first]);
+            sketch.merge(sketches[c - first]);
+            if (config.antithetic)
             {
-                paths[i][j] = 0;
+                single.merge(singles[c - first]);
             }
         }
     }
-}
-
-void NMC::generate_fx_rate_paths(std::vector<Vector> &paths) const
-{
-    std::cout << "Generating interest rate paths on thread " << std::this_thread::get_id() << std::endl;
-    double S0(1.15);
-    double mu(0.02);
-    double sigma = 0.1;
 
-    std::random_device rd;
-    std::mt19937 gen(rd());
+    if (config.antithetic)
+    {
+        double single_variance = 0, pair_variance = 0;
+        for (size_t e = 0; e < width; e++)
+        {
+            single_variance += single.variance(e) / 2;
+            pair_variance += accumulator.variance(e);
+        }
+        std::cout << "Variance reduction of the exposure: antithetic " << single_variance / pair_variance << "x" << std::endl;
+    }
 
-    double dt = T / double(nb_points);
+    path = accumulator.mean();
+    standard_error.resize(width);
+    for (size_t e = 0; e < width; e++)
+    {
+        standard_error[e] = accumulator.standard_error(e);
+    }
 
-    for (size_t i = 0; i < paths.size(); i++)
+    pfe.resize(config.pfe_levels.size(), nb_dates);
+    for (size_t l = 0; l < config.pfe_levels.size(); l++)
     {
-        paths[i].push_back(S0);
-        for (size_t j = 1; j < nb_points; j++)
+        for (size_t d = 0; d < nb_dates; d++)
         {
-            double dW = std::normal_distribution<double>(0.0, std::sqrt(dt))(gen);
-            paths[i].push_back(paths[i][j - 1] * std::exp((mu - 0.5 * sigma * sigma) * dt + sigma * dW));
+            pfe(l, d) = sketch.quantile(d, config.pfe_levels[l]);
         }
     }
 }
 
-void NMC::generate_equity_paths(std::vector<Vector> &paths) const
+void NMC::generate_external_paths(std::map<ExternalPaths, PathBlock> &paths) const
 {
-    std::cout << "Generating interest rate paths on thread " << std::this_thread::get_id() << std::endl;
-    double S0(100);
-    double mu(0.08);
-    double sigma = 0.2;
+    std::cout << "Generating correlated interest rate, FX rate and equity paths in a single pass on thread " << std::this_thread::get_id() << std::endl;
 
-    std::random_device rd;
-    std::mt19937 gen(rd());
+    for (auto const &model : config.external)
+    {
+        paths[model.first].resize(size_t(m0), nb_points);
+    }
 
-    double dt = T / double(nb_points);
+    // Each group draws, correlates and evolves every factor while its paths are in cache
+    for_each_lane_group(size_t(m0), [&](size_t begin, size_t end)
+                        { generate_external_paths(begin, end - begin, paths, begin); });
+}
 
-    for (size_t i = 0; i < paths.size(); i++)
+void NMC::generate_external_paths(size_t first, size_t count, std::map<ExternalPaths, PathBlock> &paths, size_t row) const
+{
+    draw_external_normals(first, count, paths, row);
+    correlate(count, paths, row, nb_points);
+    for (auto const &model : config.external)
     {
-        paths[i].push_back(S0);
-        for (size_t j = 1; j < nb_points; j++)
-        {
-            double dW = std::normal_distribution<double>(0.0, std::sqrt(dt))(gen);
-            paths[i].push_back(paths[i][j - 1] * std::exp((mu - 0.5 * sigma * sigma) * dt + sigma * dW));
-        }
+        PathBlock &block = paths.at(model.first);
+        const Models::Parameters &parameters = model.second;
+        Models::visit(parameters.kind, [&](auto policy)
+                      { evolve<decltype(policy)>(parameters, parameters.x0, 0, count, nb_points, block.path(row).data(), block.stride()); });
     }
 }
 
-void NMC::generate_internal_paths(const Matrix &external_paths, Matrix &paths) const
+void NMC::generate_external_normals(std::map<ExternalPaths, PathBlock> &normals) const
 {
-    std::cout << "Generating internal paths on thread " << std::this_thread::get_id() << std::endl;
+    for (auto const &model : config.external)
+    {
+        normals[model.first].resize(size_t(m0), nb_points);
+    }
 
-#ifdef DEBUG
-    std::cout << "External paths size: " << external_paths.size() << std::endl;
-    std::cout << "First path size: " << external_paths[0].size() << std::endl;
-#endif
+    for_each_lane_group(size_t(m0), [&](size_t begin, size_t end)
+                        {
+        draw_external_normals(begin, end - begin, normals, begin);
+        correlate(end - begin, normals, begin, nb_points); });
+}
+
+void NMC::evolve_external_paths(const std::map<ExternalPaths, PathBlock> &normals, std::map<ExternalPaths, PathBlock> &paths, ExternalPaths factor) const
+{
+    const PathBlock &samples = normals.at(factor);
+    PathBlock &block = paths[factor];
+    block.resize(samples.nb_paths(), nb_points);
+    const Models::Parameters &parameters = config.external.at(factor);
 
-    paths.resize(m1);
+    for_each_lane_group(samples.nb_paths(), [&](size_t begin, size_t end)
+                        {
+        for (size_t i = begin; i < end; i++)
+        {
+            std::copy(samples.path(i).data(), samples.path(i).data() + nb_points, block.path(i).data());
+        }
+        Models::visit(parameters.kind, [&](auto policy)
+                      { evolve<decltype(policy)>(parameters, parameters.x0, 0, end - begin, nb_points, block.path(begin).data(), block.stride()); }); });
+}
+
+template <typename Real>
+void NMC::generate_internal_paths(const std::map<ExternalPaths, PathBlock> &external_paths, std::map<ExternalPaths, BasicPathBlock<Real>> &paths) const
+{
+    std::cout << "Generating internal paths on thread " << std::this_thread::get_id() << std::endl;
 
-    for (size_t i = 0; i < nb_points; i++)
+    for (auto const &external_path : external_paths)
     {
-        paths[0].push_back(external_paths[0][i]);
+        paths[external_path.first].resize(size_t(m1), nb_points);
     }
 
-    #ifdef DEBUG
-        std::cout << "First path generated" << std::endl;
-    #endif
+    for_each_lane_group(size_t(m1), [&](size_t begin, size_t end)
+                        { generate_internal_paths(external_paths, begin, end - begin, paths, begin); });
+}
+
+template <typename Real>
+void NMC::generate_internal_paths(const std::map<ExternalPaths, PathBlock> &external_paths, size_t first, size_t count, std::map<ExternalPaths, BasicPathBlock<Real>> &paths, size_t row) const
+{
+    draw_correlated_normals([&](ExternalPaths factor, size_t i)
+                            {
+                                size_t inner = first + i;
+                                bool negated = antithetic(inner);
+                                return RNG::Stream(seed, factor, 0, uint32_t(inner), negated); },
+                            count, paths, row, nb_points);
 
-    std::random_device rd;
-    std::mt19937 gen(rd());
+    for (auto const &external_path : external_paths)
+    {
+        PathView<const double> start = external_path.second.path(0);
+        BasicPathBlock<Real> &block = paths.at(external_path.first);
 
-    double sigma = 0.2;
-    double mu = 0.05;
+        Models::visit(config.internal.kind, [&](auto policy)
+                      { evolve<decltype(policy)>(config.internal, start[0], 0, count, nb_points, block.path(row).data(), block.stride()); });
 
-    double dt = T / double(nb_points);
+        // The first internal path is the first external path
+        if (first == 0 && count > 0)
+        {
+            PathView<Real> path = block.path(row);
+            for (size_t j = 0; j < nb_points; j++)
+            {
+                path[j] = Real(start[j]);
+            }
+        }
+    }
+}
 
-    for (size_t i = 0; i < m1; i++)
+template <typename Real>
+void NMC::draw_correlated_normals(const StreamFunction &stream, size_t count, std::map<ExternalPaths, BasicPathBlock<Real>> &paths, size_t row, size_t length) const
+{
+    for (auto &factor_paths : paths)
     {
-        paths[i].push_back(external_paths[0][0]);
-        for (size_t j = 1; j < nb_points; j++)
+        for (size_t i = 0; i < count; i++)
         {
-            double dW = std::normal_distribution<double>(0.0, std::sqrt(dt))(gen);
-            paths[i].push_back(paths[i][j - 1] * exp((mu - 0.5 * sigma * sigma) * dt + sigma * dW));
+            draw_normals(stream(factor_paths.first, i), PathView<Real>(factor_paths.second.path(row + i).data(), length));
         }
     }
-}
\ No newline at end of file
+    correlate(count, paths, row, length);
+}
+
+void NMC::draw_external_normals(size_t first, size_t count, std::map<ExternalPaths, PathBlock> &paths, size_t row) const
+{
+    if (config.qmc_replicates > 0)
+    {
+        draw_qmc_normals(first, count, paths, row);
+    }
+    else
+    {
+        for (auto &factor_paths : paths)
+        {
+            for (size_t i = 0; i < count; i++)
+            {
+                size_t outer = first + i;
+                bool negated = antithetic(outer);
+                draw_normals(RNG::Stream(seed, factor_paths.first, uint32_t(outer), 0, negated), factor_paths.second.path(row + i));
+            }
+        }
+    }
+
+    if (config.importance == Importance::None)
+    {
+        return;
+    }
+    for (auto &factor_paths : paths)
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            double *path = factor_paths.second.path(row + i).data();
+            for (size_t j = 1; j < nb_points; j++)
+            {
+                path[j] += shift[factor_paths.first];
+            }
+        }
+    }
+}
+
+void NMC::draw_qmc_normals(size_t first, size_t count, std::map<ExternalPaths, PathBlock> &paths, size_t row) const
+{
+    size_t replicates = config.qmc_replicates;
+    size_t nb_steps = bridge.nb_steps();
+    Vector z(nb_steps);
+
+    for (auto &factor_paths : paths)
+    {
+        size_t factor = factor_paths.first;
+        for (size_t i = 0; i < count; i++)
+        {
+            size_t outer = first + i;
+            uint32_t replicate = uint32_t(outer % replicates);
+            uint32_t index = uint32_t(outer / replicates);
+
+            // Bridge sample k of every factor comes before sample k + 1 of any
+            // factor; dimensions beyond the Sobol table are padded with the
+            // pseudo-random stream of the path
+            for (size_t k = 0; k < nb_steps; k++)
+            {
+                size_t dimension = k * nb_factors + factor;
+                if (dimension < QMC::max_dimension)
+                {
+                    uint32_t x = QMC::scramble(QMC::sobol(index, dimension), QMC::scramble_seed(seed, replicate, uint32_t(dimension)));
+                    z[k] = QMC::inverse_normal((x + 0.5) * (1.0 / 4294967296.0));
+                }
+                else
+                {
+                    z[k] = RNG::normal(seed, uint32_t(factor), uint32_t(outer), 0, uint32_t(k + 1));
+                }
+            }
+            bridge.build(z.data(), factor_paths.second.path(row + i).data() + 1);
+        }
+    }
+}
+
+template <typename Real>
+void NMC::correlate(size_t count, std::map<ExternalPaths, BasicPathBlock<Real>> &paths, size_t row, size_t length) const
+{
+    if (!correlated || paths.size() != nb_factors)
+    {
+        return;
+    }
+
+    for (size_t i = 0; i < count; i++)
+    {
+        Real *rows[nb_factors];
+        for (auto &factor_paths : paths)
+        {
+            rows[factor_paths.first] = factor_paths.second.path(row + i).data();
+        }
+
+        for (size_t j = 1; j < length; j++)
+        {
+            double z[nb_factors];
+            for (size_t f = 0; f < nb_factors; f++)
+            {
+                z[f] = rows[f][j];
+            }
+            cholesky.apply(z);
+            for (size_t f = 0; f < nb_factors; f++)
+            {
+                rows[f][j] = Real(z[f]);
+            }
+        }
+    }
+}
+
+template <class Model, typename Real>
+void NMC::evolve(const Models::Parameters &parameters, double x0, size_t first, size_t count, size_t length, Real *paths, size_t stride) const
+{
+    // One buffer per thread, refilled with the constants of the steps evolved
+    thread_local std::vector<typename Model::Constants> constants;
+    grid.precompute<Model>(parameters, first, length, constants);
+    SIMD::evolve<Model>(paths, stride, count, length, x0, constants.data());
+}
+
+template <class Model, typename Real>
+void NMC::evolve(const Models::Parameters &parameters, size_t first, size_t count, size_t length, Real *paths, size_t stride) const
+{
+    thread_local std::vector<typename Model::Constants> constants;
+    grid.precompute<Model>(parameters, first, length, constants);
+    SIMD::evolve<Model>(paths, stride, count, length, constants.data());
+}
+
+void NMC::for_each_lane_group(size_t nb_paths, const ThreadPool::RangeFunction &body) const
+{
+    size_t nb_groups = (nb_paths + SIMD::group - 1) / SIMD::group;
+
+    pool->parallel_for(0, nb_groups, 0, [&](size_t begin, size_t end)
+                       { body(begin * SIMD::group, std::min(nb_paths, end * SIMD::group)); });
+}
+
+Vector NMC::importance_shift() const
+{
+    Vector drift(nb_factors, 0.0);
+    if (config.importance == Importance::None || nb_points < 2)
+    {
+        return drift;
+    }
+    if (config.estimator == Estimator::Profile || config.estimator == Estimator::MLMC)
+    {
+        throw Exception("Importance sampling needs the nested, adaptive or regression estimator");
+    }
+
+    // Path 0 has zero samples, path p > 0 the sample of its step p bumped
+    size_t nb_steps = nb_points - 1;
+    std::vector<Vector> sensitivities(nb_factors, Vector(nb_steps, 0.0));
+    PathBlock bumped(SIMD::group, nb_points);
+    for (auto const &model : config.external)
+    {
+        const Models::Parameters &parameters = model.second;
+        Vector &sensitivity = sensitivities[model.first];
+        double base = 0;
+        for (size_t first = 0; first <= nb_steps; first += SIMD::group)
+        {
+            size_t count = std::min(SIMD::group, nb_steps + 1 - first);
+            bumped.resize(SIMD::group, nb_points);
+            for (size_t l = 0; l < count; l++)
+            {
+                if (first + l > 0)
+                {
+                    bumped(l, first + l) = bump;
+                }
+            }
+            Models::visit(parameters.kind, [&](auto policy)
+                          { evolve<decltype(policy)>(parameters, parameters.x0, 0, count, nb_points, bumped.data(), bumped.stride()); });
+            for (size_t l = 0; l < count; l++)
+            {
+                if (first + l == 0)
+                {
+                    base = bumped(l, nb_steps);
+                }
+                else
+                {
+                    sensitivity[first + l - 1] = (bumped(l, nb_steps) - base) / bump / 3;
+                }
+            }
+        }
+    }
+
+    // Linear portfolio in the independent samples: the drift moving its mean
+    // by z_alpha standard deviations, along its gradient
+    double gradient[nb_factors] = {}, variance = 0, norm = 0;
+    for (size_t k = 0; k < nb_steps; k++)
+    {
+        for (size_t m = 0; m < nb_factors; m++)
+        {
+            double derivative = 0;
+            for (size_t f = m; f < nb_factors; f++)
+            {
+                derivative += sensitivities[f][k] * cholesky.L[f][m];
+            }
+            gradient[m] += derivative;
+            variance += derivative * derivative;
+        }
+    }
+    for (size_t m = 0; m < nb_factors; m++)
+    {
+        norm += gradient[m] * gradient[m];
+    }
+    if (norm > 0)
+    {
+        for (size_t m = 0; m < nb_factors; m++)
+        {
+            drift[m] = QMC::inverse_normal(config.pfe_levels.back()) * std::sqrt(variance) * gradient[m] / norm;
+        }
+    }
+
+    if (config.importance == Importance::CrossEntropy)
+    {
+        cross_entropy(drift);
+    }
+
+    std::cout << "Importance sampling drift of the interest rate, FX rate and equity samples: "
+              << drift[ExternalPaths::Interest] << ", " << drift[ExternalPaths::FX] << ", " << drift[ExternalPaths::Equity] << std::endl;
+    return drift;
+}
+
+void NMC::cross_entropy(Vector &drift) const
+{
+    size_t nb_pilot = config.importance_pilot;
+    size_t nb_steps = nb_points - 1;
+    if (nb_pilot < 10)
+    {
+        throw Exception("Cross-entropy needs at least 10 pilot paths");
+    }
+
+    std::vector<double> values(nb_pilot), log_weights(nb_pilot), means(nb_pilot * nb_factors);
+    std::vector<std::pair<double, double>> samples(nb_pilot);
+    size_t iteration = 0;
+    double level = 0;
+    while (iteration < max_iterations)
+    {
+        // Pilot paths under the current drift, on streams of their own
+        for_each_lane_group(nb_pilot, [&](size_t begin, size_t end)
+                            {
+            size_t count = end - begin;
+            std::map<ExternalPaths, PathBlock> paths;
+            for (auto const &model : config.external)
+            {
+                paths[model.first].resize(count, nb_points);
+            }
+            for (size_t i = 0; i < count; i++)
+            {
+                log_weights[begin + i] = 0;
+            }
+            for (auto &factor_paths : paths)
+            {
+                size_t f = factor_paths.first;
+                for (size_t i = 0; i < count; i++)
+                {
+                    PathView<double> path = factor_paths.second.path(i);
+                    draw_normals(RNG::Stream(seed, pilot_stream + uint32_t(f), uint32_t(begin + i), uint32_t(iteration)), path);
+                    double sum = 0;
+                    for (size_t j = 1; j < nb_points; j++)
+                    {
+                        path[j] += drift[f];
+                        sum += path[j];
+                    }
+                    means[(begin + i) * nb_factors + f] = sum / nb_steps;
+                    log_weights[begin + i] += drift[f] * (0.5 * drift[f] * nb_steps - sum);
+                }
+            }
+            correlate(count, paths, 0, nb_points);
+            for (size_t i = 0; i < count; i++)
+            {
+                values[begin + i] = 0;
+            }
+            for (auto &factor_paths : paths)
+            {
+                PathBlock &block = factor_paths.second;
+                const Models::Parameters &parameters = config.external.at(factor_paths.first);
+                Models::visit(parameters.kind, [&](auto policy)
+                              { evolve<decltype(policy)>(parameters, parameters.x0, 0, count, nb_points, block.data(), block.stride()); });
+                for (size_t i = 0; i < count; i++)
+                {
+                    values[begin + i] += block(i, nb_steps) / 3;
+                }
+            } });
+        iteration++;
+
+        // Elite paths: beyond the quantile, or the top tenth of the pilot
+        // while the drift is still too weak to reach it
+        for (size_t i = 0; i < nb_pilot; i++)
+        {
+            samples[i] = {values[i], std::exp(log_weights[i])};
+        }
+        double quantile = weighted_quantile(samples, config.pfe_levels.back());
+        level = std::min(quantile, samples[nb_pilot / 10].first);
+
+        double total = 0, next[nb_factors] = {};
+        for (size_t i = 0; i < nb_pilot; i++)
+        {
+            if (values[i] >= level)
+            {
+                double weight = std::exp(log_weights[i]);
+                total += weight;
+                for (size_t f = 0; f < nb_factors; f++)
+                {
+                    next[f] += weight * means[i * nb_factors + f];
+                }
+            }
+        }
+        double change = 0, size = 0;
+        for (size_t f = 0; f < nb_factors; f++)
+        {
+            next[f] /= total;
+            change = std::max(change, std::abs(next[f] - drift[f]));
+            size = std::max(size, std::abs(next[f]));
+            drift[f] = next[f];
+        }
+        if (level == quantile && change <= 0.01 * size)
+        {
+            break;
+        }
+    }
+
+    std::cout << "Cross-entropy drift fitted in " << iteration << " iterations of " << nb_pilot << " pilot paths, PFE level of the portfolio at the horizon " << level << std::endl;
+}
+
+void NMC::likelihood_ratios(size_t first, size_t nb_outer, PathBlock &weights) const
+{
+    weights.resize(nb_outer, nb_dates);
+    if (config.importance == Importance::None)
+    {
+        std::fill(weights.data(), weights.data() + nb_outer * weights.stride(), 1.0);
+        return;
+    }
+
+    // dP/dQ of the steps up to every date, from the shifted samples
+    for_each_lane_group(nb_outer, [&](size_t begin, size_t end)
+                        {
+        size_t count = end - begin;
+        std::map<ExternalPaths, PathBlock> paths;
+        for (auto const &model : config.external)
+        {
+            paths[model.first].resize(count, nb_points);
+        }
+        draw_external_normals(first + begin, count, paths, 0);
+
+        for (size_t i = 0; i < count; i++)
+        {
+            double log_weight = 0;
+            for (size_t j = 0, d = 0; d < nb_dates; j++)
+            {
+                for (auto const &factor_paths : paths)
+                {
+                    double theta = shift[factor_paths.first];
+                    if (j > 0)
+                    {
+                        log_weight += theta * (0.5 * theta - factor_paths.second(i, j));
+                    }
+                }
+                if (grid.point(d) == j)
+                {
+                    weights(begin + i, d++) = std::exp(log_weight);
+                }
+            }
+        } });
+}
+
+void NMC::report_pfe(const PathBlock &values, const PathBlock &weights, const PathBlock &pfe) const
+{
+    size_t nb_outer = values.nb_paths();
+    size_t top = pfe.nb_paths() - 1;
+    double level = config.pfe_levels[top];
+    double squared_error = 0, plain_squared_error = 0;
+    size_t peak_date = 0;
+
+    for (size_t j = 0; j < nb_dates; j++)
+    {
+        if (pfe(top, j) > pfe(top, peak_date))
+        {
+            peak_date = j;
+        }
+
+        // Relative error of the tail probability at the quantile, against
+        // plain sampling of the same number of outer paths
+        double first = 0, second = 0;
+        for (size_t i = 0; i < nb_outer; i++)
+        {
+            if (exposure(values.path(i).data() + j) >= pfe(top, j))
+            {
+                first += weights(i, j) / nb_outer;
+                second += weights(i, j) * weights(i, j) / nb_outer;
+            }
+        }
+        if (first > 0 && first < 0.5)
+        {
+            squared_error += (second - first * first) / (nb_outer * first * first);
+            plain_squared_error += level / (nb_outer * (1 - level));
+        }
+    }
+
+    std::cout << "PFE at " << 100 * level << "%: peak " << pfe(top, peak_date) << " at T = " << grid.date(peak_date) << ", "
+              << pfe(top, nb_dates - 1) << " at the horizon" << std::endl;
+    if (config.importance != Importance::None && squared_error > 0)
+    {
+        std::cout << "PFE tail probability relative error " << std::sqrt(squared_error / nb_dates) << ", plain sampling "
+                  << std::sqrt(plain_squared_error / nb_dates) << " (" << plain_squared_error / squared_error << "x fewer outer paths)" << std::endl;
+    }
+}
+
+bool NMC::antithetic(size_t &index) const
+{
+    if (!config.antithetic || index % 2 == 0)
+    {
+        return false;
+    }
+    index--;
+    return true;
+}
+
+void NMC::draw_normals(const RNG::Stream &stream, PathView<double> path) const
+{
+    if (path.size() > 1)
+    {
+        stream.normals(1, path.size() - 1, path.data() + 1);
+    }
+}
+
+void NMC::draw_normals(const RNG::Stream &stream, PathView<float> path) const
+{
+    if (path.size() > 1)
+    {
+        thread_local Vector normals;
+        normals.resize(path.size() - 1);
+        stream.normals(1, normals.size(), normals.data());
+        for (size_t j = 1; j < path.size(); j++)
+        {
+            path[j] = float(normals[j - 1]);
+        }
+    }
+}
+
+void NMC::nested_values(const std::map<ExternalPaths, PathBlock> &external_paths, PathBlock &values) const
+{
+    nested_range(external_paths, 0, values);
+}
+
+void NMC::nested_range(const std::map<ExternalPaths, PathBlock> &external_paths, size_t first, PathBlock &values) const
+{
+    size_t nb_outer = external_paths.begin()->second.nb_paths();
+    if (!config.portfolio.empty())
+    {
+        std::cout << "Valuing " << config.portfolio.nb_trades() << " trades at every outer node on thread " << std::this_thread::get_id() << std::endl;
+
+        values.resize(nb_outer, nb_sets * nb_dates);
+        pool->parallel_for(0, nb_outer, valuation_chunk, [&](size_t begin, size_t end)
+                           { portfolio_values(external_paths, begin, end - begin, values, begin); });
+        return;
+    }
+
+    std::cout << "Branching " << size_t(m1) << " inner paths from every outer node on thread " << std::this_thread::get_id() << std::endl;
+
+    size_t nb_inner = std::max<size_t>(size_t(m1), 1);
+    values.resize(nb_outer, nb_dates);
+
+    // One task per (outer path, date): early dates cost more, work stealing balances them
+    pool->parallel_for(0, nb_outer * nb_dates, 1, [&](size_t begin, size_t end)
+                       {
+        std::map<ExternalPaths, PathBlock> inner_paths;
+        for (auto const &external_path : external_paths)
+        {
+            inner_paths[external_path.first].resize(SIMD::group, nb_points);
+        }
+
+        for (size_t task = begin; task < end; task++)
+        {
+            size_t outer = task / nb_dates;
+            size_t date = task % nb_dates;
+            values(outer, date) = inner_sum(external_paths, outer, first + outer, grid.point(date), 0, nb_inner, inner_paths) / nb_inner;
+        } });
+}
+
+void NMC::portfolio_values(const std::map<ExternalPaths, PathBlock> &paths, size_t row, size_t count, PathBlock &values, size_t value_row) const
+{
+    double volatility = config.external.at(ExternalPaths::Equity).sigma;
+    for (size_t d = 0; d < nb_dates; d++)
+    {
+        config.portfolio.value(paths, row, count, grid.point(d), grid.date(d), volatility, &values(value_row, d), values.stride(), nb_dates);
+    }
+}
+
+double NMC::inner_sum(const std::map<ExternalPaths, PathBlock> &external_paths, size_t row, size_t outer, size_t point, size_t first, size_t count, std::map<ExternalPaths, PathBlock> &inner_paths, double *sum_squares) const
+{
+    size_t length = nb_points - point;
+
+    // The last date is its own horizon
+    if (length == 1)
+    {
+        double value = 0;
+        for (auto const &external_path : external_paths)
+        {
+            value += external_path.second(row, point) / 3;
+        }
+        if (sum_squares)
+        {
+            *sum_squares += value * value * count;
+        }
+        return value * count;
+    }
+
+    double sum = 0;
+    size_t end = first + count;
+    for (size_t begin = first; begin < end; begin += SIMD::group)
+    {
+        size_t group = std::min(SIMD::group, end - begin);
+        draw_correlated_normals([&](ExternalPaths factor, size_t i)
+                                {
+                                    size_t inner = begin + i;
+                                    bool negated = antithetic(inner);
+                                    return RNG::Stream(seed, uint32_t(factor + nb_factors * (point + 1)), uint32_t(outer), uint32_t(inner + 1), negated); },
+                                group, inner_paths, 0, length);
+
+        for (auto &factor_paths : inner_paths)
+        {
+            PathBlock &block = factor_paths.second;
+            const Models::Parameters &parameters = config.external.at(factor_paths.first);
+            double state = external_paths.at(factor_paths.first)(row, point);
+            Models::visit(parameters.kind, [&](auto policy)
+                          { evolve<decltype(policy)>(parameters, state, point, group, length, block.data(), block.stride()); });
+
+            for (size_t l = 0; l < group; l++)
+            {
+                sum += block(l, length - 1) / 3;
+            }
+        }
+
+        for (size_t l = 0; sum_squares && l < group; l++)
+        {
+            double value = 0;
+            for (auto const &factor_paths : inner_paths)
+            {
+                value += factor_paths.second(l, length - 1) / 3;
+            }
+            *sum_squares += value * value;
+        }
+    }
+    return sum;
+}
+
+void NMC::branch(const std::map<ExternalPaths, PathBlock> &external_paths, size_t row, size_t outer, size_t count, size_t point, size_t inner, std::map<ExternalPaths, PathBlock> &inner_paths, double *values) const
+{
+    size_t length = nb_points - point;
+
+    for (size_t first = 0; first < count; first += SIMD::group)
+    {
+        size_t group = std::min(SIMD::group, count - first);
+        size_t paired = inner;
+        bool negated = antithetic(paired);
+        draw_correlated_normals([&](ExternalPaths factor, size_t i)
+                                { return RNG::Stream(seed, uint32_t(factor + nb_factors * (point + 1)), uint32_t(outer + first + i), uint32_t(paired + 1), negated); },
+                                group, inner_paths, 0, length);
+
+        for (auto &factor_paths : inner_paths)
+        {
+            PathBlock &block = factor_paths.second;
+            const PathBlock &states = external_paths.at(factor_paths.first);
+            const Models::Parameters &parameters = config.external.at(factor_paths.first);
+            for (size_t l = 0; l < group; l++)
+            {
+                block(l, 0) = states(row + first + l, point);
+            }
+            Models::visit(parameters.kind, [&](auto policy)
+                          { evolve<decltype(policy)>(parameters, point, group, length, block.data(), block.stride()); });
+
+            for (size_t l = 0; l < group; l++)
+            {
+                values[first + l] += block(l, length - 1) / 3;
+            }
+        }
+    }
+}
+
+void NMC::run_nested(const std::map<XVA, double> &xvas, const std::map<ExternalPaths, PathBlock> &external_paths, PathBlock &final_paths, PathBlock &errors, PathBlock &pfe) const
+{
+    PathBlock values;
+    nested_values(external_paths, values);
+    reduce_nested(xvas, external_paths, values, final_paths, errors, pfe);
+}
+
+void NMC::reduce_nested(const std::map<XVA, double> &xvas, const std::map<ExternalPaths, PathBlock> &external_paths, const PathBlock &values, PathBlock &final_paths, PathBlock &errors, PathBlock &pfe) const
+{
+    std::vector<std::pair<XVA, double>> requested(xvas.begin(), xvas.end());
+    size_t nb_outer = values.nb_paths();
+    final_paths.resize(requested.size(), nb_dates);
+    errors.resize(requested.size(), nb_dates);
+
+    // Quasi-Monte Carlo outer paths are not independent: the error bars come
+    // from the spread of the replicate estimates instead. Antithetic pairs
+    // neither: they are reduced as their mean
+    size_t replicates = config.qmc_replicates >= 2 ? config.qmc_replicates : 1;
+    bool paired = config.antithetic && config.qmc_replicates == 0;
+    if (replicates > 1 && nb_outer < replicates)
+    {
+        throw Exception("Fewer outer paths than quasi-Monte Carlo replicates");
+    }
+    if (paired && nb_outer % 2)
+    {
+        throw Exception("Antithetic sampling needs an even number of outer paths");
+    }
+
+    PathBlock controls, weights;
+    Vector expectations;
+    bool controlled = config.control_variates && outer_controls(external_paths, controls, expectations);
+    likelihood_ratios(0, nb_outer, weights);
+    sketch_paths(nb_outer, [&](size_t i, double *row, double *weight)
+                 {
+        for (size_t j = 0; j < nb_dates; j++)
+        {
+            row[j] = exposure(values.path(i).data() + j);
+            weight[j] = weights(i, j);
+        } }, pfe);
+    report_pfe(values, weights, pfe);
+
+    // Reduced in the order of the outer paths, so results do not depend on the threads
+    for (size_t k = 0; k < requested.size(); k++)
+    {
+        XVA xva = requested[k].first;
+        double factor = requested[k].second;
+        PathView<const double> payoff_weights = market.weights(xva);
+
+        // Control variate coefficients, from the covariance of the payoff
+        // and the control over the outer paths
+        Vector beta(nb_dates, 0.0), variance(nb_dates, 0.0), controlled_variance(nb_dates, 0.0);
+        if (controlled || paired)
+        {
+            for (size_t j = 0; j < nb_dates; j++)
+            {
+                double y0 = weights(0, j) * payoff(xva, factor, values.path(0).data() + j, payoff_weights[j]);
+                double c0 = controlled ? weights(0, j) * controls(0, j) : 0.0;
+                double sy = 0, sc = 0, syy = 0, scc = 0, syc = 0;
+                for (size_t i = 0; i < nb_outer; i++)
+                {
+                    double y = weights(i, j) * payoff(xva, factor, values.path(i).data() + j, payoff_weights[j]) - y0;
+                    double c = controlled ? weights(i, j) * controls(i, j) - c0 : 0.0;
+                    sy += y;
+                    sc += c;
+                    syy += y * y;
+                    scc += c * c;
+                    syc += y * c;
+                }
+                double covariance = (syc - sy * sc / nb_outer) / (nb_outer - 1);
+                double control_variance = (scc - sc * sc / nb_outer) / (nb_outer - 1);
+                variance[j] = std::max((syy - sy * sy / nb_outer) / (nb_outer - 1), 0.0);
+                beta[j] = control_variance > 0 ? covariance / control_variance : 0.0;
+                controlled_variance[j] = std::max(variance[j] - beta[j] * covariance, 0.0);
+            }
+        }
+
+        std::vector<PathAccumulator> estimates(replicates, PathAccumulator(nb_dates));
+        fold_payoffs(xva, factor, values, weights, 0, controlled ? &controls : nullptr, beta, expectations, estimates.data());
+
+        PathAccumulator accumulator = estimates[0];
+        if (replicates > 1)
+        {
+            accumulator.reset(nb_dates);
+            for (auto const &estimate : estimates)
+            {
+                accumulator.add(PathView<const double>(estimate.mean().data(), nb_dates));
+            }
+        }
+        for (size_t j = 0; j < nb_dates; j++)
+        {
+            final_paths(k, j) = accumulator.mean()[j];
+            errors(k, j) = accumulator.standard_error(j);
+        }
+
+        if (controlled || paired)
+        {
+            double total = 0, total_controlled = 0, total_paired = 0;
+            for (size_t j = 0; j < nb_dates; j++)
+            {
+                total += variance[j];
+                total_controlled += controlled_variance[j];
+                total_paired += paired ? accumulator.variance(j) : 0.0;
+            }
+            std::cout << "Variance reduction of " << Utils::pretty_print_xva_name(xva) << ":";
+            if (paired)
+            {
+                std::cout << " antithetic " << total_controlled / 2 / total_paired << "x";
+            }
+            if (controlled)
+            {
+                std::cout << " control variates " << total / total_controlled << "x";
+            }
+            std::cout << std::endl;
+        }
+    }
+}
+
+void NMC::fold_payoffs(XVA xva, double factor, const PathBlock &values, const PathBlock &weights, size_t first, const PathBlock *controls, const Vector &beta, const Vector &expectations, PathAccumulator *estimates) const
+{
+    size_t replicates = config.qmc_replicates >= 2 ? config.qmc_replicates : 1;
+    bool paired = config.antithetic && config.qmc_replicates == 0;
+    PathView<const double> payoff_weights = market.weights(xva);
+    Vector path(nb_dates), pair(nb_dates);
+
+    for (size_t i = 0; i < values.nb_paths(); i++)
+    {
+        for (size_t j = 0; j < nb_dates; j++)
+        {
+            path[j] = weights(i, j) * payoff(xva, factor, values.path(i).data() + j, payoff_weights[j]);
+            if (controls)
+            {
+                path[j] -= beta[j] * (weights(i, j) * (*controls)(i, j) - expectations[j]);
+            }
+        }
+        if (!paired)
+        {
+            estimates[(first + i) % replicates].add(PathView<const double>(path.data(), nb_dates));
+        }
+        else if (i % 2 == 0)
+        {
+            pair.swap(path);
+        }
+        else
+        {
+            for (size_t j = 0; j < nb_dates; j++)
+            {
+                pair[j] = 0.5 * (pair[j] + path[j]);
+            }
+            estimates[0].add(PathView<const double>(pair.data(), nb_dates));
+        }
+    }
+}
+
+void NMC::nested_shard(const std::map<XVA, double> &xvas, size_t first, size_t count, Shard::Partial &partial) const
+{
+    std::cout << "Running outer paths " << first << " to " << first + count - 1 << " on thread " << std::this_thread::get_id() << std::endl;
+
+    std::map<ExternalPaths, PathBlock> external_paths;
+    for (auto const &model : config.external)
+    {
+        external_paths[model.first].resize(count, nb_points);
+    }
+    for_each_lane_group(count, [&](size_t begin, size_t end)
+                        { generate_external_paths(first + begin, end - begin, external_paths, begin); });
+
+    PathBlock values, weights;
+    nested_range(external_paths, first, values);
+    likelihood_ratios(first, count, weights);
+
+    std::vector<std::pair<XVA, double>> requested(xvas.begin(), xvas.end());
+    partial.first = first;
+    partial.count = count;
+    partial.replicates = config.qmc_replicates >= 2 ? config.qmc_replicates : 1;
+    partial.estimates.assign(requested.size() * partial.replicates, PathAccumulator(nb_dates));
+    partial.sketch = PathSketch(nb_dates);
+    Vector exposures(nb_dates);
+    for (size_t i = 0; i < count; i++)
+    {
+        for (size_t j = 0; j < nb_dates; j++)
+        {
+            exposures[j] = exposure(values.path(i).data() + j);
+        }
+        partial.sketch.add(PathView<const double>(exposures.data(), nb_dates), PathView<const double>(weights.path(i).data(), nb_dates));
+    }
+    partial.sketch.flush();
+
+    for (size_t k = 0; k < requested.size(); k++)
+    {
+        fold_payoffs(requested[k].first, requested[k].second, values, weights, first, nullptr, Vector(), Vector(),
+                     partial.estimates.data() + k * partial.replicates);
+    }
+}
+
+bool NMC::outer_controls(const std::map<ExternalPaths, PathBlock> &external_paths, PathBlock &controls, Vector &expectations) const
+{
+    std::vector<ExternalPaths> known;
+    double mean;
+    for (auto const &external_path : external_paths)
+    {
+        if (Models::expectation(config.external.at(external_path.first), 0.0, 0.0, mean))
+        {
+            known.push_back(external_path.first);
+        }
+    }
+    if (known.empty())
+    {
+        return false;
+    }
+
+    size_t nb_outer = size_t(m0);
+    controls.resize(nb_outer, nb_dates);
+    expectations.assign(nb_dates, 0.0);
+    for (ExternalPaths factor : known)
+    {
+        const Models::Parameters &parameters = config.external.at(factor);
+        const PathBlock &block = external_paths.at(factor);
+        for (size_t d = 0; d < nb_dates; d++)
+        {
+            Models::expectation(parameters, parameters.x0, grid.date(d), mean);
+            expectations[d] += mean / 3;
+        }
+        for (size_t i = 0; i < nb_outer; i++)
+        {
+            for (size_t d = 0; d < nb_dates; d++)
+            {
+                controls(i, d) += block(i, grid.point(d)) / 3;
+            }
+        }
+    }
+    return true;
+}
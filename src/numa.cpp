@@ -0,0 +1,322 @@
+/**
+ * @file numa.cpp
+ * @author Thomas Roiseux (thomas.roiseux@mathquantlab.com)
+ * @brief Implements {@link numa.h}
+ * @version 1.0
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+
+#include "../headers/numa.h"
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <thread>
+#include <algorithm>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#endif
+
+/**
+ * @brief Pin the workers of the thread pools
+ *
+ */
+static std::atomic<bool> pinned_workers(false);
+
+/**
+ * @brief Huge page policy
+ *
+ */
+static std::atomic<int> page_policy(NUMA::Default);
+
+/**
+ * @brief Parse a list of CPUs or nodes, as "0-3,8-11"
+ *
+ * @param list List
+ * @return std::vector<unsigned> Numbers
+ */
+static std::vector<unsigned> parse_list(const std::string &list)
+{
+    std::vector<unsigned> numbers;
+    std::stringstream stream(list);
+    std::string range;
+    while (std::getline(stream, range, ','))
+    {
+        unsigned first, last;
+        int nb_read = sscanf(range.c_str(), "%u-%u", &first, &last);
+        if (nb_read < 1)
+        {
+            continue;
+        }
+        if (nb_read == 1)
+        {
+            last = first;
+        }
+        for (unsigned n = first; n <= last; n++)
+        {
+            numbers.push_back(n);
+        }
+    }
+    return numbers;
+}
+
+/**
+ * @brief Read the nodes from /sys, keeping the CPUs the process may run on
+ *
+ * @return std::vector<NUMA::Node> Nodes, a single one if the topology is
+ * unknown
+ */
+static std::vector<NUMA::Node> read_nodes()
+{
+    std::vector<NUMA::Node> list;
+    std::vector<bool> allowed;
+
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set) == 0)
+    {
+        for (unsigned cpu = 0; cpu < CPU_SETSIZE; cpu++)
+        {
+            if (CPU_ISSET(cpu, &set))
+            {
+                allowed.resize(cpu + 1, false);
+                allowed[cpu] = true;
+            }
+        }
+    }
+
+    std::string online;
+    std::ifstream online_file("/sys/devices/system/node/online");
+    if (std::getline(online_file, online))
+    {
+        for (unsigned id : parse_list(online))
+        {
+            std::string cpulist;
+            std::ifstream cpu_file("/sys/devices/system/node/node" + std::to_string(id) + "/cpulist");
+            std::getline(cpu_file, cpulist);
+
+            NUMA::Node node{id, {}};
+            for (unsigned cpu : parse_list(cpulist))
+            {
+                if (allowed.empty() || (cpu < allowed.size() && allowed[cpu]))
+                {
+                    node.cpus.push_back(cpu);
+                }
+            }
+            if (!node.cpus.empty())
+            {
+                list.push_back(node);
+            }
+        }
+    }
+#endif
+
+    if (list.empty())
+    {
+        NUMA::Node node{0, {}};
+        for (unsigned cpu = 0; cpu < std::max(1u, std::thread::hardware_concurrency()); cpu++)
+        {
+            node.cpus.push_back(cpu);
+        }
+        list.push_back(node);
+    }
+    return list;
+}
+
+#ifdef __linux__
+/**
+ * @brief Read the size of the pages of the hugetlbfs pool from /proc/meminfo
+ *
+ * @return size_t Size in bytes, 0 if unknown
+ */
+static size_t read_hugetlb_page()
+{
+    std::ifstream meminfo("/proc/meminfo");
+    std::string line;
+    while (std::getline(meminfo, line))
+    {
+        unsigned long kilobytes;
+        if (sscanf(line.c_str(), "Hugepagesize: %lu kB", &kilobytes) == 1)
+        {
+            return size_t(kilobytes) << 10;
+        }
+    }
+    return 0;
+}
+#endif
+
+const std::vector<NUMA::Node> &NUMA::nodes()
+{
+    static const std::vector<Node> list = read_nodes();
+    return list;
+}
+
+bool NUMA::pin(const Node &node) noexcept
+{
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (unsigned cpu : node.cpus)
+    {
+        if (cpu < CPU_SETSIZE)
+        {
+            CPU_SET(cpu, &set);
+        }
+    }
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+    (void)node;
+    return false;
+#endif
+}
+
+void NUMA::select_pinning(bool enabled) noexcept
+{
+    pinned_workers = enabled;
+}
+
+bool NUMA::pinning() noexcept
+{
+    return pinned_workers;
+}
+
+void NUMA::select_pages(Pages pages) noexcept
+{
+    page_policy = pages;
+}
+
+NUMA::Pages NUMA::pages() noexcept
+{
+    return Pages(page_policy.load());
+}
+
+NUMA::Pages NUMA::parse_pages(const std::string &str)
+{
+    if (str == "none")
+    {
+        return Default;
+    }
+    if (str == "transparent")
+    {
+        return Transparent;
+    }
+    if (str == "explicit")
+    {
+        return Explicit;
+    }
+    throw Exception("Unknown huge page policy: " + str);
+}
+
+const char *NUMA::pages_name(Pages pages) noexcept
+{
+    switch (pages)
+    {
+    case Default:
+        return "none";
+    case Transparent:
+        return "transparent";
+    case Explicit:
+        return "explicit";
+    default:
+        return "unknown";
+    }
+}
+
+void *NUMA::allocate(size_t size, size_t alignment, bool &mapped) noexcept
+{
+    mapped = false;
+#ifdef __linux__
+    if (size >= huge_page)
+    {
+        size_t length = (size + huge_page - 1) / huge_page * huge_page;
+        // Blocks are rounded to huge_page, so the pool must hold pages of that size
+        static const size_t hugetlb_page = read_hugetlb_page();
+        if (pages() == Explicit && hugetlb_page == huge_page)
+        {
+            void *ptr = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+            if (ptr != MAP_FAILED)
+            {
+                mapped = true;
+                return ptr;
+            }
+            static std::atomic<bool> warned(false);
+            if (!warned.exchange(true))
+            {
+                std::cerr << "No huge page left in the hugetlbfs pool, using transparent huge pages" << std::endl;
+            }
+        }
+        else if (pages() == Explicit)
+        {
+            static std::atomic<bool> warned(false);
+            if (!warned.exchange(true))
+            {
+                std::cerr << "The hugetlbfs pool holds pages of " << (hugetlb_page >> 10) << " kB instead of " << (huge_page >> 10)
+                          << " kB, using transparent huge pages" << std::endl;
+            }
+        }
+
+        // Mapped with a huge page more, then trimmed to a block aligned on one
+        void *raw = mmap(nullptr, length + huge_page, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (raw != MAP_FAILED)
+        {
+            uintptr_t begin = uintptr_t(raw);
+            uintptr_t aligned = (begin + huge_page - 1) / huge_page * huge_page;
+            if (aligned > begin)
+            {
+                munmap(raw, aligned - begin);
+            }
+            if (begin + huge_page > aligned)
+            {
+                munmap(reinterpret_cast<void *>(aligned + length), begin + huge_page - aligned);
+            }
+            if (pages() != Default)
+            {
+                madvise(reinterpret_cast<void *>(aligned), length, MADV_HUGEPAGE);
+            }
+            mapped = true;
+            return reinterpret_cast<void *>(aligned);
+        }
+    }
+#endif
+
+#ifdef _WIN32
+    return _aligned_malloc(size, alignment);
+#else
+    return std::aligned_alloc(alignment, size);
+#endif
+}
+
+void NUMA::release(void *ptr, size_t size, bool mapped) noexcept
+{
+    if (ptr == nullptr)
+    {
+        return;
+    }
+#ifdef __linux__
+    if (mapped)
+    {
+        munmap(ptr, (size + huge_page - 1) / huge_page * huge_page);
+        return;
+    }
+#else
+    (void)size;
+    (void)mapped;
+#endif
+
+#ifdef _WIN32
+    _aligned_free(ptr);
+#else
+    std::free(ptr);
+#endif
+}
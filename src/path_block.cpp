@@ -0,0 +1,156 @@
+/**
+ * @file path_block.cpp
+ * @author Thomas Roiseux (thomas.roiseux@mathquantlab.com)
+ * @brief Implements {@link path_block.h}
+ * @version 1.0
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+
+#include "../headers/path_block.h"
+#include "../headers/numa.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <utility>
+
+/**
+ * @brief Allocate an aligned, zero-filled buffer
+ *
+ * Large buffers are mapped zero-filled by the kernel and left untouched, so
+ * that their pages are placed by the threads writing them first.
+ *
+ * @param size Size in bytes, multiple of the alignment
+ * @param mapped Set if the buffer is mapped, see NUMA::allocate
+ * @return void* Allocated buffer
+ * @throws std::bad_alloc If the allocation fails
+ */
+static void *aligned_allocate(size_t size, bool &mapped)
+{
+    mapped = false;
+    if (size == 0)
+    {
+        return nullptr;
+    }
+    void *ptr = NUMA::allocate(size, PathBlock::alignment, mapped);
+    if (ptr == nullptr)
+    {
+        throw std::bad_alloc();
+    }
+    if (!mapped)
+    {
+        std::memset(ptr, 0, size);
+    }
+    return ptr;
+}
+
+/**
+ * @brief Free a buffer allocated by aligned_allocate
+ *
+ * @param ptr Buffer to free
+ * @param size Size in bytes
+ * @param mapped Buffer is mapped
+ */
+static void aligned_free(void *ptr, size_t size, bool mapped) noexcept
+{
+    NUMA::release(ptr, size, mapped);
+}
+
+/**
+ * @brief Compute the stride between two paths
+ *
+ * The number of points is rounded up to a full cache line. When the stride
+ * is a multiple of a page, an extra cache line is added so that walking a
+ * time slice does not map every path onto the same cache set.
+ *
+ * @tparam Real Element type
+ * @param nb_points Number of points per path
+ * @return size_t Stride, in elements
+ */
+template <typename Real>
+static size_t padded_stride(size_t nb_points)
+{
+    constexpr size_t line = BasicPathBlock<Real>::alignment / sizeof(Real);
+    size_t stride = (nb_points + line - 1) / line * line;
+    if (stride > 0 && (stride * sizeof(Real)) % 4096 == 0)
+    {
+        stride += line;
+    }
+    return stride;
+}
+
+template <typename Real>
+BasicPathBlock<Real>::BasicPathBlock(size_t nb_paths, size_t nb_points) : BasicPathBlock()
+{
+    resize(nb_paths, nb_points);
+}
+
+template <typename Real>
+BasicPathBlock<Real>::BasicPathBlock(const BasicPathBlock &other) : BasicPathBlock()
+{
+    *this = other;
+}
+
+template <typename Real>
+BasicPathBlock<Real>::BasicPathBlock(BasicPathBlock &&other) noexcept : BasicPathBlock()
+{
+    *this = std::move(other);
+}
+
+template <typename Real>
+BasicPathBlock<Real> &BasicPathBlock<Real>::operator=(const BasicPathBlock &other)
+{
+    if (this != &other)
+    {
+        resize(other.m_nb_paths, other.m_nb_points);
+        if (m_data != nullptr)
+        {
+            std::memcpy(m_data, other.m_data, m_nb_paths * m_stride * sizeof(Real));
+        }
+    }
+    return *this;
+}
+
+template <typename Real>
+BasicPathBlock<Real> &BasicPathBlock<Real>::operator=(BasicPathBlock &&other) noexcept
+{
+    std::swap(m_data, other.m_data);
+    std::swap(m_nb_paths, other.m_nb_paths);
+    std::swap(m_nb_points, other.m_nb_points);
+    std::swap(m_stride, other.m_stride);
+    std::swap(m_mapped, other.m_mapped);
+    return *this;
+}
+
+template <typename Real>
+BasicPathBlock<Real>::~BasicPathBlock()
+{
+    aligned_free(m_data, m_nb_paths * m_stride * sizeof(Real), m_mapped);
+}
+
+template <typename Real>
+void BasicPathBlock<Real>::resize(size_t nb_paths, size_t nb_points)
+{
+    size_t stride = padded_stride<Real>(nb_points);
+
+    if (m_data != nullptr && !m_mapped && nb_paths * stride == m_nb_paths * m_stride)
+    {
+        std::memset(m_data, 0, nb_paths * stride * sizeof(Real));
+    }
+    else
+    {
+        aligned_free(m_data, m_nb_paths * m_stride * sizeof(Real), m_mapped);
+        m_data = nullptr;
+        m_data = static_cast<Real *>(aligned_allocate(nb_paths * stride * sizeof(Real), m_mapped));
+    }
+
+    m_nb_paths = nb_paths;
+    m_nb_points = nb_points;
+    m_stride = stride;
+}
+
+template class BasicPathBlock<double>;
+template class BasicPathBlock<float>;
@@ -0,0 +1,242 @@
+/**
+ * @file portfolio.cpp
+ * @author Thomas Roiseux (thomas.roiseux@mathquantlab.com)
+ * @brief Implements {@link portfolio.h}
+ * @version 1.0
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+
+#include "../headers/portfolio.h"
+
+#include <fstream>
+#include <cstdio>
+#include <algorithm>
+
+/**
+ * @brief Number of scenarios valued at once, so that the netting set values
+ * stay in cache while every trade is added to them
+ *
+ */
+static constexpr size_t scenario_chunk = 4 * SIMD::group;
+
+/**
+ * @brief Split a line into comma-separated fields, without their blanks
+ *
+ * @param line Line
+ * @return std::vector<std::string> Fields
+ */
+static std::vector<std::string> fields(const std::string &line)
+{
+    std::vector<std::string> list;
+    size_t begin = 0;
+    while (begin <= line.size())
+    {
+        size_t end = std::min(line.find(',', begin), line.size());
+        std::string field = line.substr(begin, end - begin);
+        size_t first = field.find_first_not_of(" \t\r");
+        size_t last = field.find_last_not_of(" \t\r");
+        list.push_back(first == std::string::npos ? "" : field.substr(first, last - first + 1));
+        begin = end + 1;
+    }
+    return list;
+}
+
+void Portfolio::Trades::add(double notional, double strike, double maturity, double sign, uint32_t set)
+{
+    this->notional.push_back(notional);
+    this->strike.push_back(strike);
+    this->maturity.push_back(maturity);
+    this->sign.push_back(sign);
+    sets.push_back(set);
+}
+
+SIMD::TradeBatch Portfolio::Trades::alive(Product product, double t, Trades &selection) const
+{
+    selection.notional.clear();
+    selection.strike.clear();
+    selection.maturity.clear();
+    selection.sign.clear();
+    selection.sets.clear();
+    selection.term.clear();
+    for (size_t k = 0; k < size(); k++)
+    {
+        if (t < maturity[k])
+        {
+            selection.add(notional[k], strike[k], maturity[k], sign[k], sets[k]);
+            selection.term.push_back(product == Forward ? 1.0 : maturity[k] - t);
+        }
+    }
+    return SIMD::TradeBatch{selection.size(), selection.notional.data(), selection.strike.data(), selection.term.data(),
+                            selection.sign.data(), selection.sets.data()};
+}
+
+uint32_t Portfolio::netting_set(const std::string &name)
+{
+    auto found = std::find(m_netting_sets.begin(), m_netting_sets.end(), name);
+    if (found != m_netting_sets.end())
+    {
+        return uint32_t(found - m_netting_sets.begin());
+    }
+    m_netting_sets.push_back(name);
+    m_collateralised.push_back(false);
+    return uint32_t(m_netting_sets.size() - 1);
+}
+
+void Portfolio::load(const std::string &filename)
+{
+    std::ifstream file(filename);
+    if (!file)
+    {
+        throw Exception("Cannot read portfolio file: " + filename);
+    }
+
+    std::string line;
+    for (size_t number = 1; std::getline(file, line); number++)
+    {
+        std::string where = filename + ":" + std::to_string(number) + ": ";
+        std::vector<std::string> values = fields(line.substr(0, line.find('#')));
+        if (values.size() == 1 && values[0].empty())
+        {
+            continue;
+        }
+
+        if (values[0] == "collateral")
+        {
+            double threshold;
+            if (values.size() < 4 || values[1].empty() || sscanf(values[2].c_str(), "%lf", &threshold) != 1 || threshold < 0)
+            {
+                throw Exception(where + "expected collateral, <collateral set>, <threshold>, <netting set>...");
+            }
+            if (std::find(m_collateral_sets.begin(), m_collateral_sets.end(), values[1]) != m_collateral_sets.end())
+            {
+                throw Exception(where + "duplicate collateral set " + values[1]);
+            }
+            std::vector<uint32_t> members;
+            for (size_t k = 3; k < values.size(); k++)
+            {
+                uint32_t set = netting_set(values[k]);
+                if (m_collateralised[set])
+                {
+                    throw Exception(where + "netting set " + values[k] + " is already collateralised");
+                }
+                m_collateralised[set] = true;
+                members.push_back(set);
+            }
+            m_collateral_sets.push_back(values[1]);
+            m_thresholds.push_back(threshold);
+            m_members.push_back(members);
+            continue;
+        }
+
+        double notional, strike, maturity;
+        if (values.size() != 5 || values[1].empty() || sscanf(values[2].c_str(), "%lf", &notional) != 1 ||
+            sscanf(values[3].c_str(), "%lf", &strike) != 1 || sscanf(values[4].c_str(), "%lf", &maturity) != 1 || maturity <= 0)
+        {
+            throw Exception(where + "expected <product>, <netting set>, <notional>, <strike>, <maturity>");
+        }
+
+        if (values[0] == "swap")
+        {
+            m_swaps.add(notional, strike, maturity, 1, netting_set(values[1]));
+        }
+        else if (values[0] == "fx_forward")
+        {
+            m_forwards.add(notional, strike, maturity, 1, netting_set(values[1]));
+        }
+        else if (values[0] == "call" || values[0] == "put")
+        {
+            if (strike <= 0)
+            {
+                throw Exception(where + "option strikes must be positive");
+            }
+            m_options.add(notional, strike, maturity, values[0] == "call" ? 1 : -1, netting_set(values[1]));
+        }
+        else
+        {
+            throw Exception(where + "unknown product " + values[0]);
+        }
+    }
+}
+
+size_t Portfolio::nb_exposure_sets() const noexcept
+{
+    return m_thresholds.size() + size_t(std::count(m_collateralised.begin(), m_collateralised.end(), false));
+}
+
+void Portfolio::value(const std::map<ExternalPaths, PathBlock> &paths, size_t row, size_t count, size_t point, double t, double volatility, double *values, size_t stride, size_t set_stride) const
+{
+    thread_local Trades swaps, forwards, options;
+    thread_local Vector rates, fx, equity, sets, net;
+
+    SIMD::TradeBatch swap_batch = m_swaps.alive(Swap, t, swaps);
+    SIMD::TradeBatch forward_batch = m_forwards.alive(Forward, t, forwards);
+    SIMD::TradeBatch option_batch = m_options.alive(Option, t, options);
+    if (option_batch.nb_trades > 0 && !(volatility > 0))
+    {
+        throw Exception("Equity options need a positive equity volatility");
+    }
+
+    const PathBlock &rate_paths = paths.at(ExternalPaths::Interest);
+    const PathBlock &fx_paths = paths.at(ExternalPaths::FX);
+    const PathBlock &equity_paths = paths.at(ExternalPaths::Equity);
+    size_t nb_sets = m_netting_sets.size();
+    rates.resize(scenario_chunk);
+    fx.resize(scenario_chunk);
+    equity.resize(scenario_chunk);
+    net.resize(scenario_chunk);
+    sets.resize(nb_sets * scenario_chunk);
+
+    for (size_t first = 0; first < count; first += scenario_chunk)
+    {
+        // Scenarios gathered into lanes, the last one repeated up to a full block
+        size_t n = std::min(scenario_chunk, count - first);
+        size_t lanes = (n + SIMD::block - 1) / SIMD::block * SIMD::block;
+        for (size_t l = 0; l < lanes; l++)
+        {
+            size_t i = row + first + std::min(l, n - 1);
+            rates[l] = rate_paths(i, point);
+            fx[l] = fx_paths(i, point);
+            equity[l] = equity_paths(i, point);
+        }
+
+        std::fill(sets.begin(), sets.begin() + nb_sets * lanes, 0.0);
+        SIMD::value_linear(swap_batch, rates.data(), lanes, sets.data());
+        SIMD::value_linear(forward_batch, fx.data(), lanes, sets.data());
+        SIMD::value_options(option_batch, volatility, equity.data(), rates.data(), lanes, sets.data());
+
+        // Collateral sets first, clamped to their threshold, then the
+        // uncollateralised netting sets
+        double *out = values + first * stride;
+        for (size_t c = 0; c < m_thresholds.size(); c++, out += set_stride)
+        {
+            std::fill(net.begin(), net.begin() + lanes, 0.0);
+            for (uint32_t s : m_members[c])
+            {
+                for (size_t l = 0; l < lanes; l++)
+                {
+                    net[l] += sets[s * lanes + l];
+                }
+            }
+            double threshold = m_thresholds[c];
+            for (size_t l = 0; l < n; l++)
+            {
+                out[l * stride] = std::min(std::max(net[l], -threshold), threshold);
+            }
+        }
+        for (size_t s = 0; s < nb_sets; s++)
+        {
+            if (m_collateralised[s])
+            {
+                continue;
+            }
+            for (size_t l = 0; l < n; l++)
+            {
+                out[l * stride] = sets[s * lanes + l];
+            }
+            out += set_stride;
+        }
+    }
+}
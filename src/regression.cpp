@@ -0,0 +1,328 @@
+/**
+ * @file regression.cpp
+ * @author Thomas Roiseux (thomas.roiseux@mathquantlab.com)
+ * @brief Implements {@link regression.h}
+ * @version 1.0
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+
+#include "../headers/regression.h"
+#include "../headers/simd.h"
+
+#include <iostream>
+#include <thread>
+#include <cmath>
+#include <algorithm>
+
+/**
+ * @brief Ridge added to the normal equations, relative to the number of
+ * pilot paths, so that constant factors (the first date) get a zero
+ * coefficient
+ *
+ */
+static constexpr double ridge = 1e-10;
+
+/**
+ * @brief Solve a symmetric positive definite system in place, by Cholesky
+ * factorisation
+ *
+ * @param n Size
+ * @param A Matrix, row-major, overwritten by its factor
+ * @param b Right-hand side, overwritten by the solution
+ * @throws Exception If the matrix is not positive definite
+ */
+static void solve(size_t n, Vector &A, Vector &b)
+{
+    for (size_t i = 0; i < n; i++)
+    {
+        for (size_t j = 0; j <= i; j++)
+        {
+            double sum = A[i * n + j];
+            for (size_t k = 0; k < j; k++)
+            {
+                sum -= A[i * n + k] * A[j * n + k];
+            }
+            if (i == j)
+            {
+                if (sum <= 0)
+                {
+                    throw Exception("Regression normal equations are singular");
+                }
+                A[i * n + i] = std::sqrt(sum);
+            }
+            else
+            {
+                A[i * n + j] = sum / A[j * n + j];
+            }
+        }
+    }
+
+    for (size_t i = 0; i < n; i++)
+    {
+        for (size_t k = 0; k < i; k++)
+        {
+            b[i] -= A[i * n + k] * b[k];
+        }
+        b[i] /= A[i * n + i];
+    }
+    for (size_t i = n; i-- > 0;)
+    {
+        for (size_t k = i + 1; k < n; k++)
+        {
+            b[i] -= A[k * n + i] * b[k];
+        }
+        b[i] /= A[i * n + i];
+    }
+}
+
+void RegressionNMC::run(XVA xva, double factor, const std::map<ExternalPaths, PathBlock> &external_paths, PathView<double> final_path) const
+{
+    std::cout << "Running regression NMC for XVA " << Utils::pretty_print_xva_name(xva) << " on thread " << std::this_thread::get_id() << " with factor " << factor << std::endl;
+
+    PathBlock paths, errors, pfe;
+    run({{xva, factor}}, external_paths, paths, errors, pfe);
+    for (size_t i = 0; i < nb_dates; i++)
+    {
+        final_path[i] = paths(0, i);
+    }
+}
+
+void RegressionNMC::run(const std::map<XVA, double> &xvas, const std::map<ExternalPaths, PathBlock> &external_paths, PathBlock &final_paths, PathBlock &errors, PathBlock &pfe) const
+{
+    std::cout << "Running regression NMC for " << xvas.size() << " XVA on thread " << std::this_thread::get_id() << std::endl;
+
+    PathBlock values;
+    nested_values(external_paths, values);
+    reduce_nested(xvas, external_paths, values, final_paths, errors, pfe);
+
+    if (config.regression_check > 0)
+    {
+        check(xvas, external_paths, values);
+    }
+}
+
+void RegressionNMC::nested_values(const std::map<ExternalPaths, PathBlock> &external_paths, PathBlock &values) const
+{
+    size_t nb_outer = size_t(m0);
+    size_t pilot = std::min(config.regression_pilot, nb_outer);
+    size_t nb_inner = std::max<size_t>(config.regression_inner, 1);
+    std::vector<std::vector<size_t>> monomials = basis();
+    size_t nb_terms = monomials.size();
+
+    if (external_paths.size() != nb_factors)
+    {
+        throw Exception("Regression needs the paths of every external factor");
+    }
+    if (pilot < nb_terms)
+    {
+        throw Exception("Regression needs at least " + std::to_string(nb_terms) + " pilot paths");
+    }
+
+    std::cout << "Fitting " << nb_terms << " monomials on " << pilot << " outer paths with " << nb_inner << " inner paths each on thread " << std::this_thread::get_id() << std::endl;
+
+    values.resize(nb_outer, nb_dates);
+
+    // One task per date: fit on the pilot, then evaluate every outer node
+    pool->parallel_for(0, nb_dates, 1, [&](size_t begin, size_t end)
+                       {
+        std::map<ExternalPaths, PathBlock> inner_paths;
+        const PathBlock *states[nb_factors];
+        for (auto const &external_path : external_paths)
+        {
+            inner_paths[external_path.first].resize(SIMD::group, nb_points);
+            states[external_path.first] = &external_path.second;
+        }
+        Vector sums(pilot), phi(nb_terms), A(nb_terms * nb_terms), b(nb_terms);
+
+        for (size_t d = begin; d < end; d++)
+        {
+            size_t j = grid.point(d);
+            std::fill(sums.begin(), sums.end(), 0.0);
+            for (size_t k = 0; k < nb_inner; k++)
+            {
+                branch(external_paths, 0, 0, pilot, j, k, inner_paths, sums.data());
+            }
+
+            Fit fit;
+            for (size_t f = 0; f < nb_factors; f++)
+            {
+                double sum = 0, sum_squares = 0;
+                for (size_t i = 0; i < pilot; i++)
+                {
+                    sum += (*states[f])(i, j);
+                    sum_squares += (*states[f])(i, j) * (*states[f])(i, j);
+                }
+                fit.mean[f] = sum / pilot;
+                double variance = std::max(sum_squares / pilot - fit.mean[f] * fit.mean[f], 0.0);
+                fit.deviation[f] = variance > 1e-24 * (1 + fit.mean[f] * fit.mean[f]) ? std::sqrt(variance) : 0.0;
+            }
+
+            std::fill(A.begin(), A.end(), 0.0);
+            std::fill(b.begin(), b.end(), 0.0);
+            for (size_t i = 0; i < pilot; i++)
+            {
+                double state[nb_factors];
+                for (size_t f = 0; f < nb_factors; f++)
+                {
+                    state[f] = (*states[f])(i, j);
+                }
+                evaluate(monomials, fit, state, phi.data());
+                for (size_t r = 0; r < nb_terms; r++)
+                {
+                    for (size_t c = 0; c <= r; c++)
+                    {
+                        A[r * nb_terms + c] += phi[r] * phi[c];
+                    }
+                    b[r] += phi[r] * sums[i] / nb_inner;
+                }
+            }
+            for (size_t r = 0; r < nb_terms; r++)
+            {
+                for (size_t c = r + 1; c < nb_terms; c++)
+                {
+                    A[r * nb_terms + c] = A[c * nb_terms + r];
+                }
+                if (r > 0)
+                {
+                    A[r * nb_terms + r] += ridge * pilot;
+                }
+            }
+            solve(nb_terms, A, b);
+            fit.coefficients = b;
+
+            for (size_t i = 0; i < nb_outer; i++)
+            {
+                double state[nb_factors];
+                for (size_t f = 0; f < nb_factors; f++)
+                {
+                    state[f] = (*states[f])(i, j);
+                }
+                evaluate(monomials, fit, state, phi.data());
+                double value = 0;
+                for (size_t r = 0; r < nb_terms; r++)
+                {
+                    value += fit.coefficients[r] * phi[r];
+                }
+                values(i, d) = value;
+            }
+        } });
+}
+
+std::vector<std::vector<size_t>> RegressionNMC::basis() const
+{
+    std::vector<std::vector<size_t>> monomials;
+    for (size_t degree = 0; degree <= config.regression_degree; degree++)
+    {
+        for (size_t a = degree + 1; a-- > 0;)
+        {
+            for (size_t b = degree - a + 1; b-- > 0;)
+            {
+                monomials.push_back({a, b, degree - a - b});
+            }
+        }
+    }
+    return monomials;
+}
+
+void RegressionNMC::evaluate(const std::vector<std::vector<size_t>> &monomials, const Fit &fit, const double state[nb_factors], double *phi)
+{
+    double z[nb_factors];
+    for (size_t f = 0; f < nb_factors; f++)
+    {
+        z[f] = fit.deviation[f] > 0 ? (state[f] - fit.mean[f]) / fit.deviation[f] : 0.0;
+    }
+
+    for (size_t r = 0; r < monomials.size(); r++)
+    {
+        double value = 1;
+        for (size_t f = 0; f < nb_factors; f++)
+        {
+            for (size_t e = 0; e < monomials[r][f]; e++)
+            {
+                value *= z[f];
+            }
+        }
+        phi[r] = value;
+    }
+}
+
+void RegressionNMC::check(const std::map<XVA, double> &xvas, const std::map<ExternalPaths, PathBlock> &external_paths, const PathBlock &values) const
+{
+    size_t nb_outer = size_t(m0);
+    size_t pilot = std::min(config.regression_pilot, nb_outer);
+
+    // Paths of the pilot would measure the fit in sample
+    size_t nb_checked = std::min(config.regression_check, nb_outer - pilot);
+    if (nb_checked == 0)
+    {
+        std::cout << "Regression check skipped: the " << nb_outer << " outer paths all belong to the pilot, use more than "
+                  << config.regression_pilot << " outer paths" << std::endl;
+        return;
+    }
+    if (nb_checked < config.regression_check)
+    {
+        std::cout << "Regression check limited to the " << nb_checked << " outer paths after the pilot" << std::endl;
+    }
+    size_t first = nb_outer - nb_checked;
+    size_t nb_inner = std::max<size_t>(size_t(m1), 1);
+
+    std::cout << "Checking the regression against NMC with " << nb_inner << " inner paths on " << nb_checked << " outer paths" << std::endl;
+
+    PathBlock nested(nb_checked, nb_dates), squares(nb_checked, nb_dates);
+    pool->parallel_for(0, nb_checked * nb_dates, 1, [&](size_t begin, size_t end)
+                       {
+        std::map<ExternalPaths, PathBlock> inner_paths;
+        for (auto const &external_path : external_paths)
+        {
+            inner_paths[external_path.first].resize(SIMD::group, nb_points);
+        }
+
+        for (size_t task = begin; task < end; task++)
+        {
+            size_t i = task / nb_dates;
+            size_t d = task % nb_dates;
+            double sum_squares = 0;
+            nested(i, d) = inner_sum(external_paths, first + i, first + i, grid.point(d), 0, nb_inner, inner_paths, &sum_squares) / nb_inner;
+            squares(i, d) = sum_squares / nb_inner;
+        } });
+
+    // Differences of the conditional expectations, against the inner noise of NMC
+    double squared_difference = 0, inner_variance = 0, largest = 0;
+    size_t largest_date = 0;
+    for (size_t i = 0; i < nb_checked; i++)
+    {
+        for (size_t j = 0; j < nb_dates; j++)
+        {
+            double difference = values(first + i, j) - nested(i, j);
+            squared_difference += difference * difference;
+            inner_variance += std::max(squares(i, j) - nested(i, j) * nested(i, j), 0.0) / nb_inner;
+            if (std::abs(difference) > largest)
+            {
+                largest = std::abs(difference);
+                largest_date = j;
+            }
+        }
+    }
+    size_t nb_nodes = nb_checked * nb_dates;
+    std::cout << "Regression check: RMS difference of the conditional expectations " << std::sqrt(squared_difference / nb_nodes)
+              << ", NMC inner standard error " << std::sqrt(inner_variance / nb_nodes)
+              << ", largest difference " << largest << " at T = " << grid.date(largest_date) << std::endl;
+
+    for (auto const &xva : xvas)
+    {
+        double regressed = 0, reference = 0;
+        for (size_t i = 0; i < nb_checked; i++)
+        {
+            for (size_t j = 0; j < nb_dates; j++)
+            {
+                regressed += xva_value(xva.first, xva.second, values(first + i, j), market.weight(xva.first, j));
+                reference += xva_value(xva.first, xva.second, nested(i, j), market.weight(xva.first, j));
+            }
+        }
+        std::cout << "Regression check: mean " << Utils::pretty_print_xva_name(xva.first) << " on the checked paths "
+                  << regressed / nb_nodes << ", NMC " << reference / nb_nodes << std::endl;
+    }
+}
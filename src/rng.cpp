@@ -0,0 +1,25 @@
+/**
+ * @file rng.cpp
+ * @author Thomas Roiseux (thomas.roiseux@mathquantlab.com)
+ * @brief Implements {@link rng.h}
+ * @version 1.0
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+
+#include "../headers/rng.h"
+#include "../headers/simd.h"
+
+void RNG::Stream::normals(size_t first, size_t count, double *out) const
+{
+    SIMD::normals(m_seed, m_factor, m_outer, m_inner, first, count, out);
+    if (m_negated)
+    {
+        for (size_t k = 0; k < count; k++)
+        {
+            out[k] = -out[k];
+        }
+    }
+}
@@ -0,0 +1,228 @@
+/**
+ * @file sensitivities.cpp
+ * @author Thomas Roiseux (thomas.roiseux@mathquantlab.com)
+ * @brief Implements {@link sensitivities.h}
+ * @version 1.0
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+
+#include "../headers/sensitivities.h"
+#include "../headers/simulation.h"
+
+#include <iostream>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+/**
+ * @brief Key prefix of every external factor
+ *
+ */
+static const std::pair<const char *, ExternalPaths> factor_keys[] = {{"interest", ExternalPaths::Interest},
+                                                                     {"fx", ExternalPaths::FX},
+                                                                     {"equity", ExternalPaths::Equity}};
+
+/**
+ * @brief Get the factor owning a parameter
+ *
+ * @param key Parameter key
+ * @return size_t Factor, nb_factors for the internal model
+ */
+static size_t owner(const std::string &key)
+{
+    std::string factor = key.substr(0, key.find('.'));
+    for (auto const &factor_key : factor_keys)
+    {
+        if (factor == factor_key.first)
+        {
+            return size_t(factor_key.second);
+        }
+    }
+    return nb_factors;
+}
+
+/**
+ * @brief Get the field of a parameter
+ *
+ * @param key Parameter key
+ * @return Models::Field Field
+ */
+static Models::Field field(const std::string &key)
+{
+    std::string name = key.substr(key.find('.') + 1);
+    if (name == "x0")
+    {
+        return Models::Field::X0;
+    }
+    if (name == "mu")
+    {
+        return Models::Field::Mu;
+    }
+    if (name == "kappa")
+    {
+        return Models::Field::Kappa;
+    }
+    if (name == "theta")
+    {
+        return Models::Field::Theta;
+    }
+    return Models::Field::Sigma;
+}
+
+/**
+ * @brief Get the fields a model reads
+ *
+ * @param kind Model
+ * @param initial Include the initial value
+ * @return std::vector<std::string> Fields
+ */
+static std::vector<std::string> model_fields(Models::Kind kind, bool initial)
+{
+    std::vector<std::string> fields;
+    if (initial)
+    {
+        fields.push_back("x0");
+    }
+    if (kind == Models::Kind::GBM)
+    {
+        fields.push_back("mu");
+    }
+    else
+    {
+        fields.push_back("kappa");
+        fields.push_back("theta");
+    }
+    fields.push_back("sigma");
+    return fields;
+}
+
+std::vector<std::string> Sensitivities::parameters(const Config &config)
+{
+    std::vector<std::string> keys;
+    auto add = [&keys](const std::string &key)
+    {
+        if (std::find(keys.begin(), keys.end(), key) == keys.end())
+        {
+            keys.push_back(key);
+        }
+    };
+
+    for (const std::string &key : config.sensitivity_parameters)
+    {
+        if (key != "all")
+        {
+            // A field the model never reads would get a zero sensitivity
+            size_t factor = owner(key);
+            Models::Kind kind = factor == nb_factors ? config.internal.kind : config.external.at(ExternalPaths(factor)).kind;
+            std::vector<std::string> names = model_fields(kind, factor != nb_factors);
+            if (std::find(names.begin(), names.end(), key.substr(key.find('.') + 1)) == names.end())
+            {
+                throw Exception("Sensitivity to " + key + ": the " + Models::name(kind) + " model does not use this parameter");
+            }
+            add(key);
+            continue;
+        }
+        for (auto const &factor_key : factor_keys)
+        {
+            for (const std::string &name : model_fields(config.external.at(factor_key.second).kind, true))
+            {
+                add(std::string(factor_key.first) + "." + name);
+            }
+        }
+        // The internal paths start from the external ones
+        for (const std::string &name : model_fields(config.internal.kind, false))
+        {
+            add("internal." + name);
+        }
+    }
+    return keys;
+}
+
+std::vector<Sensitivity> Sensitivities::compute(const std::map<XVA, double> &xvas, size_t m0, size_t m1, const TimeGrid &grid, const PathBlock &paths,
+                                                const Config &config, size_t nb_threads, RNG::Seed seed, bool streaming)
+{
+    if (config.importance != Importance::None)
+    {
+        throw Exception("Sensitivities need the same outer paths in every run: disable importance sampling");
+    }
+
+    ThreadPool pool(nb_threads);
+    std::unique_ptr<NMC> base = CPUSimulation::make_engine(m0, m1, grid, pool, config, seed, streaming);
+
+    // Samples drawn once, shared by every bumped run
+    std::map<ExternalPaths, PathBlock> normals, external_paths;
+    base->generate_external_normals(normals);
+    for (auto const &model : config.external)
+    {
+        base->evolve_external_paths(normals, external_paths, model.first);
+    }
+
+    std::vector<std::string> keys = parameters(config);
+    std::vector<std::pair<XVA, double>> requested(xvas.begin(), xvas.end());
+
+    PathBlock pathwise;
+    bool with_pathwise = false;
+    if (config.sensitivity_pathwise)
+    {
+        std::vector<std::pair<size_t, Models::Field>> fields;
+        for (const std::string &key : keys)
+        {
+            fields.emplace_back(owner(key), field(key));
+        }
+        with_pathwise = base->pathwise(xvas, external_paths, fields, pathwise);
+        if (!with_pathwise)
+        {
+            std::cout << "Pathwise derivatives need the profile estimator of the synthetic portfolio, with stored internal paths and without control variates" << std::endl;
+        }
+    }
+
+    std::vector<Sensitivity> sensitivities;
+    for (size_t p = 0; p < keys.size(); p++)
+    {
+        const std::string &key = keys[p];
+        Config bumped = config;
+        double value = *bumped.parameter(key);
+        double h = config.sensitivity_bump * (value != 0 ? std::abs(value) : 1.0);
+
+        PathBlock totals(2, requested.size());
+        for (size_t side = 0; side < 2; side++)
+        {
+            std::cout << "Bumping " << key << " by " << (side == 0 ? h : -h) << std::endl;
+            *bumped.parameter(key) = side == 0 ? value + h : value - h;
+            std::unique_ptr<NMC> engine = CPUSimulation::make_engine(m0, m1, grid, pool, bumped, seed, streaming);
+
+            std::map<ExternalPaths, PathBlock> bumped_paths = external_paths;
+            if (owner(key) < nb_factors)
+            {
+                engine->evolve_external_paths(normals, bumped_paths, ExternalPaths(owner(key)));
+            }
+
+            PathBlock results, errors, pfe;
+            engine->run(xvas, bumped_paths, results, errors, pfe);
+            for (size_t k = 0; k < requested.size(); k++)
+            {
+                double total = 0;
+                for (size_t d = 0; d < results.nb_points(); d++)
+                {
+                    total += results(k, d);
+                }
+                totals(side, k) = total;
+            }
+        }
+
+        for (size_t k = 0; k < requested.size(); k++)
+        {
+            double total = 0;
+            for (size_t d = 0; d < paths.nb_points(); d++)
+            {
+                total += paths(k, d);
+            }
+            sensitivities.push_back(Sensitivity{key, requested[k].first, total, h, (totals(0, k) - totals(1, k)) / (2 * h),
+                                                with_pathwise ? pathwise(p, k) : std::numeric_limits<double>::quiet_NaN()});
+        }
+    }
+    return sensitivities;
+}
@@ -0,0 +1,215 @@
+/**
+ * @file shard.cpp
+ * @author Thomas Roiseux (thomas.roiseux@mathquantlab.com)
+ * @brief Implements {@link shard.h}
+ * @version 1.0
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+
+#include "../headers/shard.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+
+#ifndef _WIN32
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+void Shard::Partial::write(std::ostream &out) const
+{
+    uint64_t header[4] = {first, count, replicates, estimates.size()};
+    out.write(reinterpret_cast<const char *>(header), sizeof(header));
+    for (const PathAccumulator &estimate : estimates)
+    {
+        estimate.write(out);
+    }
+    sketch.write(out);
+}
+
+void Shard::Partial::read(std::istream &in)
+{
+    uint64_t header[4];
+    if (!in.read(reinterpret_cast<char *>(header), sizeof(header)))
+    {
+        throw Exception("Truncated shard");
+    }
+    first = size_t(header[0]);
+    count = size_t(header[1]);
+    replicates = size_t(header[2]);
+    estimates.assign(size_t(header[3]), PathAccumulator());
+    for (PathAccumulator &estimate : estimates)
+    {
+        estimate.read(in);
+    }
+    sketch.read(in);
+}
+
+#ifdef _WIN32
+std::vector<std::string> Shard::ForkLauncher::run(size_t, const std::function<std::string(size_t)> &)
+{
+    throw Exception("Local worker processes need fork: run without shards");
+}
+#else
+std::vector<std::string> Shard::ForkLauncher::run(size_t nb_tasks, const std::function<std::string(size_t)> &task)
+{
+    // Pending output would be written again by every worker
+    std::cout.flush();
+    std::cerr.flush();
+
+    std::vector<int> pipes;
+    std::vector<pid_t> workers;
+    for (size_t t = 0; t < nb_tasks; t++)
+    {
+        int fd[2];
+        if (pipe(fd) != 0)
+        {
+            throw Exception("Cannot open the pipe of shard " + std::to_string(t));
+        }
+        pid_t pid = fork();
+        if (pid < 0)
+        {
+            throw Exception("Cannot fork the worker of shard " + std::to_string(t));
+        }
+        if (pid == 0)
+        {
+            close(fd[0]);
+            for (int other : pipes)
+            {
+                close(other);
+            }
+            int status = 0;
+            try
+            {
+                std::string bytes = task(t);
+                for (size_t written = 0; written < bytes.size();)
+                {
+                    ssize_t n = ::write(fd[1], bytes.data() + written, bytes.size() - written);
+                    if (n <= 0)
+                    {
+                        throw Exception("Cannot send the results of shard " + std::to_string(t));
+                    }
+                    written += size_t(n);
+                }
+            }
+            catch (const std::exception &e)
+            {
+                std::cerr << "Shard " << t << ": " << e.what() << std::endl;
+                status = 1;
+            }
+            std::cout.flush();
+            close(fd[1]);
+            _exit(status);
+        }
+        close(fd[1]);
+        pipes.push_back(fd[0]);
+        workers.push_back(pid);
+    }
+
+    // A worker only blocks on its own pipe, so reading them in order cannot deadlock
+    std::vector<std::string> results(nb_tasks);
+    char buffer[1 << 16];
+    for (size_t t = 0; t < nb_tasks; t++)
+    {
+        ssize_t n;
+        while ((n = ::read(pipes[t], buffer, sizeof(buffer))) > 0)
+        {
+            results[t].append(buffer, size_t(n));
+        }
+        close(pipes[t]);
+    }
+
+    bool failed = false;
+    for (size_t t = 0; t < nb_tasks; t++)
+    {
+        int status;
+        failed |= waitpid(workers[t], &status, 0) != workers[t] || !WIFEXITED(status) || WEXITSTATUS(status) != 0;
+    }
+    if (failed)
+    {
+        throw Exception("A shard worker failed");
+    }
+    return results;
+}
+#endif
+
+std::vector<std::pair<size_t, size_t>> Shard::ranges(size_t nb_paths, size_t nb_shards, size_t alignment)
+{
+    size_t nb_blocks = (nb_paths + alignment - 1) / alignment;
+    nb_shards = std::max<size_t>(std::min(nb_shards, nb_blocks), 1);
+
+    std::vector<std::pair<size_t, size_t>> list;
+    for (size_t s = 0; s < nb_shards; s++)
+    {
+        size_t first = std::min(nb_paths, nb_blocks * s / nb_shards * alignment);
+        size_t last = std::min(nb_paths, nb_blocks * (s + 1) / nb_shards * alignment);
+        list.emplace_back(first, last - first);
+    }
+    return list;
+}
+
+void Shard::merge(std::vector<Partial> partials, const std::vector<double> &levels, PathBlock &paths, PathBlock &errors, PathBlock &pfe)
+{
+    if (partials.empty())
+    {
+        throw Exception("No shard to merge");
+    }
+    std::sort(partials.begin(), partials.end(), [](const Partial &a, const Partial &b)
+              { return a.first < b.first; });
+
+    Partial total = partials[0];
+    if (total.first != 0)
+    {
+        throw Exception("The shards miss the first outer paths");
+    }
+    for (size_t s = 1; s < partials.size(); s++)
+    {
+        const Partial &partial = partials[s];
+        if (partial.first != total.count || partial.replicates != total.replicates || partial.estimates.size() != total.estimates.size())
+        {
+            throw Exception("The shards do not partition the outer paths");
+        }
+        for (size_t e = 0; e < total.estimates.size(); e++)
+        {
+            total.estimates[e].merge(partial.estimates[e]);
+        }
+        total.sketch.merge(partial.sketch);
+        total.count += partial.count;
+    }
+
+    size_t nb_xvas = total.estimates.size() / total.replicates;
+    size_t nb_dates = total.sketch.nb_points();
+    paths.resize(nb_xvas, nb_dates);
+    errors.resize(nb_xvas, nb_dates);
+    for (size_t k = 0; k < nb_xvas; k++)
+    {
+        // Replicate estimates reduced as their mean, as in NMC::reduce_nested
+        PathAccumulator accumulator = total.estimates[k * total.replicates];
+        if (total.replicates > 1)
+        {
+            accumulator.reset(nb_dates);
+            for (size_t r = 0; r < total.replicates; r++)
+            {
+                accumulator.add(PathView<const double>(total.estimates[k * total.replicates + r].mean().data(), nb_dates));
+            }
+        }
+        for (size_t j = 0; j < nb_dates; j++)
+        {
+            paths(k, j) = accumulator.mean()[j];
+            errors(k, j) = accumulator.standard_error(j);
+        }
+    }
+
+    pfe.resize(levels.size(), nb_dates);
+    for (size_t l = 0; l < levels.size(); l++)
+    {
+        for (size_t d = 0; d < nb_dates; d++)
+        {
+            pfe(l, d) = total.sketch.quantile(d, levels[l]);
+        }
+    }
+}
@@ -0,0 +1,502 @@
+/**
+ * @file simd.cpp
+ * @author Thomas Roiseux (thomas.roiseux@mathquantlab.com)
+ * @brief Implements {@link simd.h}
+ * @version 1.0
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+
+#include "../headers/simd.h"
+#include "../headers/simd_kernels.h"
+
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <random>
+#include <cstring>
+
+using namespace std;
+
+/**
+ * @brief Get the kernels of an instruction set
+ *
+ * @param isa Instruction set
+ * @return const SIMD::KernelTable* Kernels, nullptr if not compiled in
+ */
+static const SIMD::KernelTable *kernels_of(SIMD::ISA isa) noexcept
+{
+    switch (isa)
+    {
+    case SIMD::AVX512:
+        return SIMD::avx512_kernels();
+    case SIMD::AVX2:
+        return SIMD::avx2_kernels();
+    case SIMD::SSE:
+        return SIMD::sse_kernels();
+    default:
+        return SIMD::scalar_kernels();
+    }
+}
+
+/**
+ * @brief Instruction set in use
+ *
+ * @return SIMD::ISA& Instruction set
+ */
+static SIMD::ISA &current_isa() noexcept
+{
+    static SIMD::ISA isa = SIMD::detect();
+    return isa;
+}
+
+/**
+ * @brief Kernels in use
+ *
+ * @return const SIMD::KernelTable*& Kernels
+ */
+static const SIMD::KernelTable *&current_kernels() noexcept
+{
+    static const SIMD::KernelTable *kernels = kernels_of(current_isa());
+    return kernels;
+}
+
+SIMD::ISA SIMD::detect() noexcept
+{
+    if (is_supported(AVX512))
+    {
+        return AVX512;
+    }
+    if (is_supported(AVX2))
+    {
+        return AVX2;
+    }
+    if (is_supported(SSE))
+    {
+        return SSE;
+    }
+    return Scalar;
+}
+
+bool SIMD::is_supported(ISA isa) noexcept
+{
+    if (kernels_of(isa) == nullptr)
+    {
+        return false;
+    }
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+    switch (isa)
+    {
+    case AVX512:
+        return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512dq");
+    case AVX2:
+        return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+    case SSE:
+        return __builtin_cpu_supports("sse4.1");
+    default:
+        return true;
+    }
+#else
+    return isa == Scalar;
+#endif
+}
+
+SIMD::ISA SIMD::active() noexcept
+{
+    return current_isa();
+}
+
+void SIMD::select(ISA isa)
+{
+    if (!is_supported(isa))
+    {
+        throw Exception(std::string("Instruction set not supported: ") + name(isa));
+    }
+    current_isa() = isa;
+    current_kernels() = kernels_of(isa);
+}
+
+SIMD::ISA SIMD::parse(const std::string &str)
+{
+    if (str == "scalar")
+    {
+        return Scalar;
+    }
+    if (str == "sse")
+    {
+        return SSE;
+    }
+    if (str == "avx2")
+    {
+        return AVX2;
+    }
+    if (str == "avx512")
+    {
+        return AVX512;
+    }
+    throw Exception("Unknown instruction set: " + str);
+}
+
+const char *SIMD::name(ISA isa) noexcept
+{
+    switch (isa)
+    {
+    case Scalar:
+        return "scalar";
+    case SSE:
+        return "sse";
+    case AVX2:
+        return "avx2";
+    case AVX512:
+        return "avx512";
+    default:
+        return "unknown";
+    }
+}
+
+void SIMD::normals(RNG::Seed seed, uint32_t factor, uint32_t outer, uint32_t inner, size_t first, size_t count, double *out)
+{
+    constexpr size_t tile = 16 * block;
+    alignas(64) double u1[tile], u2[tile], z0[tile], z1[tile];
+
+    if (count == 0)
+    {
+        return;
+    }
+
+    const KernelTable *kernels = current_kernels();
+    const uint32_t key[2] = {uint32_t(seed), uint32_t(seed >> 32)};
+    size_t last = first + count;
+    size_t first_pair = first / 2;
+    size_t last_pair = (last - 1) / 2 + 1;
+
+    // Each counter gives the samples of an even and an odd step
+    for (size_t pair = first_pair; pair < last_pair; pair += tile)
+    {
+        size_t nb_pairs = std::min(tile, last_pair - pair);
+        size_t nb_blocks = (nb_pairs + block - 1) / block * block;
+
+        for (size_t p = 0; p < nb_blocks; p++)
+        {
+            uint32_t counter[4] = {uint32_t(pair + p), inner, outer, factor};
+            RNG::philox4x32_10(counter, key);
+            u1[p] = RNG::to_uniform(counter[0], counter[1]);
+            u2[p] = RNG::to_uniform(counter[2], counter[3]);
+        }
+
+        kernels->box_muller(u1, u2, nb_blocks, z0, z1);
+
+        for (size_t p = 0; p < nb_pairs; p++)
+        {
+            size_t step = 2 * (pair + p);
+            if (step >= first)
+            {
+                out[step - first] = z0[p];
+            }
+            if (step + 1 < last)
+            {
+                out[step + 1 - first] = z1[p];
+            }
+        }
+    }
+}
+
+/**
+ * @brief Interleaved copy of a group of paths, reused by the calling thread
+ *
+ * @tparam Real Element type
+ * @param nb_points Number of points
+ * @return Real* Buffer of nb_points * SIMD::group elements
+ */
+template <typename Real>
+static Real *lane_buffer(size_t nb_points)
+{
+    static thread_local std::vector<Real> buffer;
+    if (buffer.size() < nb_points * SIMD::group)
+    {
+        buffer.resize(nb_points * SIMD::group);
+    }
+    return buffer.data();
+}
+
+/**
+ * @brief Transpose a matrix, one cache line of each row at a time
+ *
+ * @tparam Real Element type
+ * @param src Source, rows x cols
+ * @param src_stride Distance between two source rows, in elements
+ * @param dst Destination, cols x rows
+ * @param dst_stride Distance between two destination rows, in elements
+ * @param rows Number of source rows
+ * @param cols Number of source columns
+ */
+template <typename Real>
+static void transpose(const Real *src, size_t src_stride, Real *dst, size_t dst_stride, size_t rows, size_t cols)
+{
+    constexpr size_t line = 64 / sizeof(Real);
+    for (size_t c = 0; c < cols; c += line)
+    {
+        size_t c_end = std::min(cols, c + line);
+        for (size_t r = 0; r < rows; r++)
+        {
+            const Real *row = src + r * src_stride;
+            for (size_t k = c; k < c_end; k++)
+            {
+                dst[k * dst_stride + r] = row[k];
+            }
+        }
+    }
+}
+
+/**
+ * @brief Run a lane kernel over paths stored one per row
+ *
+ * Each group of SIMD::group paths is transposed into the lanes, evolved,
+ * and transposed back. Missing paths of the last group evolve zero samples
+ * and are dropped.
+ *
+ * @tparam Real Element type
+ * @tparam Kernel Callable taking the lanes
+ * @param paths First path
+ * @param stride Distance between two paths, in elements
+ * @param nb_paths Number of paths
+ * @param nb_points Number of points per path
+ * @param kernel Kernel
+ */
+template <typename Real, class Kernel>
+static void run_lanes(Real *paths, size_t stride, size_t nb_paths, size_t nb_points, const Kernel &kernel)
+{
+    using SIMD::group;
+    Real *lanes = lane_buffer<Real>(nb_points);
+    for (size_t first = 0; first < nb_paths; first += group)
+    {
+        size_t count = std::min(group, nb_paths - first);
+        if (count < group)
+        {
+            std::fill(lanes, lanes + nb_points * group, Real(0));
+        }
+        Real *rows = paths + first * stride;
+        transpose(rows, stride, lanes, group, count, nb_points);
+        kernel(lanes);
+        transpose(lanes, group, rows, stride, nb_points, count);
+    }
+}
+
+/**
+ * @brief Get the kernel of a model in a kernel table
+ *
+ * @tparam Model Model policy
+ * @tparam Real Element type of the lanes
+ * @param table Kernels
+ * @return SIMD::Evolve<Model, Real> Kernel
+ */
+template <class Model, typename Real>
+static SIMD::Evolve<Model, Real> evolve_kernel(const SIMD::KernelTable &table);
+
+template <>
+SIMD::Evolve<Models::GBM, double> evolve_kernel<Models::GBM, double>(const SIMD::KernelTable &table) { return table.gbm; }
+template <>
+SIMD::Evolve<Models::CIR, double> evolve_kernel<Models::CIR, double>(const SIMD::KernelTable &table) { return table.cir; }
+template <>
+SIMD::Evolve<Models::Vasicek, double> evolve_kernel<Models::Vasicek, double>(const SIMD::KernelTable &table) { return table.vasicek; }
+template <>
+SIMD::Evolve<Models::HullWhite, double> evolve_kernel<Models::HullWhite, double>(const SIMD::KernelTable &table) { return table.hull_white; }
+template <>
+SIMD::Evolve<Models::GBM, float> evolve_kernel<Models::GBM, float>(const SIMD::KernelTable &table) { return table.gbm_float; }
+template <>
+SIMD::Evolve<Models::CIR, float> evolve_kernel<Models::CIR, float>(const SIMD::KernelTable &table) { return table.cir_float; }
+template <>
+SIMD::Evolve<Models::Vasicek, float> evolve_kernel<Models::Vasicek, float>(const SIMD::KernelTable &table) { return table.vasicek_float; }
+template <>
+SIMD::Evolve<Models::HullWhite, float> evolve_kernel<Models::HullWhite, float>(const SIMD::KernelTable &table) { return table.hull_white_float; }
+
+template <class Model, typename Real>
+void SIMD::evolve(Real *paths, size_t stride, size_t nb_paths, size_t nb_points, double x0, const typename Model::Constants *constants)
+{
+    if (nb_points == 0)
+    {
+        return;
+    }
+
+    Evolve<Model, Real> kernel = evolve_kernel<Model, Real>(*current_kernels());
+    run_lanes(paths, stride, nb_paths, nb_points, [&](Real *lanes)
+              {
+        std::fill(lanes, lanes + group, Real(x0));
+        kernel(lanes, nb_points, constants); });
+}
+
+template <class Model, typename Real>
+void SIMD::evolve(Real *paths, size_t stride, size_t nb_paths, size_t nb_points, const typename Model::Constants *constants)
+{
+    if (nb_points == 0)
+    {
+        return;
+    }
+
+    Evolve<Model, Real> kernel = evolve_kernel<Model, Real>(*current_kernels());
+    run_lanes(paths, stride, nb_paths, nb_points, [&](Real *lanes)
+              { kernel(lanes, nb_points, constants); });
+}
+
+template void SIMD::evolve<Models::GBM>(double *, size_t, size_t, size_t, double, const Models::GBM::Constants *);
+template void SIMD::evolve<Models::CIR>(double *, size_t, size_t, size_t, double, const Models::CIR::Constants *);
+template void SIMD::evolve<Models::Vasicek>(double *, size_t, size_t, size_t, double, const Models::Vasicek::Constants *);
+template void SIMD::evolve<Models::HullWhite>(double *, size_t, size_t, size_t, double, const Models::HullWhite::Constants *);
+template void SIMD::evolve<Models::GBM>(double *, size_t, size_t, size_t, const Models::GBM::Constants *);
+template void SIMD::evolve<Models::CIR>(double *, size_t, size_t, size_t, const Models::CIR::Constants *);
+template void SIMD::evolve<Models::Vasicek>(double *, size_t, size_t, size_t, const Models::Vasicek::Constants *);
+template void SIMD::evolve<Models::HullWhite>(double *, size_t, size_t, size_t, const Models::HullWhite::Constants *);
+template void SIMD::evolve<Models::GBM>(float *, size_t, size_t, size_t, double, const Models::GBM::Constants *);
+template void SIMD::evolve<Models::CIR>(float *, size_t, size_t, size_t, double, const Models::CIR::Constants *);
+template void SIMD::evolve<Models::Vasicek>(float *, size_t, size_t, size_t, double, const Models::Vasicek::Constants *);
+template void SIMD::evolve<Models::HullWhite>(float *, size_t, size_t, size_t, double, const Models::HullWhite::Constants *);
+template void SIMD::evolve<Models::GBM>(float *, size_t, size_t, size_t, const Models::GBM::Constants *);
+template void SIMD::evolve<Models::CIR>(float *, size_t, size_t, size_t, const Models::CIR::Constants *);
+template void SIMD::evolve<Models::Vasicek>(float *, size_t, size_t, size_t, const Models::Vasicek::Constants *);
+template void SIMD::evolve<Models::HullWhite>(float *, size_t, size_t, size_t, const Models::HullWhite::Constants *);
+
+void SIMD::value_linear(const TradeBatch &trades, const double *states, size_t count, double *sets)
+{
+    current_kernels()->value_linear(trades, states, count, sets);
+}
+
+void SIMD::value_options(const TradeBatch &trades, double volatility, const double *spots, const double *rates, size_t count, double *sets)
+{
+    current_kernels()->value_options(trades, volatility, spots, rates, count, sets);
+}
+
+/**
+ * @brief Print the moments and the Kolmogorov-Smirnov distance of a sample
+ * against N(0, 1)
+ *
+ * @param label Sample name
+ * @param sample Sample, sorted in place
+ * @return true Sample is consistent with N(0, 1)
+ * @return false Sample is not consistent with N(0, 1)
+ */
+static bool check_distribution(const char *label, std::vector<double> &sample)
+{
+    double n = double(sample.size());
+    double m1 = 0, m2 = 0, m3 = 0, m4 = 0;
+    for (double z : sample)
+    {
+        double z2 = z * z;
+        m1 += z;
+        m2 += z2;
+        m3 += z2 * z;
+        m4 += z2 * z2;
+    }
+    m1 /= n;
+    m2 /= n;
+    m3 /= n;
+    m4 /= n;
+
+    std::sort(sample.begin(), sample.end());
+    double ks = 0;
+    for (size_t i = 0; i < sample.size(); i++)
+    {
+        double cdf = 0.5 * std::erfc(-sample[i] / std::sqrt(2.0));
+        ks = std::max(ks, std::max(cdf - i / n, (i + 1) / n - cdf));
+    }
+
+    // Moments within 5 standard errors, Kolmogorov-Smirnov at the 1% level
+    bool ok = std::abs(m1) < 5 * std::sqrt(1 / n) && std::abs(m2 - 1) < 5 * std::sqrt(2 / n) &&
+              std::abs(m3) < 5 * std::sqrt(15 / n) && std::abs(m4 - 3) < 5 * std::sqrt(96 / n) &&
+              ks < 1.628 / std::sqrt(n);
+
+    cout << "  " << std::left << std::setw(28) << label << std::right << std::setprecision(5)
+         << " mean " << std::setw(12) << m1 << " var " << std::setw(12) << m2
+         << " skew " << std::setw(12) << m3 << " kurt " << std::setw(12) << m4
+         << " KS " << std::setw(12) << ks << (ok ? "  ok" : "  FAILED") << endl;
+    return ok;
+}
+
+bool SIMD::check_normals(size_t nb_samples, RNG::Seed seed)
+{
+    const size_t path_length = 1000;
+    const double tolerance = 1e-12;
+    size_t nb_paths = std::max<size_t>(1, nb_samples / path_length);
+    ISA previous = active();
+    bool ok = true;
+
+    // The seed of the run and two unrelated ones, so a kernel cannot pass on a lucky key
+    const RNG::Seed seeds[] = {seed, seed ^ 0x9e3779b97f4a7c15ull, ~seed};
+
+    cout << "Checking " << nb_paths * path_length << " normal samples on the seeds " << seeds[0] << ", " << seeds[1] << ", " << seeds[2] << endl;
+
+    // Kernels of the same arithmetic give the same bits: the first supported
+    // one of the separate and of the fused multiply-adds is the reference of
+    // the others
+    std::vector<double> batched(nb_paths * path_length);
+    std::vector<double> references[2];
+    ISA reference_isa[2] = {Scalar, Scalar};
+    for (ISA isa : {Scalar, SSE, AVX2, AVX512})
+    {
+        if (!is_supported(isa))
+        {
+            cout << "  " << std::left << std::setw(28) << name(isa) << std::right << " not supported, skipped" << endl;
+            continue;
+        }
+        select(isa);
+
+        bool fused = isa == AVX2 || isa == AVX512;
+        if (references[fused].empty())
+        {
+            reference_isa[fused] = isa;
+        }
+        double max_error = 0;
+        size_t mismatches = 0;
+        for (size_t s = 0; s < 3; s++)
+        {
+            for (size_t path = 0; path < nb_paths; path++)
+            {
+                // Odd offsets exercise the split of the first and last pairs
+                size_t first = path % 3;
+                double *out = batched.data() + path * path_length;
+                normals(seeds[s], uint32_t(path % 3), uint32_t(path), 1, first, path_length, out);
+                for (size_t k = 0; k < path_length; k++)
+                {
+                    double reference = RNG::normal(seeds[s], uint32_t(path % 3), uint32_t(path), 1, uint32_t(first + k));
+                    max_error = std::max(max_error, std::abs(out[k] - reference));
+                }
+            }
+
+            std::vector<double> &reference = references[fused];
+            if (reference_isa[fused] == isa)
+            {
+                reference.insert(reference.end(), batched.begin(), batched.end());
+            }
+            else
+            {
+                mismatches += std::memcmp(batched.data(), reference.data() + s * batched.size(), batched.size() * sizeof(double)) != 0;
+            }
+        }
+
+        bool accurate = max_error < tolerance && mismatches == 0;
+        ok = ok && accurate;
+        cout << "  " << std::left << std::setw(28) << name(isa) << std::right << " max |batched - RNG::normal| = "
+             << std::setprecision(3) << max_error;
+        if (reference_isa[fused] != isa)
+        {
+            cout << (mismatches ? ", differs from " : ", bitwise ") << name(reference_isa[fused]);
+        }
+        cout << (accurate ? "  ok" : "  FAILED") << endl;
+    }
+    select(previous);
+
+    std::vector<double> sample(batched);
+    ok = check_distribution("batched Philox", sample) && ok;
+
+    std::mt19937_64 engine(seed);
+    std::normal_distribution<double> distribution;
+    for (double &z : sample)
+    {
+        z = distribution(engine);
+    }
+    ok = check_distribution("std::normal_distribution", sample) && ok;
+
+    return ok;
+}
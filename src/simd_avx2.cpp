@@ -0,0 +1,32 @@
+/**
+ * @file simd_avx2.cpp
+ * @author Thomas Roiseux (thomas.roiseux@mathquantlab.com)
+ * @brief Instantiates the AVX2 kernels of {@link simd_kernels.h}
+ * @version 1.0
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2024
+ *
+ * Compiled with the AVX2 flags; without them, the kernels are left out
+ * and the dispatcher never selects them.
+ *
+ */
+
+#include "../headers/simd_kernels.h"
+
+#if defined(__AVX2__) && defined(__FMA__)
+
+const SIMD::KernelTable *SIMD::avx2_kernels() noexcept
+{
+    static const KernelTable table = Kernels::make_table<AVX2Pack, AVX2FloatPack>();
+    return &table;
+}
+
+#else
+
+const SIMD::KernelTable *SIMD::avx2_kernels() noexcept
+{
+    return nullptr;
+}
+
+#endif
@@ -0,0 +1,37 @@
+/**
+ * @file simd_avx512.cpp
+ * @author Thomas Roiseux (thomas.roiseux@mathquantlab.com)
+ * @brief Instantiates the AVX-512 kernels of {@link simd_kernels.h}
+ * @version 1.0
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2024
+ *
+ * Compiled with the AVX-512 flags; without them, the kernels are left out
+ * and the dispatcher never selects them.
+ *
+ */
+
+#if defined(__GNUC__) && !defined(__clang__)
+// The AVX-512 intrinsics of GCC start from deliberately undefined registers
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+
+#include "../headers/simd_kernels.h"
+
+#if defined(__AVX512F__) && defined(__AVX512DQ__)
+
+const SIMD::KernelTable *SIMD::avx512_kernels() noexcept
+{
+    static const KernelTable table = Kernels::make_table<AVX512Pack, AVX512FloatPack>();
+    return &table;
+}
+
+#else
+
+const SIMD::KernelTable *SIMD::avx512_kernels() noexcept
+{
+    return nullptr;
+}
+
+#endif
@@ -0,0 +1,18 @@
+/**
+ * @file simd_scalar.cpp
+ * @author Thomas Roiseux (thomas.roiseux@mathquantlab.com)
+ * @brief Instantiates the portable kernels of {@link simd_kernels.h}
+ * @version 1.0
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+
+#include "../headers/simd_kernels.h"
+
+const SIMD::KernelTable *SIMD::scalar_kernels() noexcept
+{
+    static const KernelTable table = Kernels::make_table<ScalarPack, ScalarFloatPack>();
+    return &table;
+}
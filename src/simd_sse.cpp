@@ -0,0 +1,32 @@
+/**
+ * @file simd_sse.cpp
+ * @author Thomas Roiseux (thomas.roiseux@mathquantlab.com)
+ * @brief Instantiates the SSE4.1 kernels of {@link simd_kernels.h}
+ * @version 1.0
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2024
+ *
+ * Compiled with the SSE4.1 flags; without them, the kernels are left out
+ * and the dispatcher never selects them.
+ *
+ */
+
+#include "../headers/simd_kernels.h"
+
+#if defined(__SSE4_1__)
+
+const SIMD::KernelTable *SIMD::sse_kernels() noexcept
+{
+    static const KernelTable table = Kernels::make_table<SSEPack, SSEFloatPack>();
+    return &table;
+}
+
+#else
+
+const SIMD::KernelTable *SIMD::sse_kernels() noexcept
+{
+    return nullptr;
+}
+
+#endif
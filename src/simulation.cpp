@@ -10,49 +10,148 @@
  */
 
 #include "../headers/simulation.h"
-#include <thread>
+#include "../headers/mlmc.h"
+#include "../headers/adaptive.h"
+#include "../headers/regression.h"
+#include "../headers/simd.h"
 #include <iostream>
+#include <algorithm>
+#include <memory>
+#include <sstream>
+#include <thread>
+
+/**
+ * @brief Check that the estimator supports the precision of the configuration
+ *
+ * @param config Configuration
+ * @throws Exception If the internal paths cannot be held in float
+ */
+static void check_precision(const Config &config)
+{
+    if (config.precision == Precision::Double)
+    {
+        return;
+    }
+    if (config.estimator != Estimator::Profile)
+    {
+        throw Exception("Float and mixed precision hold the internal paths of the profile estimator: use --estimator profile");
+    }
+    if (!config.portfolio.empty())
+    {
+        throw Exception("The portfolio is valued in double: use --precision double");
+    }
+}
+
+std::unique_ptr<NMC> CPUSimulation::make_engine(size_t m0, size_t m1, const TimeGrid &grid, ThreadPool &pool, const Config &config, RNG::Seed seed, bool streaming)
+{
+    check_precision(config);
+    if (config.importance != Importance::None && !config.portfolio.empty())
+    {
+        throw Exception("Importance sampling fits its drift to the synthetic portfolio: drop --importance or --portfolio");
+    }
+
+    std::unique_ptr<NMC> engine;
+    if (config.estimator == Estimator::MLMC)
+    {
+        engine.reset(new MLMC(m0, m1, grid, pool, config, seed, streaming));
+    }
+    else if (config.estimator == Estimator::Adaptive)
+    {
+        engine.reset(new AdaptiveNMC(m0, m1, grid, pool, config, seed, streaming));
+    }
+    else if (config.estimator == Estimator::Regression)
+    {
+        engine.reset(new RegressionNMC(m0, m1, grid, pool, config, seed, streaming));
+    }
+    else
+    {
+        engine.reset(new NMC(m0, m1, grid, pool, config, seed, streaming));
+    }
+    return engine;
+}
 
 void CPUSimulation::run_simulation(const std::map<XVA, double>& xvas,
                                    size_t m0, size_t m1,
-                                   size_t nb_points, double T,
-                                   std::map<ExternalPaths, std::vector<Vector>> &external_paths,
-                                   std::map<XVA, Vector> &paths)
+                                   const TimeGrid &grid,
+                                   std::map<ExternalPaths, PathBlock> &external_paths,
+                                   PathBlock &paths,
+                                   PathBlock &errors,
+                                   PathBlock &pfe,
+                                   const Config &config,
+                                   size_t nb_threads,
+                                   RNG::Seed seed,
+                                   bool streaming)
 {
-    NMC nmc(m0, m1, nb_points, T);
+    if (!config.portfolio.empty() && config.estimator != Estimator::Profile && config.estimator != Estimator::Nested)
+    {
+        throw Exception("The portfolio is valued in closed form at every scenario: use the profile or nested estimator");
+    }
 
-    external_paths[ExternalPaths::Interest] = std::vector<Vector>(m0);
-    external_paths[ExternalPaths::FX] = std::vector<Vector>(m0);
-    external_paths[ExternalPaths::Equity] = std::vector<Vector>(m0);
+    ThreadPool pool(nb_threads);
+    std::unique_ptr<NMC> engine = make_engine(m0, m1, grid, pool, config, seed, streaming);
+    NMC &nmc = *engine;
 
-    std::thread interest_thread(&NMC::generate_interest_rate_paths, &nmc, std::ref(external_paths[ExternalPaths::Interest]));
-    std::thread fx_thread(&NMC::generate_fx_rate_paths, &nmc, std::ref(external_paths[ExternalPaths::FX]));
-    std::thread equity_thread(&NMC::generate_equity_paths, &nmc, std::ref(external_paths[ExternalPaths::Equity]));
+    std::cout << "Thread pool started with " << pool.size() << " threads" << std::endl;
 
-    interest_thread.join();
-    fx_thread.join();
-    equity_thread.join();
+    nmc.generate_external_paths(external_paths);
 
     #ifdef DEBUG
         for (auto const &external_path : external_paths)
         {
             std::cout << "External path " << external_path.first << std::endl;
-            std::cout << "External path size: " << external_path.second.size() << std::endl;
+            std::cout << "External path size: " << external_path.second.nb_paths() << std::endl;
         }
     #endif
 
     std::cout << "Interest, FX and Equity paths generated" << std::endl;
 
-    std::thread *threads = new std::thread[xvas.size()];
+    nmc.run(xvas, external_paths, paths, errors, pfe);
+}
+void CPUSimulation::run_sharded(const std::map<XVA, double>& xvas,
+                                size_t m0, size_t m1,
+                                const TimeGrid &grid,
+                                PathBlock &paths,
+                                PathBlock &errors,
+                                PathBlock &pfe,
+                                const Config &config,
+                                Shard::Launcher &launcher,
+                                size_t nb_shards,
+                                size_t nb_threads,
+                                RNG::Seed seed)
+{
+    if (config.estimator != Estimator::Nested)
+    {
+        throw Exception("Sharding splits the outer paths of the nested estimator: use --estimator nested");
+    }
+    check_precision(config);
+    if (config.control_variates)
+    {
+        throw Exception("Control variates need every outer path: run without shards");
+    }
 
-    for (auto const &xva : xvas)
+    std::vector<std::pair<size_t, size_t>> ranges = Shard::ranges(m0, nb_shards, SIMD::group);
+    if (nb_threads == 0)
     {
-        threads[xva.first] = std::thread(&NMC::run, nmc, xva.first, xva.second, std::ref(external_paths), std::ref(paths[xva.first]));
+        nb_threads = std::max<size_t>(std::thread::hardware_concurrency() / ranges.size(), 1);
     }
-    for (auto const &xva : xvas)
+    std::cout << "Sharding " << m0 << " outer paths over " << ranges.size() << " workers of " << nb_threads << " threads" << std::endl;
+
+    // Every worker builds its own pool, the coordinator holding no thread when it forks
+    std::vector<std::string> bytes = launcher.run(ranges.size(), [&](size_t shard)
+                                                  {
+        ThreadPool pool(nb_threads);
+        std::unique_ptr<NMC> engine = make_engine(m0, m1, grid, pool, config, seed, false);
+        Shard::Partial partial;
+        engine->nested_shard(xvas, ranges[shard].first, ranges[shard].second, partial);
+        std::ostringstream out;
+        partial.write(out);
+        return out.str(); });
+
+    std::vector<Shard::Partial> partials(bytes.size());
+    for (size_t s = 0; s < bytes.size(); s++)
     {
-        threads[xva.first].join();
+        std::istringstream in(bytes[s]);
+        partials[s].read(in);
     }
-    delete[] threads;
-    threads = nullptr;
-}
\ No newline at end of file
+    Shard::merge(partials, config.pfe_levels, paths, errors, pfe);
+}
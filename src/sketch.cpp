@@ -0,0 +1,251 @@
+/**
+ * @file sketch.cpp
+ * @author Thomas Roiseux (thomas.roiseux@mathquantlab.com)
+ * @brief Implements {@link sketch.h}
+ * @version 1.0
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+
+#include "../headers/sketch.h"
+
+#include <cmath>
+#include <limits>
+#include <algorithm>
+#include <cstdint>
+
+/**
+ * @brief Number of pending values per unit of compression before they are
+ * merged into the centroids
+ *
+ */
+static constexpr size_t buffer_factor = 5;
+
+/**
+ * @brief Largest cumulative weight fraction a centroid starting at q may
+ * reach: one unit of the arcsine scale k(q) = compression / 2pi * asin(2q - 1)
+ *
+ * @param q Cumulative weight fraction before the centroid
+ * @param compression Compression
+ * @return double Cumulative weight fraction
+ */
+static double next_bound(double q, double compression)
+{
+    const double pi = 3.14159265358979323846;
+    double k = compression / (2 * pi) * std::asin(2 * std::min(std::max(q, 0.0), 1.0) - 1) + 1;
+    if (k >= compression / 4)
+    {
+        return 1;
+    }
+    return (std::sin(2 * pi * k / compression) + 1) / 2;
+}
+
+QuantileSketch::QuantileSketch(double compression)
+    : m_compression(compression), m_count(0), m_total(0),
+      m_min(std::numeric_limits<double>::infinity()), m_max(-std::numeric_limits<double>::infinity()) {}
+
+void QuantileSketch::add(double x, double weight)
+{
+    m_buffer.push_back(Centroid{x, weight});
+    m_count++;
+    m_total += weight;
+    m_min = std::min(m_min, x);
+    m_max = std::max(m_max, x);
+    if (m_buffer.size() >= buffer_factor * size_t(m_compression))
+    {
+        compress();
+    }
+}
+
+void QuantileSketch::merge(const QuantileSketch &other)
+{
+    m_buffer.insert(m_buffer.end(), other.m_centroids.begin(), other.m_centroids.end());
+    m_buffer.insert(m_buffer.end(), other.m_buffer.begin(), other.m_buffer.end());
+    m_count += other.m_count;
+    m_total += other.m_total;
+    m_min = std::min(m_min, other.m_min);
+    m_max = std::max(m_max, other.m_max);
+    compress();
+}
+
+void QuantileSketch::flush()
+{
+    compress();
+    m_buffer.shrink_to_fit();
+}
+
+void QuantileSketch::compress()
+{
+    if (m_buffer.empty())
+    {
+        return;
+    }
+
+    // Only the pending values need sorting, the centroids already are
+    auto order = [](const Centroid &a, const Centroid &b)
+    { return a.mean < b.mean; };
+    size_t pending = m_buffer.size();
+    m_buffer.insert(m_buffer.end(), m_centroids.begin(), m_centroids.end());
+    std::sort(m_buffer.begin(), m_buffer.begin() + pending, order);
+    std::inplace_merge(m_buffer.begin(), m_buffer.begin() + pending, m_buffer.end(), order);
+    m_centroids.clear();
+
+    // Greedy pass, each centroid growing while it spans one unit of the
+    // scale; the weighted sum is kept so that the mean is divided out once
+    double before = 0;
+    double limit = m_total * next_bound(0, m_compression);
+    double weight = m_buffer[0].weight;
+    double sum = m_buffer[0].mean * weight;
+    for (size_t i = 1; i < m_buffer.size(); i++)
+    {
+        const Centroid &next = m_buffer[i];
+        if (before + weight + next.weight <= limit)
+        {
+            weight += next.weight;
+            sum += next.mean * next.weight;
+        }
+        else
+        {
+            m_centroids.push_back(Centroid{sum / weight, weight});
+            before += weight;
+            limit = m_total * next_bound(before / m_total, m_compression);
+            weight = next.weight;
+            sum = next.mean * weight;
+        }
+    }
+    m_centroids.push_back(Centroid{sum / weight, weight});
+    m_buffer.clear();
+}
+
+double QuantileSketch::quantile(double level) const
+{
+    if (!m_buffer.empty())
+    {
+        QuantileSketch flushed = *this;
+        flushed.compress();
+        return flushed.quantile(level);
+    }
+    if (m_centroids.empty())
+    {
+        return 0.0;
+    }
+
+    const std::vector<Centroid> &c = m_centroids;
+    double rank = std::min(std::max(m_total - m_count * (1 - level), 0.0), m_total);
+    if (c.size() == 1)
+    {
+        return c[0].mean;
+    }
+
+    // Interpolated between the centres of the centroids, the extremes
+    // closing both ends
+    double centre = c[0].weight / 2;
+    if (rank <= centre)
+    {
+        return m_min + (c[0].mean - m_min) * (centre > 0 ? rank / centre : 0.0);
+    }
+    double cumulative = c[0].weight;
+    for (size_t i = 1; i < c.size(); i++)
+    {
+        double next = cumulative + c[i].weight / 2;
+        if (rank <= next)
+        {
+            double previous = cumulative - c[i - 1].weight / 2;
+            return c[i - 1].mean + (c[i].mean - c[i - 1].mean) * (rank - previous) / (next - previous);
+        }
+        cumulative += c[i].weight;
+    }
+    double last = m_total - c.back().weight / 2;
+    return c.back().mean + (m_max - c.back().mean) * (m_total > last ? (rank - last) / (m_total - last) : 0.0);
+}
+
+void QuantileSketch::write(std::ostream &out) const
+{
+    double scalars[4] = {m_compression, m_total, m_min, m_max};
+    uint64_t sizes[3] = {m_count, m_centroids.size(), m_buffer.size()};
+    out.write(reinterpret_cast<const char *>(scalars), sizeof(scalars));
+    out.write(reinterpret_cast<const char *>(sizes), sizeof(sizes));
+    out.write(reinterpret_cast<const char *>(m_centroids.data()), std::streamsize(m_centroids.size() * sizeof(Centroid)));
+    out.write(reinterpret_cast<const char *>(m_buffer.data()), std::streamsize(m_buffer.size() * sizeof(Centroid)));
+}
+
+void QuantileSketch::read(std::istream &in)
+{
+    double scalars[4];
+    uint64_t sizes[3];
+    if (!in.read(reinterpret_cast<char *>(scalars), sizeof(scalars)) || !in.read(reinterpret_cast<char *>(sizes), sizeof(sizes)))
+    {
+        throw Exception("Truncated quantile sketch");
+    }
+    m_compression = scalars[0];
+    m_total = scalars[1];
+    m_min = scalars[2];
+    m_max = scalars[3];
+    m_count = size_t(sizes[0]);
+    m_centroids.resize(size_t(sizes[1]));
+    m_buffer.resize(size_t(sizes[2]));
+    in.read(reinterpret_cast<char *>(m_centroids.data()), std::streamsize(m_centroids.size() * sizeof(Centroid)));
+    in.read(reinterpret_cast<char *>(m_buffer.data()), std::streamsize(m_buffer.size() * sizeof(Centroid)));
+    if (!in)
+    {
+        throw Exception("Truncated quantile sketch");
+    }
+}
+
+void PathSketch::add(PathView<const double> path)
+{
+    for (size_t j = 0; j < m_points.size(); j++)
+    {
+        m_points[j].add(path[j]);
+    }
+}
+
+void PathSketch::add(PathView<const double> path, PathView<const double> weights)
+{
+    for (size_t j = 0; j < m_points.size(); j++)
+    {
+        m_points[j].add(path[j], weights[j]);
+    }
+}
+
+void PathSketch::flush()
+{
+    for (QuantileSketch &point : m_points)
+    {
+        point.flush();
+    }
+}
+
+void PathSketch::merge(const PathSketch &other)
+{
+    for (size_t j = 0; j < m_points.size(); j++)
+    {
+        m_points[j].merge(other.m_points[j]);
+    }
+}
+
+void PathSketch::write(std::ostream &out) const
+{
+    uint64_t nb_points = m_points.size();
+    out.write(reinterpret_cast<const char *>(&nb_points), sizeof(nb_points));
+    for (const QuantileSketch &point : m_points)
+    {
+        point.write(out);
+    }
+}
+
+void PathSketch::read(std::istream &in)
+{
+    uint64_t nb_points;
+    if (!in.read(reinterpret_cast<char *>(&nb_points), sizeof(nb_points)))
+    {
+        throw Exception("Truncated path sketch");
+    }
+    m_points.assign(size_t(nb_points), QuantileSketch());
+    for (QuantileSketch &point : m_points)
+    {
+        point.read(in);
+    }
+}
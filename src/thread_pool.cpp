@@ -0,0 +1,230 @@
+/**
+ * @file thread_pool.cpp
+ * @author Thomas Roiseux (thomas.roiseux@mathquantlab.com)
+ * @brief Implements {@link thread_pool.h}
+ * @version 1.0
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+
+#include "../headers/thread_pool.h"
+#include "../headers/numa.h"
+
+#include <algorithm>
+
+/**
+ * @brief Pool owning the current thread, if any
+ *
+ */
+static thread_local const ThreadPool *current_pool = nullptr;
+
+/**
+ * @brief Queue index of the current thread in its pool
+ *
+ */
+static thread_local size_t current_index = 0;
+
+ThreadPool::ThreadPool(size_t nb_threads) : m_queued(0), m_stop(false)
+{
+    if (nb_threads == 0)
+    {
+        nb_threads = std::max<size_t>(1, std::thread::hardware_concurrency());
+    }
+
+    // One queue per worker, the last one being shared by threads outside the pool
+    for (size_t i = 0; i < nb_threads; i++)
+    {
+        m_queues.push_back(std::make_unique<Queue>());
+    }
+
+    // Contiguous blocks of worker queues per node, the queue of the calling
+    // thread, which is not pinned, on the last node
+    size_t nb_nodes = NUMA::nodes().size();
+    size_t nb_workers = nb_threads - 1;
+    for (size_t i = 0; i < nb_workers; i++)
+    {
+        m_nodes.push_back(i * nb_nodes / nb_workers);
+    }
+    m_nodes.push_back(nb_nodes - 1);
+    m_steal_order.resize(nb_threads);
+    for (size_t i = 0; i < nb_threads; i++)
+    {
+        for (size_t k = 0; k < nb_threads; k++)
+        {
+            size_t q = (i + k) % nb_threads;
+            if (m_nodes[q] == m_nodes[i])
+            {
+                m_steal_order[i].push_back(q);
+            }
+        }
+        for (size_t k = 0; k < nb_threads; k++)
+        {
+            size_t q = (i + k) % nb_threads;
+            if (m_nodes[q] != m_nodes[i])
+            {
+                m_steal_order[i].push_back(q);
+            }
+        }
+    }
+
+    for (size_t i = 0; i + 1 < nb_threads; i++)
+    {
+        m_workers.emplace_back(&ThreadPool::worker_loop, this, i);
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_sleep_mutex);
+        m_stop = true;
+    }
+    m_sleep.notify_all();
+
+    for (auto &worker : m_workers)
+    {
+        worker.join();
+    }
+}
+
+void ThreadPool::parallel_for(size_t begin, size_t end, size_t grain, const RangeFunction &body)
+{
+    if (end <= begin)
+    {
+        return;
+    }
+
+    size_t count = end - begin;
+    if (grain == 0)
+    {
+        grain = std::max<size_t>(1, count / (4 * size()));
+    }
+    size_t nb_chunks = (count + grain - 1) / grain;
+
+    if (nb_chunks == 1 || m_workers.empty())
+    {
+        body(begin, end);
+        return;
+    }
+
+    Job job;
+    job.body = &body;
+    job.pending = nb_chunks;
+
+    size_t self = current_pool == this ? current_index : m_queues.size() - 1;
+
+    {
+        std::lock_guard<std::mutex> lock(m_sleep_mutex);
+        m_queued += nb_chunks;
+    }
+
+    // Chunks dealt by position to the workers, so that a path has the same
+    // home in every loop over it; the calling thread only steals
+    for (size_t c = 0; c < nb_chunks; c++)
+    {
+        Queue &queue = *m_queues[c * m_workers.size() / nb_chunks];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.tasks.push_back(Task{&job, begin + c * grain, std::min(end, begin + (c + 1) * grain)});
+    }
+    m_sleep.notify_all();
+
+    while (job.pending.load(std::memory_order_acquire) > 0)
+    {
+        Task task;
+        if (find_task(self, task))
+        {
+            execute(task);
+        }
+        else
+        {
+            std::this_thread::yield();
+        }
+    }
+
+    if (job.error)
+    {
+        std::rethrow_exception(job.error);
+    }
+}
+
+void ThreadPool::worker_loop(size_t index)
+{
+    current_pool = this;
+    current_index = index;
+    if (NUMA::pinning())
+    {
+        NUMA::pin(NUMA::nodes()[m_nodes[index]]);
+    }
+
+    while (true)
+    {
+        Task task;
+        if (find_task(index, task))
+        {
+            execute(task);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(m_sleep_mutex);
+        m_sleep.wait(lock, [this]()
+                     { return m_stop || m_queued > 0; });
+        if (m_stop && m_queued == 0)
+        {
+            return;
+        }
+    }
+}
+
+bool ThreadPool::find_task(size_t index, Task &task)
+{
+    if (m_queued.load(std::memory_order_relaxed) == 0)
+    {
+        return false;
+    }
+
+    for (size_t k = 0; k < m_queues.size(); k++)
+    {
+        Queue &queue = *m_queues[m_steal_order[index][k]];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (queue.tasks.empty())
+        {
+            continue;
+        }
+
+        // Own queue is used as a stack, other queues are stolen from the front
+        if (k == 0)
+        {
+            task = queue.tasks.back();
+            queue.tasks.pop_back();
+        }
+        else
+        {
+            task = queue.tasks.front();
+            queue.tasks.pop_front();
+        }
+        m_queued--;
+        return true;
+    }
+    return false;
+}
+
+void ThreadPool::execute(const Task &task)
+{
+    Job *job = task.job;
+    try
+    {
+        (*job->body)(task.begin, task.end);
+    }
+    catch (...)
+    {
+        std::lock_guard<std::mutex> lock(job->error_mutex);
+        if (!job->error)
+        {
+            job->error = std::current_exception();
+        }
+    }
+    // The job may be destroyed by its owner as soon as pending reaches zero
+    job->pending.fetch_sub(1, std::memory_order_release);
+}
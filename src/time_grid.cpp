@@ -0,0 +1,109 @@
+/**
+ * @file time_grid.cpp
+ * @author Thomas Roiseux (thomas.roiseux@mathquantlab.com)
+ * @brief Implements {@link time_grid.h}
+ * @version 1.0
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+
+#include "../headers/time_grid.h"
+
+#include <cmath>
+
+TimeGrid::TimeGrid(size_t nb_points, double T) : m_horizon(T), m_uniform(true), m_times(nb_points), m_exposures(nb_points)
+{
+    double dt = nb_points ? T / nb_points : 0.0;
+    for (size_t j = 0; j < nb_points; j++)
+    {
+        m_times[j] = j * dt;
+        m_exposures[j] = j;
+    }
+}
+
+TimeGrid::TimeGrid(const Config &config, size_t nb_points, double T) : TimeGrid(nb_points, T)
+{
+    bool exact = Models::exact(config.internal.kind);
+    for (auto const &model : config.external)
+    {
+        exact = exact && Models::exact(model.second.kind);
+    }
+    // The models without exact transitions keep at most the step of the
+    // uniform grid unless grid.step says otherwise
+    double step = config.grid_step > 0 ? config.grid_step : (nb_points ? T / nb_points : 0.0);
+    bool substeps = step > 0 && !exact;
+    if (config.grid_dates.empty() && config.grid_growth == 1 && (config.grid_step == 0 || !substeps))
+    {
+        return;
+    }
+
+    // Exposure dates: listed, or N dates over the span of the uniform grid
+    // with geometrically growing intervals
+    std::vector<double> dates = config.grid_dates;
+    if (dates.empty() && nb_points > 0)
+    {
+        dates = m_times;
+        double g = config.grid_growth;
+        if (g != 1 && nb_points > 1)
+        {
+            double first = dates.back() * (g - 1) / (std::pow(g, double(nb_points - 1)) - 1);
+            for (size_t j = 1; j < nb_points; j++)
+            {
+                dates[j] = dates[j - 1] + first * std::pow(g, double(j - 1));
+            }
+            dates.back() = m_times.back();
+        }
+    }
+    if (dates.empty())
+    {
+        throw Exception("The time grid has no exposure date");
+    }
+    if (dates.back() > T)
+    {
+        throw Exception("grid.dates lists a date beyond the horizon T");
+    }
+
+    // Simulation points: the dates, the intervals being split into equal
+    // sub-steps of at most grid.step for the models without exact transitions
+    m_uniform = false;
+    m_times.assign(1, 0.0);
+    m_exposures.clear();
+    for (double date : dates)
+    {
+        if (date == 0)
+        {
+            m_exposures.push_back(0);
+            continue;
+        }
+        double start = m_times.back();
+        size_t count = substeps ? std::max<size_t>(size_t(std::ceil((date - start) / step - 1e-9)), 1) : 1;
+        for (size_t k = 1; k < count; k++)
+        {
+            m_times.push_back(start + (date - start) * k / count);
+        }
+        m_times.push_back(date);
+        m_exposures.push_back(m_times.size() - 1);
+    }
+}
+
+Vector TimeGrid::dates() const
+{
+    Vector dates(m_exposures.size());
+    for (size_t d = 0; d < m_exposures.size(); d++)
+    {
+        dates[d] = date(d);
+    }
+    return dates;
+}
+
+Vector TimeGrid::steps() const
+{
+    Vector steps(m_times.size() > 1 ? m_times.size() - 1 : 0);
+    for (size_t j = 0; j < steps.size(); j++)
+    {
+        steps[j] = m_uniform ? m_horizon / double(m_times.size()) : m_times[j + 1] - m_times[j];
+    }
+    return steps;
+}
@@ -15,9 +15,11 @@
 #include <unordered_set>
 #include <numeric>
 #include <fstream>
+#include <cmath>
 
 #include "../headers/utils.h"
-#include "../headers/cuda_utils.h"
+#include "../headers/simd.h"
+#include "../headers/numa.h"
 
 using namespace std;
 
@@ -28,7 +30,26 @@ void Utils::info(const char *name)
     cout << "  -h, --help      Display this information" << endl;
     cout << "  -v, --version   Display application version" << endl;
     cout << "  --cpu           Use CPU instead of GPU" << endl;
-    cout << "  --gpu <id>      Use GPU with device id" << endl;
+    cout << "  --gpu <id>      Use GPU with device id" << (Backend::gpu_built() ? "" : " (not built in this binary)") << endl;
+    cout << "  --threads <n>   Number of CPU threads (default: all cores)" << endl;
+    cout << "  --shards <n>    Split the outer paths of the nested estimator over n local worker processes, --threads each" << endl;
+    cout << "  --seed <n>      Seed of the random streams (default: " << RNG::default_seed << ")" << endl;
+    cout << "  --streaming     Fold internal paths into running statistics and write standard errors" << endl;
+    cout << "  --config <file> Load the risk factor models from a key = value file" << endl;
+    cout << "  --estimator <e> Exposure estimator: profile, nested, mlmc, adaptive, regression (default: profile)" << endl;
+    cout << "  --precision <p> Internal paths of the profile estimator: double, float, mixed (float paths, double sums), reported against double; faster only when memory bandwidth dominates (default: double)" << endl;
+    cout << "  --qmc <r>       Draw the external paths from r scrambled Sobol sequences with a Brownian bridge" << endl;
+    cout << "  --antithetic    Draw every path with its antithetic partner, negating its normal samples" << endl;
+    cout << "  --control-variates Correct the estimates with the analytic forwards of the models" << endl;
+    cout << "  --importance <m> Measure change of the outer paths for the tail and the PFE: none, auto, cross-entropy of the synthetic portfolio (default: none)" << endl;
+    cout << "  --dates <t,...> Exposure dates, replacing the N uniform points; models with exact transitions jump between them in one step" << endl;
+    cout << "  --portfolio <file> Value the trades of a portfolio file instead of the mean of the factors" << endl;
+    cout << "  --sensitivities <p,...> Sensitivities of the XVA to model parameters (e.g. equity.sigma) or all, with common random numbers" << endl;
+    cout << "  --pathwise      Add the pathwise derivatives to the sensitivities" << endl;
+    cout << "  --numa          Pin the worker threads to the CPUs of their NUMA node, read from /sys" << endl;
+    cout << "  --huge-pages <p> Huge pages of the large path blocks: none, transparent, explicit (default: none)" << endl;
+    cout << "  --simd <isa>    Instruction set of the CPU kernels: scalar, sse, avx2, avx512 (default: best supported)" << endl;
+    cout << "  --check-normals Check the vectorised normal samples of every instruction set against the scalar reference on --seed and two other seeds, and exit" << endl;
     cout << "Arguments:" << endl;
     cout << "  m0              External trajectories number" << endl;
     cout << "  m1              Internal trajectories number" << endl;
@@ -37,13 +58,17 @@ void Utils::info(const char *name)
     cout << "  type            XVA type (CVA, DVA, FVA, MVA, KVA), using form XVA=rate,XVA=rate..." << endl;
 }
 
-int Utils::parse_options(int argc, char *argv[], bool &gpu)
+int Utils::parse_options(int argc, char *argv[], Backend::Options &backend, RNG::Seed &seed, Config &config)
 {
+    // Run once every option is read, so that --seed and --simd apply to it
+    bool check_normals = false;
+    int first_argument = argc;
     for (int i = 1; i < argc; i++)
     {
         if (argv[i][0] != '-')
         {
-            return i;
+            first_argument = i;
+            break;
         }
         if (!strcmp(argv[i], "-h") || !strcmp(argv[i], "--help"))
         {
@@ -57,14 +82,217 @@ int Utils::parse_options(int argc, char *argv[], bool &gpu)
         }
         else if (!strcmp(argv[i], "--cpu"))
         {
-            gpu = false;
+            backend.name = "cpu";
         }
-        else if (gpu && std::string(argv[i]).find("--gpu") != std::string::npos)
+        else if (!strcmp(argv[i], "--streaming"))
+        {
+            backend.streaming = true;
+        }
+        else if (!strcmp(argv[i], "--antithetic"))
+        {
+            config.antithetic = true;
+        }
+        else if (!strcmp(argv[i], "--control-variates"))
+        {
+            config.control_variates = true;
+        }
+        else if (!strcmp(argv[i], "--pathwise"))
+        {
+            config.sensitivity_pathwise = true;
+        }
+        else if (!strcmp(argv[i], "--check-normals"))
+        {
+            check_normals = true;
+        }
+        else if (!strcmp(argv[i], "--config"))
+        {
+            if (i + 1 < argc)
+            {
+                config.load(argv[i + 1]);
+                i++;
+            }
+            else
+            {
+                cerr << "Missing configuration file" << endl;
+                exit(1);
+            }
+        }
+        else if (!strcmp(argv[i], "--estimator"))
+        {
+            if (i + 1 < argc)
+            {
+                config.estimator = parse_estimator(argv[i + 1]);
+                i++;
+            }
+            else
+            {
+                cerr << "Missing estimator" << endl;
+                exit(1);
+            }
+        }
+        else if (!strcmp(argv[i], "--precision"))
+        {
+            if (i + 1 < argc)
+            {
+                config.precision = parse_precision(argv[i + 1]);
+                i++;
+            }
+            else
+            {
+                cerr << "Missing precision" << endl;
+                exit(1);
+            }
+        }
+        else if (!strcmp(argv[i], "--importance"))
+        {
+            if (i + 1 < argc)
+            {
+                config.importance = parse_importance(argv[i + 1]);
+                i++;
+            }
+            else
+            {
+                cerr << "Missing measure change" << endl;
+                exit(1);
+            }
+        }
+        else if (!strcmp(argv[i], "--qmc"))
+        {
+            if (i + 1 < argc)
+            {
+                config.set("qmc.replicates", argv[i + 1]);
+                i++;
+            }
+            else
+            {
+                cerr << "Missing number of replicates" << endl;
+                exit(1);
+            }
+        }
+        else if (!strcmp(argv[i], "--dates"))
+        {
+            if (i + 1 < argc)
+            {
+                config.set("grid.dates", argv[i + 1]);
+                i++;
+            }
+            else
+            {
+                cerr << "Missing exposure dates" << endl;
+                exit(1);
+            }
+        }
+        else if (!strcmp(argv[i], "--portfolio"))
+        {
+            if (i + 1 < argc)
+            {
+                config.set("portfolio", argv[i + 1]);
+                i++;
+            }
+            else
+            {
+                cerr << "Missing portfolio file" << endl;
+                exit(1);
+            }
+        }
+        else if (!strcmp(argv[i], "--sensitivities"))
+        {
+            if (i + 1 < argc)
+            {
+                config.set("sensitivity.parameters", argv[i + 1]);
+                i++;
+            }
+            else
+            {
+                cerr << "Missing sensitivity parameters" << endl;
+                exit(1);
+            }
+        }
+        else if (!strcmp(argv[i], "--numa"))
+        {
+            NUMA::select_pinning(true);
+        }
+        else if (!strcmp(argv[i], "--huge-pages"))
+        {
+            if (i + 1 < argc)
+            {
+                NUMA::select_pages(NUMA::parse_pages(argv[i + 1]));
+                i++;
+            }
+            else
+            {
+                cerr << "Missing huge page policy" << endl;
+                exit(1);
+            }
+        }
+        else if (!strcmp(argv[i], "--simd"))
+        {
+            if (i + 1 < argc)
+            {
+                SIMD::select(SIMD::parse(argv[i + 1]));
+                i++;
+            }
+            else
+            {
+                cerr << "Missing instruction set" << endl;
+                exit(1);
+            }
+        }
+        else if (!strcmp(argv[i], "--seed"))
+        {
+            if (i + 1 < argc)
+            {
+                unsigned long long value;
+                if (sscanf(argv[i + 1], "%llu", &value) != 1)
+                {
+                    throw Exception("Invalid seed");
+                }
+                seed = value;
+                i++;
+            }
+            else
+            {
+                cerr << "Missing seed" << endl;
+                exit(1);
+            }
+        }
+        else if (!strcmp(argv[i], "--shards"))
+        {
+            if (i + 1 < argc)
+            {
+                if (sscanf(argv[i + 1], "%lu", &backend.shards) != 1 || backend.shards == 0)
+                {
+                    throw Exception("Invalid number of shards");
+                }
+                i++;
+            }
+            else
+            {
+                cerr << "Missing number of shards" << endl;
+                exit(1);
+            }
+        }
+        else if (!strcmp(argv[i], "--threads"))
+        {
+            if (i + 1 < argc)
+            {
+                if (sscanf(argv[i + 1], "%lu", &backend.threads) != 1)
+                {
+                    throw Exception("Invalid number of threads");
+                }
+                i++;
+            }
+            else
+            {
+                cerr << "Missing number of threads" << endl;
+                exit(1);
+            }
+        }
+        else if (!strcmp(argv[i], "--gpu"))
         {
-            int device_id;
             if (i + 1 < argc)
             {
-                if (sscanf(argv[i + 1], "%d", &device_id) == 0)
+                if (sscanf(argv[i + 1], "%d", &backend.device) != 1 || backend.device < 0)
                 {
                     throw Exception("Invalid device id");
                 }
@@ -75,7 +303,7 @@ int Utils::parse_options(int argc, char *argv[], bool &gpu)
                 cerr << "Missing device id" << endl;
                 exit(1);
             }
-            CUDA::Utils::select_gpu(device_id);
+            backend.name = "gpu";
         }
         else
         {
@@ -83,7 +311,11 @@ int Utils::parse_options(int argc, char *argv[], bool &gpu)
             exit(1);
         }
     }
-    return argc;
+    if (check_normals)
+    {
+        exit(SIMD::check_normals(1000000, seed) ? 0 : 1);
+    }
+    return first_argument;
 }
 
 void Utils::split_string(const std::string &str, const std::string &delim, std::vector<std::string> &tokens)
@@ -201,38 +433,83 @@ const char *Utils::pretty_print_xva_name(XVA xva)
     }
 }
 
-void Utils::print_results(const std::map<XVA, Vector> &results, const std::string &filename, double T)
+const char *Utils::pretty_print_factor_name(ExternalPaths factor)
+{
+    switch (factor)
+    {
+    case ExternalPaths::Interest:
+        return "interest rate";
+    case ExternalPaths::FX:
+        return "FX rate";
+    case ExternalPaths::Equity:
+        return "equity";
+    default:
+        return "unknown";
+    }
+}
+
+void Utils::print_results(const std::map<XVA, double> &xvas, const PathBlock &results, const PathBlock &errors, const PathBlock &pfe, const std::vector<double> &levels, const std::string &filename, const std::vector<double> &dates)
 {
     std::ofstream file(filename);
+    bool with_errors = !errors.empty();
 
-    file << "T,";
+    file << "T";
 
-    for (const auto& xva: results)
+    for (const auto& xva: xvas)
     {
-        file << pretty_print_xva_name(xva.first);
-        if (xva.first != results.rbegin()->first)
+        file << "," << pretty_print_xva_name(xva.first);
+        if (with_errors)
         {
-            file << ",";
+            file << "," << pretty_print_xva_name(xva.first) << " standard error";
         }
     }
+    for (size_t l = 0; l < pfe.nb_paths(); l++)
+    {
+        file << ",PFE " << 100 * levels[l] << "%";
+    }
 
     file << std::endl;
 
-    double dt = T / results.begin()->second.size();
-
-    for (size_t i = 0; i < results.begin()->second.size(); i++)
+    for (size_t i = 0; i < results.nb_points(); i++)
     {
-        file << i * dt << ",";
-        for (const auto& xva: results)
+        TimeSliceView<const double> slice = results.time_slice(i);
+        file << dates[i];
+        for (size_t j = 0; j < slice.size(); j++)
         {
-            file << xva.second[i];
-            if (xva.first != results.rbegin()->first)
+            file << "," << slice[j];
+            if (with_errors)
             {
-                file << ",";
+                file << "," << errors(j, i);
             }
         }
+        for (size_t l = 0; l < pfe.nb_paths(); l++)
+        {
+            file << "," << pfe(l, i);
+        }
+        file << std::endl;
+    }
+
+    file.close();
+}
+void Utils::print_sensitivities(const std::vector<Sensitivity> &sensitivities, const std::string &filename)
+{
+    std::ofstream file(filename);
+
+    file << "Parameter,XVA,Value,Bump,Finite difference,Pathwise" << std::endl;
+    for (const Sensitivity &sensitivity : sensitivities)
+    {
+        file << sensitivity.parameter << "," << pretty_print_xva_name(sensitivity.xva) << "," << sensitivity.value << ","
+             << sensitivity.bump << "," << sensitivity.finite_difference << ",";
+        if (std::isnan(sensitivity.pathwise))
+        {
+            file << "n/a";
+        }
+        else
+        {
+            file << sensitivity.pathwise;
+        }
         file << std::endl;
     }
 
     file.close();
-}
\ No newline at end of file
+}